@@ -64,7 +64,8 @@ Analyzer::dprint_builders()
 }
 
 
-Analyzer::Analyzer(const Json::Value &p, int id) : id(id), params(p)
+Analyzer::Analyzer(const Json::Value &p, int id) :
+    id(id), params(p), send_clean_evictions(false)
 {
 
 }
@@ -86,11 +87,36 @@ Analyzer::reset_stats()
     // Do nothing
 }
 
+void
+Analyzer::save_state(ProtoOutputStream *os)
+{
+    // Do nothing
+}
+
+bool
+Analyzer::restore_state(ProtoInputStream *is)
+{
+    // Stateless
+    return true;
+}
+
 void
 Analyzer::add_child_analyzer(Analyzer* analyzer)
 {
     //
     child_analyzers.push_back(analyzer);
+    //
+    analyzer->add_core_side_analyzer(this);
+
+    //
+    send_clean_evictions |= analyzer->is_exclusive();
+}
+
+void
+Analyzer::add_core_side_analyzer(Analyzer* analyzer)
+{
+    //
+    core_side_analyzers.push_back(analyzer);
 }
 
 } // end namespace gltracesim
@@ -9,6 +9,8 @@
 #include "packet.hh"
 #include "gltracesim.pb.h"
 
+#include "util/cycle_counter.hh"
+
 #include "gem5/protoio.hh"
 
 namespace gltracesim {
@@ -90,6 +92,36 @@ public:
      */
     virtual void process(const packet_t &pkt) = 0;
 
+    /**
+     * @brief process_batch, consecutive packets of one core. Models
+     * override it to amortize per packet work over the batch and to
+     * only read the fields they need.
+     * @param pkts
+     */
+    virtual void process_batch(const replay_batch_t &pkts)
+    {
+        for (size_t i = 0; i < pkts.n; ++i)
+        {
+            //
+            process(pkts.packet(i));
+        }
+    }
+
+    /**
+     * @brief process_timed_batch, process_batch accounted to
+     * process_cycles
+     * @param pkts
+     */
+    void process_timed_batch(const replay_batch_t &pkts)
+    {
+        //
+        uint64_t start = read_cycles();
+        //
+        process_batch(pkts);
+        //
+        process_cycles.add(read_cycles() - start, pkts.n);
+    }
+
     /**
      * @brief start_new_frame
      */
@@ -112,6 +144,20 @@ public:
      */
     virtual void reset_stats();
 
+    /**
+     * @brief save_state, writes the model state that outlives a frame to
+     * a checkpoint
+     * @param os
+     */
+    virtual void save_state(ProtoOutputStream *os);
+
+    /**
+     * @brief restore_state, reads the state written by save_state
+     * @param is
+     * @return false if the checkpoint does not match the model
+     */
+    virtual bool restore_state(ProtoInputStream *is);
+
     /**
      * @brief get_aid
      * @return
@@ -121,9 +167,37 @@ public:
     }
 
     /**
-     * @brief add_child_analyzer
+     * @brief add_child_analyzer, the next level of a hierarchy, e.g. a
+     * shared cache, that misses and writebacks are sent to
+     */
+    virtual void add_child_analyzer(Analyzer*);
+
+    /**
+     * @brief add_core_side_analyzer, called by add_child_analyzer
      */
-    void add_child_analyzer(Analyzer*);
+    virtual void add_core_side_analyzer(Analyzer*);
+
+    /**
+     * @brief invalidate, drops the blocks of a range on behalf of an
+     * inclusive mem-side cache
+     * @param addr
+     * @param size
+     * @return true if a dropped copy was dirty
+     */
+    virtual bool invalidate(uint64_t addr, uint64_t size) { return false; }
+
+    /**
+     * @brief is_exclusive
+     * @return true if the model only holds blocks evicted by its core
+     * side, which then also sends clean evictions
+     */
+    virtual bool is_exclusive() const { return false; }
+
+    /**
+     * @brief process_cycles, time spent processing batches, items are
+     * packets
+     */
+    CycleCounter process_cycles;
 
 protected:
 
@@ -140,6 +214,26 @@ protected:
         }
     }
 
+    /**
+     * @brief send_invalidate, to the core side
+     * @param addr
+     * @param size
+     * @return true if a dirty copy was dropped
+     */
+    bool send_invalidate(uint64_t addr, uint64_t size)
+    {
+        //
+        bool dirty = false;
+        //
+        for (auto &analyzer: core_side_analyzers)
+        {
+            //
+            dirty |= analyzer->invalidate(addr, size);
+        }
+        //
+        return dirty;
+    }
+
 protected:
 
     /**
@@ -157,6 +251,16 @@ protected:
      */
     std::vector<Analyzer*> child_analyzers;
 
+    /**
+     * @brief core_side_analyzers, that send packets to this one
+     */
+    std::vector<Analyzer*> core_side_analyzers;
+
+    /**
+     * @brief send_clean_evictions, a child is exclusive
+     */
+    bool send_clean_evictions;
+
 public:
 
     /**
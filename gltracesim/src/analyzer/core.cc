@@ -1,4 +1,6 @@
 #include "analyzer/core.hh"
+#include "analyzer/instance.hh"
+#include "analyzer/trace_decoder.hh"
 
 #include "debug_impl.hh"
 
@@ -8,8 +10,9 @@ namespace gltracesim {
 namespace analyzer {
 
 Core::Core(const Json::Value &params,
-    GlTraceSimAnalyzer *simulator, schedular::SchedularPtr schedular) :
-    simulator(simulator), schedular(schedular), state(RUNNING)
+    GlTraceSimAnalyzer *simulator, Instance *instance) :
+    simulator(simulator), instance(instance),
+    schedular(instance->schedular), state(RUNNING)
 {
     id = params["id"].asInt();
     dev = params["dev"].asInt();
@@ -21,12 +24,24 @@ Core::tick()
     //
     state = RUNNING;
 
+    //
+    replay_batch_t pkts;
+    //
+    size_t n = job ?
+        job->next_packets(pkts, instance->batch_size, instance->id) : 0;
+
     // Done with previous job
-    if (_u(job == NULL || job->pkts.empty())) {
+    if (_u(n == 0)) {
+
+        //
+        uint64_t start = read_cycles();
 
         // Try to get a new job from the schedular
         job = schedular->get_next_job(id, dev);
 
+        //
+        instance->schedule_cycles.add(read_cycles() - start, job != NULL);
+
         // Did not get any job, continue
         if (job == NULL) {
             //
@@ -35,27 +50,36 @@ Core::tick()
             return;
         }
 
-        // Load pakcets
-        job->load_trace();
+        // Frames before the warmup window only advance the schedule
+        if (_u(simulator->is_skipping())) {
+            //
+            stats.no_jobs++;
+            //
+            job = NULL;
+            //
+            return;
+        }
+
+        // Load pakcets, predecoded if the decoder kept up
+        trace_decoder->load(job);
 
         //
         stats.no_jobs++;
+
+        //
+        n = job->next_packets(pkts, instance->batch_size, instance->id);
     }
 
-    if (_u(job == NULL || job->pkts.empty())) {
+    if (_u(n == 0)) {
         return;
     }
 
-    //
-    auto &pkt = job->pkts.front();
     // Core id
-    pkt.tid = id;
-    // Handle packet
-    simulator->send_packet(pkt);
-    // Remove from queue
-    job->pkts.pop_front();
+    pkts.tid = id;
+    // Handle packets
+    simulator->send_packets(instance, pkts);
     //
-    stats.no_pkts++;
+    stats.no_pkts += n;
 
     //
     state = RUNNING;
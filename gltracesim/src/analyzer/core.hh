@@ -17,6 +17,8 @@ class GlTraceSimAnalyzer;
 
 namespace analyzer {
 
+class Instance;
+
 class Core {
 
 public:
@@ -33,11 +35,14 @@ public:
 
     /**
      * @brief core_t
+     * @param params
+     * @param simulator
+     * @param instance the core replays jobs of
      */
     Core(
         const Json::Value &params,
         GlTraceSimAnalyzer *simulator,
-        schedular::SchedularPtr schedular
+        Instance *instance
     );
 
 
@@ -71,6 +76,11 @@ private:
      */
     GlTraceSimAnalyzer *simulator;
 
+    /**
+     * @brief instance
+     */
+    Instance *instance;
+
     /**
      * @brief schedular
      */
@@ -1,6 +1,7 @@
 
 #include "analyzer/cpu.hh"
 #include "analyzer/gpu.hh"
+#include "analyzer/instance.hh"
 #include "debug_impl.hh"
 
 #include "gltracesim_analyzer.hh"
@@ -11,38 +12,57 @@ namespace analyzer {
 CPU::CPU(const Json::Value &params,
     GlTraceSimAnalyzer *simulator, schedular::SchedularPtr schedular) :
     simulator(simulator), schedular(schedular), barrier_id(0),
-    state(PROCESS_CMD)
+    state(PROCESS_CMD),
+    tick_event(&simulator->events, 0, [this] { tick(); })
 {
     //
     ProtoMessage::PacketHeader hdr;
 
     pb.cpu = new ProtoInputStream(
-        params["input-dir"].asString() + "/cpu.pb.gz"
+        ProtoStream::find(params["input-dir"].asString() + "/cpu")
     );
 
     //
     pb.cpu->read(hdr);
+    //
+    pb.cmds = new ProtoBatchReader<ProtoMessage::Packet>(
+        pb.cpu, params.get("cmd-batch-size", 256).asUInt()
+    );
 
     DPRINTF(Init, "CPU CMD File Header [id:%s, ver:%i, tick_freq:%lu].\n",
         hdr.obj_id().c_str(), hdr.ver(), hdr.tick_freq()
     );
 
-    // Create CPU core
-    {
-        Json::Value p;
-        p["id"] = 0;
-        p["dev"] = dev::CPU;
-
-        //
-        core = CorePtr(new Core(p, simulator, schedular));
-    }
+    //
+    tick_event.schedule(0);
 }
 
 CPU::~CPU()
 {
+    delete pb.cmds;
     delete pb.cpu;
 }
 
+bool
+CPU::tick_cores()
+{
+    //
+    bool is_running = false;
+
+    //
+    for (auto instance: simulator->instances) {
+        //
+        Core *core = instance->cpu_core.get();
+        //
+        core->tick();
+        //
+        is_running |= (core->get_state() == Core::RuntimeState::RUNNING);
+    }
+
+    //
+    return is_running;
+}
+
 void
 CPU::tick()
 {
@@ -61,6 +81,8 @@ CPU::tick()
         default: assert(0);
         }
 
+        //
+        tick_event.schedule_next();
         //
         return;
     }
@@ -69,9 +91,11 @@ CPU::tick()
     case D_FRAME_SYNC:
     {
         //
-        core->tick();
+        bool is_running = tick_cores();
         //
-        if (core->get_state() == Core::RuntimeState::RUNNING) {
+        tick_event.schedule_next();
+        //
+        if (is_running) {
             return;
         }
 
@@ -92,8 +116,11 @@ CPU::tick()
     case W_END_SCENE_SYNC:
     case W_FRAME_SYNC:
     {
-        //
+        // Sleep until the GPU reaches the barrier
         if (_l(schedular->is_gpu_ready(barrier_id + 1) == false)) {
+            //
+            schedular->wait_gpu_ready(&tick_event);
+            //
             return;
         }
 
@@ -135,6 +162,9 @@ CPU::tick()
         //
         state = PROCESS_CMD;
 
+        //
+        tick_event.schedule_next();
+
         //
         return;
     }
@@ -144,16 +174,22 @@ CPU::tick()
 
 
     //
-    ProtoMessage::Packet pkt;
+    const ProtoMessage::Packet *next_pkt = pb.cmds->next();
 
     //
-    if (_u(pb.cpu->read(pkt) == false)) {
+    if (_u(next_pkt == NULL)) {
         //
         DPRINTF(Info, "No more packets, exiting...\n");
         //
         return;
     }
 
+    // Every command takes a tick
+    tick_event.schedule_next();
+
+    //
+    const ProtoMessage::Packet &pkt = *next_pkt;
+
 //    printf("cmd: %lu\n", pkt.cmd());
 
     switch (pkt.cmd())
@@ -183,6 +219,9 @@ CPU::tick()
         //
         assert(pkt.has_rsc_id());
 
+        // Models look up resources
+        simulator->sync_models();
+
         //
         GpuResourcePtr gpu_resource =
             trace_manager->get_resource(pkt.rsc_id());
@@ -227,6 +266,8 @@ CPU::tick()
             gpu_resource->addr_range.start
         );
 
+        // Models look up resources
+        simulator->sync_models();
         // Move from dead map to dead vector
         system->rt->destroy(gpu_resource);
         //
@@ -8,6 +8,7 @@
 #include "gem5/packet.pb.h"
 
 #include "analyzer/core.hh"
+#include "analyzer/event_queue.hh"
 #include "analyzer/schedular/base.hh"
 
 namespace gltracesim {
@@ -39,14 +40,13 @@ public:
      */
     void tick();
 
+private:
+
     /**
-     * @brief get_core
-     * @param core_id
-     * @return
+     * @brief tick_cores, ticks the CPU core of every instance
+     * @return true if a core is still running
      */
-    Core* get_core() {
-        return core.get();
-    }
+    bool tick_cores();
 
 private:
 
@@ -55,6 +55,7 @@ private:
      */
     struct proto_t {
         ProtoInputStream *cpu;
+        ProtoBatchReader<ProtoMessage::Packet> *cmds;
     } pb;
 
     /**
@@ -63,7 +64,7 @@ private:
     GlTraceSimAnalyzer *simulator;
 
     /**
-     * @brief schedular
+     * @brief schedular, holds the CPU/GPU barriers
      */
     schedular::SchedularPtr schedular;
 
@@ -89,9 +90,9 @@ private:
     RuntimeState state;
 
     /**
-     * @brief core
+     * @brief tick_event, the CPU and its cores tick first every tick
      */
-    CorePtr core;
+    Event tick_event;
 
 };
 
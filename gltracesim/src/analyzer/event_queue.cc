@@ -0,0 +1,84 @@
+#include <cassert>
+#include <climits>
+
+#include "analyzer/event_queue.hh"
+
+namespace gltracesim {
+namespace analyzer {
+
+void
+Event::schedule(uint64_t when)
+{
+    queue->schedule(this, when);
+}
+
+void
+Event::schedule_next()
+{
+    queue->schedule(this, queue->get_tick() + 1);
+}
+
+void
+Event::wake()
+{
+    queue->wake(this);
+}
+
+EventQueue::EventQueue() :
+    cur_tick(0), cur_priority(INT_MIN)
+{
+    // Do nothing
+}
+
+void
+EventQueue::schedule(Event *event, uint64_t when)
+{
+    //
+    assert(event->scheduled == false);
+    // Not in the past
+    assert(when > cur_tick ||
+        (when == cur_tick && event->priority > cur_priority));
+
+    //
+    event->scheduled = true;
+
+    //
+    events.push(entry_t { when, event->priority, event });
+}
+
+void
+EventQueue::wake(Event *event)
+{
+    //
+    if (event->scheduled) {
+        return;
+    }
+
+    //
+    if (event->priority > cur_priority) {
+        schedule(event, cur_tick);
+    } else {
+        schedule(event, cur_tick + 1);
+    }
+}
+
+void
+EventQueue::service_one()
+{
+    //
+    entry_t entry = events.top();
+    //
+    events.pop();
+
+    //
+    cur_tick = entry.when;
+    cur_priority = entry.priority;
+
+    //
+    entry.event->scheduled = false;
+    //
+    entry.event->callback();
+}
+
+} // end namespace analyzer
+} // end namespace gltracesim
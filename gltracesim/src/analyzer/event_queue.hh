@@ -0,0 +1,181 @@
+#ifndef __GLTRACESIM_ANALYZER_EVENT_QUEUE_HH__
+#define __GLTRACESIM_ANALYZER_EVENT_QUEUE_HH__
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace gltracesim {
+namespace analyzer {
+
+class EventQueue;
+
+/**
+ * @brief The Event class, a callback scheduled on an event queue. An
+ * event is scheduled at most once at a time.
+ */
+class Event
+{
+
+public:
+
+    /**
+     * @brief Event
+     * @param queue
+     * @param priority order of the events of a tick, lowest first
+     * @param callback
+     */
+    Event(EventQueue *queue, int priority,
+        const std::function<void()> &callback) :
+        queue(queue), priority(priority), callback(callback),
+        scheduled(false)
+    {
+        // Do nothing
+    }
+
+    /**
+     * @brief schedule
+     * @param when
+     */
+    void schedule(uint64_t when);
+
+    /**
+     * @brief schedule at the next tick
+     */
+    void schedule_next();
+
+    /**
+     * @brief wake, schedules the event at the first slot after the
+     * running event, in the same tick if its priority is higher
+     */
+    void wake();
+
+    /**
+     * @brief is_scheduled
+     * @return
+     */
+    bool is_scheduled() const {
+        return scheduled;
+    }
+
+private:
+
+    //
+    friend class EventQueue;
+
+    /**
+     * @brief queue
+     */
+    EventQueue *queue;
+
+    /**
+     * @brief priority
+     */
+    int priority;
+
+    /**
+     * @brief callback
+     */
+    std::function<void()> callback;
+
+    /**
+     * @brief scheduled
+     */
+    bool scheduled;
+
+};
+
+/**
+ * @brief The EventQueue class, runs events in (tick, priority) order.
+ *
+ * A tick is one step of the simulator loop. Agents that have nothing to
+ * do are not scheduled, and agents waiting on others are woken by them,
+ * rather than polling every tick.
+ */
+class EventQueue
+{
+
+public:
+
+    /**
+     * @brief EventQueue
+     */
+    EventQueue();
+
+    /**
+     * @brief schedule
+     * @param event
+     * @param when
+     */
+    void schedule(Event *event, uint64_t when);
+
+    /**
+     * @brief wake
+     * @param event
+     */
+    void wake(Event *event);
+
+    /**
+     * @brief service_one, runs the next event
+     */
+    void service_one();
+
+    /**
+     * @brief empty
+     * @return
+     */
+    bool empty() const {
+        return events.empty();
+    }
+
+    /**
+     * @brief get_tick
+     * @return
+     */
+    uint64_t get_tick() const {
+        return cur_tick;
+    }
+
+private:
+
+    /**
+     * @brief The entry_t struct
+     */
+    struct entry_t {
+        //
+        uint64_t when;
+        //
+        int priority;
+        //
+        Event *event;
+
+        //
+        bool operator>(const entry_t &other) const {
+            return when > other.when ||
+                (when == other.when && priority > other.priority);
+        }
+    };
+
+    /**
+     * @brief events, earliest first
+     */
+    std::priority_queue<entry_t, std::vector<entry_t>,
+                        std::greater<entry_t>> events;
+
+    /**
+     * @brief cur_tick
+     */
+    uint64_t cur_tick;
+
+    /**
+     * @brief cur_priority, priority of the running event
+     */
+    int cur_priority;
+
+};
+
+} // end namespace analyzer
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_ANALYZER_EVENT_QUEUE_HH__
@@ -1,5 +1,8 @@
+#include <climits>
+
 #include "analyzer/cpu.hh"
 #include "analyzer/gpu.hh"
+#include "analyzer/instance.hh"
 
 #include "debug_impl.hh"
 
@@ -11,62 +14,90 @@ namespace analyzer {
 GPU::GPU(const Json::Value &params,
     GlTraceSimAnalyzer *simulator, schedular::SchedularPtr schedular) :
     simulator(simulator), schedular(schedular), barrier_id(0),
-    core_state(Core::RuntimeState::IDLE), state(PROCESS_CMD)
+    running_cores(0), state(PROCESS_CMD),
+    tick_event(&simulator->events, INT_MAX, [this] { tick(); })
 {
     //
     ProtoMessage::PacketHeader hdr;
 
     pb.gpu = new ProtoInputStream(
-        params["input-dir"].asString() + "/gpu.pb.gz"
+        ProtoStream::find(params["input-dir"].asString() + "/gpu")
     );
 
     //
     pb.gpu->read(hdr);
+    //
+    pb.cmds = new ProtoBatchReader<ProtoMessage::Packet>(
+        pb.gpu, params.get("cmd-batch-size", 256).asUInt()
+    );
 
     DPRINTF(Init, "GPU CMD File Header [id:%s, ver:%i, tick_freq:%lu].\n",
         hdr.obj_id().c_str(), hdr.ver(), hdr.tick_freq()
     );
 
     //
-    for (int core_id = 0;
-         core_id < params["num-gpu-cores"].asInt();
-         ++core_id)
-    {
-        Json::Value p;
-        p["id"] = core_id + 1; // 0 == CPU
-        p["dev"] = dev::GPU;
-
+    for (auto instance: simulator->instances) {
         //
-        cores.push_back(CorePtr(new Core(p, simulator, schedular)));
+        for (auto &core: instance->gpu_cores) {
+            //
+            size_t core_id = cores.size();
+
+            //
+            cores.push_back(core.get());
+
+            // Cores tick after the CPU and before the GPU, in order
+            core_events.push_back(std::unique_ptr<Event>(
+                new Event(&simulator->events, core_id + 1,
+                    [this, core_id] { tick_core(core_id); })
+            ));
+        }
     }
+
+    //
+    tick_event.schedule(0);
 }
 
 GPU::~GPU()
 {
+    delete pb.cmds;
     delete pb.gpu;
 }
 
 
 void
-GPU::tick_cores()
+GPU::start_cores()
+{
+    //
+    running_cores = cores.size();
+
+    //
+    for (auto &event: core_events) {
+        event->schedule_next();
+    }
+
+    // No cores to wait for
+    if (_u(running_cores == 0)) {
+        tick_event.schedule_next();
+    }
+}
+
+void
+GPU::tick_core(size_t core_id)
 {
     //
-    bool is_running = false;
+    cores[core_id]->tick();
 
     //
-    for (size_t core_id = 0; core_id < cores.size(); ++core_id) {
+    if (_l(cores[core_id]->get_state() == Core::RuntimeState::RUNNING)) {
         //
-        cores[core_id]->tick();
+        core_events[core_id]->schedule_next();
         //
-        is_running |=
-            (cores[core_id]->get_state() == Core::RuntimeState::RUNNING);
+        return;
     }
 
-    //
-    if (_l(is_running)) {
-        core_state = Core::RuntimeState::RUNNING;
-    } else {
-        core_state = Core::RuntimeState::IDLE;
+    // Idle until the next drain, the last core wakes the GPU
+    if (--running_cores == 0) {
+        tick_event.wake();
     }
 }
 
@@ -91,6 +122,8 @@ GPU::tick()
         default: assert(0);
         }
 
+        //
+        tick_event.schedule_next();
         //
         return;
     }
@@ -98,13 +131,8 @@ GPU::tick()
     case D_END_SCENE_SYNC:
     case D_FRAME_SYNC:
     {
-        // Advance cores
-        tick_cores();
-
-        // Wait for all cores
-        if (_l(core_state == Core::RuntimeState::RUNNING)) {
-            return;
-        }
+        // Woken by the last core going idle
+        assert(running_cores == 0);
 
         //
         schedular->set_gpu_ready(++barrier_id);
@@ -118,6 +146,9 @@ GPU::tick()
         default: assert(0);
         }
 
+        //
+        tick_event.schedule_next();
+        //
         return;
     }
     case W_SYNC:
@@ -126,14 +157,19 @@ GPU::tick()
     case W_END_SCENE_SYNC:
     case W_FRAME_SYNC:
     {
-        // Wait for CPU barrier
+        // Sleep until the CPU reaches the barrier
         if (_l(schedular->is_cpu_ready(barrier_id) == false)) {
+            //
+            schedular->wait_cpu_ready(&tick_event);
+            //
             return;
         }
 
         //
         state = PROCESS_CMD;
 
+        //
+        tick_event.schedule_next();
         //
         return;
     }
@@ -144,15 +180,18 @@ GPU::tick()
     default: assert(0);
     }
 
-    //
-    ProtoMessage::Packet pkt;
-
     // Next Packet
-    if (_u(pb.gpu->read(pkt) == false)) {
+    const ProtoMessage::Packet *next_pkt = pb.cmds->next();
+
+    //
+    if (_u(next_pkt == NULL)) {
         //
         return;
     }
 
+    //
+    const ProtoMessage::Packet &pkt = *next_pkt;
+
     // Next state
     switch (pkt.cmd())
     {
@@ -160,6 +199,8 @@ GPU::tick()
     {
         //
         state = D_NEW_SCENE_SYNC;
+        // Drain the cores from the next tick
+        start_cores();
         //
         return;
     }
@@ -167,12 +208,16 @@ GPU::tick()
     {
         //
         state = D_NEW_SCENE_SYNC;
+        // Drain the cores from the next tick
+        start_cores();
         //
         return;
     }
     case gem5::NewJobCMD:
     case gem5::EndJobCMD:
     {
+        //
+        tick_event.schedule_next();
         //
         return;
     }
@@ -182,6 +227,8 @@ GPU::tick()
         //
         state = D_RSC_SYNC;
         //
+        tick_event.schedule_next();
+        //
         return;
     }
     case gem5::SyncProvidesCMD:
@@ -191,12 +238,16 @@ GPU::tick()
         //
         state = D_SYNC;
         //
+        tick_event.schedule_next();
+        //
         return;
     }
     case gem5::NewFrameCMD:
     {
         //
         state = D_FRAME_SYNC;
+        // Drain the cores from the next tick
+        start_cores();
         //
         return;
     }
@@ -10,6 +10,7 @@
 #include "job.hh"
 
 #include "analyzer/core.hh"
+#include "analyzer/event_queue.hh"
 #include "analyzer/schedular/base.hh"
 
 namespace gltracesim {
@@ -41,35 +42,18 @@ public:
      */
     void tick();
 
-    /**
-     * @brief get_core
-     * @param core_id
-     * @return
-     */
-    Core* get_core(int core_id) {
-        return cores[core_id].get();
-    }
-
-    /**
-     * @brief num_cores
-     * @return
-     */
-    size_t num_cores() const {
-        return cores.size();
-    }
-
 private:
 
     /**
-     * @brief sync
-     * @return
+     * @brief start_cores, schedules all cores to drain the job queue
      */
-    bool sync();
+    void start_cores();
 
     /**
-     * @brief tick
+     * @brief tick_core
+     * @param core_id
      */
-    void tick_cores();
+    void tick_core(size_t core_id);
 
 private:
 
@@ -78,6 +62,7 @@ private:
      */
     struct proto_t {
         ProtoInputStream *gpu;
+        ProtoBatchReader<ProtoMessage::Packet> *cmds;
     } pb;
 
     /**
@@ -86,7 +71,7 @@ private:
     GlTraceSimAnalyzer *simulator;
 
     /**
-     * @brief schedular
+     * @brief schedular, holds the CPU/GPU barriers
      */
     schedular::SchedularPtr schedular;
 
@@ -96,9 +81,10 @@ private:
     uint64_t barrier_id;
 
     /**
-     * @brief state
+     * @brief running_cores, cores that did not go idle since the start of
+     * the drain
      */
-    Core::RuntimeState core_state;
+    size_t running_cores;
 
     enum RuntimeState {
         PROCESS_CMD,
@@ -117,9 +103,19 @@ private:
     RuntimeState state;
 
     /**
-     * @brief gpu
+     * @brief tick_event, the GPU ticks after its cores
+     */
+    Event tick_event;
+
+    /**
+     * @brief cores of all instances, owned by the instances
+     */
+    std::vector<Core*> cores;
+
+    /**
+     * @brief core_events
      */
-    std::vector<CorePtr> cores;
+    std::vector<std::unique_ptr<Event>> core_events;
 
 };
 
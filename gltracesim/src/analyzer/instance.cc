@@ -0,0 +1,637 @@
+#include <sys/stat.h>
+
+#include "analyzer/instance.hh"
+#include "analyzer/model_threads.hh"
+#include "analyzer/private_models.hh"
+
+#include "analyzer/schedular/fcfs.hh"
+#include "analyzer/schedular/z.hh"
+#include "analyzer/schedular/random.hh"
+
+#include "debug_impl.hh"
+#include "system.hh"
+
+#include "gltracesim_analyzer.hh"
+
+namespace gltracesim {
+namespace analyzer {
+
+/**
+ * @brief create_model
+ * @param builder
+ * @param params
+ * @return
+ */
+static AnalyzerPtr
+create_model(AnalyzerBuilder *builder, const Json::Value &params)
+{
+    //
+    AnalyzerPtr analyzer = builder->create(params);
+
+    // Invalid parameters, e.g. an unknown replacement policy
+    if (analyzer == NULL) {
+        //
+        DPRINTF(Error, "Failed to create analyzer (%s).\n",
+            params["type"].asCString()
+        );
+        //
+        exit(EXIT_FAILURE);
+    }
+
+    //
+    return analyzer;
+}
+
+Instance::Instance(Json::Value &config, GlTraceSimAnalyzer *simulator,
+    size_t id) :
+    id(id), model_threads(NULL)
+{
+    //
+    name = config.get("name", "").asString();
+
+    //
+    batch_size = config.get("batch-size", 4096).asUInt();
+    //
+    assert(batch_size);
+
+    //
+    ::mkdir(config["output-dir"].asCString(), 0755);
+
+    //
+    ProtoMessage::PacketHeader hdr;
+
+    pb.stats = new ProtoOutputStream(
+        ProtoStream::filename(config["output-dir"].asString() + "/stats")
+    );
+
+    //
+    hdr.set_obj_id("gltracesim-stats");
+    hdr.set_ver(0);
+    hdr.set_tick_freq(1);
+
+    //
+    pb.stats->write(hdr);
+
+    // CPU and GPU cores, private models have a copy per core
+    size_t num_cores = config.get("num-gpu-cores", 1).asInt() + 1;
+
+    //
+    for (unsigned i = 0; i < config["models"].size(); ++i) {
+        //
+        Json::Value &params = config["models"][i];
+        //
+        params["output-dir"] = config["output-dir"];
+        params["benchmark-name"] = config["benchmark-name"];
+
+        //
+        AnalyzerBuilder* builder = gltracesim::Analyzer::find_builder(
+            params["type"].asCString()
+        );
+
+        //
+        if (builder == NULL) {
+            //
+            DPRINTF(Init, "No such analyzer (%s).\n",
+                params["type"].asCString()
+            );
+            //
+            exit(EXIT_FAILURE);
+        }
+
+        DPRINTF(Init, "Loading Analyzer (%s).\n", builder->get_name().c_str());
+
+        //
+        AnalyzerPtr analyzer;
+
+        //
+        if (params.get("private", false).asBool()) {
+            //
+            std::vector<AnalyzerPtr> models;
+            //
+            for (size_t core = 0; core < num_cores; ++core) {
+                //
+                Json::Value core_params = params;
+                //
+                core_params["core"] = Json::UInt64(core);
+                //
+                models.push_back(create_model(builder, core_params));
+            }
+            //
+            analyzer = AnalyzerPtr(new PrivateModels(params, models));
+        } else {
+            analyzer = create_model(builder, params);
+        }
+
+        //
+        analyzers.push_back(analyzer);
+        //
+        analyzer_names.push_back(
+            builder->get_name() + "." + std::to_string(analyzer->get_id())
+        );
+    }
+
+    //
+    bool shared = connect_models(config["models"]);
+
+    // One thread per hierarchy, models with a shared mem side are called
+    // from the threads of all their core sides
+    if (config.get("model-threads", roots.size() > 1 && !shared).asBool()) {
+        //
+        if (shared) {
+            //
+            DPRINTF(Warn, "Instance %lu has a shared mem-side model, "
+                "model threads disabled.\n", id
+            );
+        } else {
+            //
+            std::vector<AnalyzerPtr> root_models;
+            //
+            for (size_t i: roots) {
+                root_models.push_back(analyzers[i]);
+            }
+            //
+            model_threads = new ModelThreads(
+                root_models, config.get("model-queue-size", 16).asUInt()
+            );
+        }
+    }
+
+    //
+    auto schedular_type = config["schedular"].get("type", "fcfs").asString();
+    //
+    config["schedular"]["output-dir"] = config["output-dir"];
+
+    if (schedular_type == "fcfs") {
+        schedular = schedular::SchedularPtr(
+            new schedular::FCFSSchedular(
+                config["schedular"]
+            )
+        );
+    } else if (schedular_type == "z") {
+        schedular = schedular::SchedularPtr(
+            new schedular::ZSchedular(
+                config["schedular"]
+            )
+        );
+    } else if (schedular_type == "r") {
+        schedular = schedular::SchedularPtr(
+            new schedular::RandomSchedular(
+                config["schedular"]
+            )
+        );
+    } else {
+        assert(0);
+    }
+
+    // Create CPU core
+    {
+        Json::Value p;
+        p["id"] = 0;
+        p["dev"] = dev::CPU;
+
+        //
+        cpu_core = CorePtr(new Core(p, simulator, this));
+    }
+
+    //
+    for (int core_id = 0;
+         core_id < config.get("num-gpu-cores", 1).asInt();
+         ++core_id)
+    {
+        Json::Value p;
+        p["id"] = core_id + 1; // 0 == CPU
+        p["dev"] = dev::GPU;
+
+        //
+        gpu_cores.push_back(CorePtr(new Core(p, simulator, this)));
+    }
+
+    //
+    DPRINTF(Init, "Instance [id: %lu, name: %s, models: %lu, cores: %lu, "
+        "output-dir: %s].\n",
+        id, name.c_str(), analyzers.size(), gpu_cores.size(),
+        config["output-dir"].asCString()
+    );
+}
+
+Instance::~Instance()
+{
+    delete model_threads;
+    delete pb.stats;
+}
+
+bool
+Instance::connect_models(const Json::Value &models)
+{
+    // Mem side of every model, -1 for none
+    std::vector<int> mem_side(analyzers.size(), -1);
+    // Core sides of every model
+    std::vector<size_t> num_core_sides(analyzers.size(), 0);
+
+    //
+    for (size_t i = 0; i < analyzers.size(); ++i) {
+        //
+        if (models[int(i)].isMember("mem-side") == false) {
+            continue;
+        }
+
+        //
+        int mem_side_id = models[int(i)]["mem-side"].asInt();
+
+        //
+        for (size_t j = 0; j < analyzers.size(); ++j) {
+            //
+            if (analyzers[j]->get_id() != mem_side_id) {
+                continue;
+            }
+            //
+            if (mem_side[i] >= 0 || j == i) {
+                //
+                DPRINTF(Error, "Mem side %i of %s is not a unique other "
+                    "model.\n", mem_side_id, analyzer_names[i].c_str()
+                );
+                //
+                exit(EXIT_FAILURE);
+            }
+            //
+            mem_side[i] = j;
+        }
+
+        //
+        if (mem_side[i] < 0) {
+            //
+            DPRINTF(Error, "No mem side %i for %s.\n",
+                mem_side_id, analyzer_names[i].c_str()
+            );
+            //
+            exit(EXIT_FAILURE);
+        }
+
+        //
+        num_core_sides[mem_side[i]]++;
+    }
+
+    //
+    for (size_t i = 0; i < analyzers.size(); ++i) {
+        // A chain longer than the models is a cycle
+        size_t depth = 0;
+        //
+        for (int j = mem_side[i]; j >= 0; j = mem_side[j]) {
+            //
+            if (++depth > analyzers.size()) {
+                //
+                DPRINTF(Error, "Mem sides of %s form a cycle.\n",
+                    analyzer_names[i].c_str()
+                );
+                //
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    //
+    bool shared = false;
+
+    //
+    for (size_t i = 0; i < analyzers.size(); ++i) {
+        //
+        if (mem_side[i] >= 0) {
+            //
+            analyzers[i]->add_child_analyzer(analyzers[mem_side[i]].get());
+            //
+            DPRINTF(Init, "Mem side of %s: %s.\n",
+                analyzer_names[i].c_str(),
+                analyzer_names[mem_side[i]].c_str()
+            );
+        }
+
+        // Models with a core side only see its misses and writebacks
+        if (num_core_sides[i] == 0) {
+            roots.push_back(i);
+        }
+
+        //
+        shared |= num_core_sides[i] > 1;
+    }
+
+    //
+    return shared;
+}
+
+void
+Instance::send_packets(const replay_batch_t &pkts)
+{
+    //
+    telemetry.scene_pkts += pkts.n;
+
+    //
+    if (model_threads) {
+        model_threads->send_packets(pkts);
+        //
+        return;
+    }
+
+    // The rest of a hierarchy gets the misses of its core side
+    for (size_t i: roots) {
+        //
+        analyzers[i]->process_timed_batch(pkts);
+    }
+}
+
+void
+Instance::sync_models()
+{
+    //
+    if (model_threads) {
+        model_threads->sync();
+    }
+}
+
+void
+Instance::start_new_frame(int frame_id)
+{
+    //
+    for (auto &analyzer: analyzers) {
+        //
+        analyzer->start_new_frame(frame_id);
+    }
+
+    //
+    schedular->start_new_frame(frame_id);
+
+    //
+    telemetry.frame_start = read_cycles();
+}
+
+void
+Instance::start_new_scene(int frame_id, int scene_id)
+{
+    //
+    for (auto &analyzer: analyzers) {
+        //
+        analyzer->start_new_scene(frame_id, scene_id);
+    }
+
+    //
+    schedular->start_new_scene(frame_id, scene_id);
+
+    //
+    telemetry.scene_start = read_cycles();
+    telemetry.scene_pkts = 0;
+}
+
+void
+Instance::end_scene(bool dump)
+{
+    //
+    uint64_t start = read_cycles();
+
+    //
+    gltracesim::proto::SceneTelemetry *scene = telemetry.pb.add_scenes();
+    //
+    scene->set_id(system->get_scene_nbr());
+    scene->set_cycles(start - telemetry.scene_start);
+    scene->set_pkts(telemetry.scene_pkts);
+
+    //
+    for (auto &analyzer: analyzers) {
+        //
+        if (dump) {
+            analyzer->dump_stats();
+        }
+        //
+        analyzer->reset_stats();
+    }
+
+    //
+    telemetry.dump_cycles.add(read_cycles() - start, dump);
+}
+
+void
+Instance::end_frame(const gltracesim::proto::Frame &frame, bool dump)
+{
+    // Time scaling factor
+    double tsf = 1.0 / (frame.sim_stats().duration() * 1048576);
+
+    size_t tot_pkts = cpu_core->stats.no_pkts;
+    size_t tot_jobs = cpu_core->stats.no_jobs;
+
+    for (auto &core: gpu_cores) {
+        tot_jobs += core->stats.no_jobs;
+        tot_pkts += core->stats.no_pkts;
+    }
+
+    //
+    DPRINTF(GpuFrameEvent,
+        "Frame: %lu [%sjobs: %lu, pkts: %lu, %.2fM/s, duration: %fs]\n",
+        frame.id(), name.empty() ? "" : (name + ", ").c_str(),
+        tot_jobs, tot_pkts, tot_pkts * tsf,
+        frame.sim_stats().duration()
+    );
+
+    //
+    DPRINTF(GpuFrameEvent, "  CPU: [jobs: %lu, pkts: %lu, %.2fM/s]\n",
+        cpu_core->stats.no_jobs,
+        cpu_core->stats.no_pkts,
+        cpu_core->stats.no_pkts * tsf
+    );
+
+    //
+    cpu_core->stats.no_jobs = 0;
+    cpu_core->stats.no_pkts = 0;
+
+    //
+    for (size_t core_id = 0; core_id < gpu_cores.size(); ++core_id) {
+        //
+        Core *core = gpu_cores[core_id].get();
+
+        //
+        DPRINTF(GpuFrameEvent,
+            "  GPU core: %3i [jobs: %lu, pkts: %lu, %.2fM/s]\n",
+            core_id,
+            core->stats.no_jobs,
+            core->stats.no_pkts,
+            core->stats.no_pkts * tsf
+        );
+
+        core->stats.no_jobs = 0;
+        core->stats.no_pkts = 0;
+    }
+
+    //
+    if (dump) {
+        //
+        gltracesim::proto::Frame pb_frame = frame;
+        //
+        dump_telemetry(pb_frame);
+        //
+        pb.stats->write(pb_frame);
+    }
+
+    //
+    schedule_cycles.reset();
+    telemetry.dump_cycles.reset();
+    telemetry.pb.Clear();
+    //
+    for (auto &analyzer: analyzers) {
+        analyzer->process_cycles.reset();
+    }
+}
+
+void
+Instance::save_checkpoint(ProtoOutputStream *os)
+{
+    //
+    gltracesim::proto::InstanceCheckpoint ckpt;
+    //
+    ckpt.set_name(name);
+    ckpt.set_num_models(analyzers.size());
+    //
+    os->write(ckpt);
+
+    //
+    for (size_t i = 0; i < analyzers.size(); ++i) {
+        //
+        gltracesim::proto::ModelCheckpoint model;
+        //
+        model.set_name(analyzer_names[i]);
+        //
+        os->write(model);
+
+        //
+        analyzers[i]->save_state(os);
+    }
+}
+
+bool
+Instance::restore_checkpoint(ProtoInputStream *is)
+{
+    //
+    gltracesim::proto::InstanceCheckpoint ckpt;
+
+    //
+    if (is->read(ckpt) == false || ckpt.num_models() != analyzers.size()) {
+        //
+        DPRINTF(Error, "Checkpoint does not match instance %lu [models: "
+            "%u, expected: %lu].\n",
+            id, ckpt.num_models(), analyzers.size()
+        );
+        //
+        return false;
+    }
+
+    // Branches of a sweep may rename the instances, not the models
+    for (size_t i = 0; i < analyzers.size(); ++i) {
+        //
+        gltracesim::proto::ModelCheckpoint model;
+
+        //
+        if (is->read(model) == false || model.name() != analyzer_names[i]) {
+            //
+            DPRINTF(Error, "Checkpoint does not match instance %lu [model: "
+                "%s, expected: %s].\n",
+                id, model.name().c_str(), analyzer_names[i].c_str()
+            );
+            //
+            return false;
+        }
+
+        //
+        if (analyzers[i]->restore_state(is) == false) {
+            //
+            DPRINTF(Error, "Failed to restore %s of instance %lu.\n",
+                analyzer_names[i].c_str(), id
+            );
+            //
+            return false;
+        }
+    }
+
+    //
+    return true;
+}
+
+/**
+ * @brief add_stage
+ * @param pb
+ * @param name
+ * @param counter
+ * @param cycle_freq
+ */
+static void
+add_stage(google::protobuf::RepeatedPtrField<gltracesim::proto::StageStats>
+    *pb, const std::string &name, const CycleCounter &counter,
+    double cycle_freq)
+{
+    //
+    gltracesim::proto::StageStats *stage = pb->Add();
+    //
+    stage->set_name(name);
+    stage->set_cycles(counter.get_cycles());
+    stage->set_calls(counter.get_calls());
+    stage->set_items(counter.get_items());
+    //
+    if (counter.get_cycles()) {
+        stage->set_items_per_sec(
+            counter.get_items() * cycle_freq / counter.get_cycles()
+        );
+    }
+}
+
+void
+Instance::dump_telemetry(gltracesim::proto::Frame &frame)
+{
+    //
+    gltracesim::proto::Telemetry *pb = frame.mutable_telemetry();
+
+    //
+    *pb = telemetry.pb;
+
+    //
+    uint64_t frame_cycles = read_cycles() - telemetry.frame_start;
+    //
+    double cycle_freq = frame.sim_stats().duration() > 0 ?
+        frame_cycles / frame.sim_stats().duration() : 0;
+
+    //
+    pb->set_cycle_freq(cycle_freq);
+    pb->set_frame_cycles(frame_cycles);
+
+    //
+    add_stage(pb->mutable_stages(), "decode",
+        GpuJob::decode_cycles, cycle_freq);
+    add_stage(pb->mutable_stages(), "schedule",
+        schedule_cycles, cycle_freq);
+    add_stage(pb->mutable_stages(), "dump",
+        telemetry.dump_cycles, cycle_freq);
+
+    // The time of a hierarchy is accounted to its root
+    for (size_t i: roots) {
+        add_stage(pb->mutable_models(), analyzer_names[i],
+            analyzers[i]->process_cycles, cycle_freq);
+    }
+
+    //
+    DPRINTF(Telemetry, "Frame: %lu [%sdecode: %.1f%%, schedule: %.1f%%, "
+        "dump: %.1f%%, scenes: %i]\n",
+        frame.id(), name.empty() ? "" : (name + ", ").c_str(),
+        100.0 * GpuJob::decode_cycles.get_cycles() / frame_cycles,
+        100.0 * schedule_cycles.get_cycles() / frame_cycles,
+        100.0 * telemetry.dump_cycles.get_cycles() / frame_cycles,
+        pb->scenes_size()
+    );
+
+#ifdef __GLTRACESIM_DEBUG_ON__
+    //
+    for (auto &model: pb->models()) {
+        DPRINTF(Telemetry, "  Model: %s [%.1f%%, %.2fM pkts/s]\n",
+            model.name().c_str(),
+            100.0 * model.cycles() / frame_cycles,
+            model.items_per_sec() / 1048576
+        );
+    }
+#endif
+}
+
+} // end namespace analyzer
+} // end namespace gltracesim
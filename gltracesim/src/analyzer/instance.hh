@@ -0,0 +1,217 @@
+#ifndef __GLTRACESIM_ANALYZER_INSTANCE_HH__
+#define __GLTRACESIM_ANALYZER_INSTANCE_HH__
+
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+#include "analyzer.hh"
+#include "packet.hh"
+
+#include "util/cycle_counter.hh"
+
+#include "analyzer/core.hh"
+#include "analyzer/schedular/base.hh"
+
+#include "gem5/protoio.hh"
+#include "gltracesim.pb.h"
+
+namespace gltracesim {
+
+class GlTraceSimAnalyzer;
+
+namespace analyzer {
+
+class ModelThreads;
+
+/**
+ * @brief The Instance class, one configuration of a session: its models,
+ * schedular and cores, writing to its own output directory.
+ *
+ * All instances of a session replay the same command streams and job
+ * traces. The simulator processes the commands once and every instance
+ * schedules the jobs of a scene on its own cores, so job traces are
+ * decoded once and fanned out to the instances.
+ */
+class Instance
+{
+
+public:
+
+    /**
+     * @brief Instance
+     * @param config session config with the overrides of the instance
+     * @param simulator
+     * @param id index in the session, also the replay of the job traces
+     */
+    Instance(Json::Value &config, GlTraceSimAnalyzer *simulator,
+        size_t id);
+
+    /**
+     * @brief ~Instance
+     */
+    ~Instance();
+
+public:
+
+    /**
+     * @brief send_packets to the models
+     * @param pkts
+     */
+    void send_packets(const replay_batch_t &pkts);
+
+    /**
+     * @brief sync_models, waits until the models processed all packets
+     * sent
+     */
+    void sync_models();
+
+    /**
+     * @brief start_new_frame
+     * @param frame_id
+     */
+    void start_new_frame(int frame_id);
+
+    /**
+     * @brief start_new_scene
+     * @param frame_id
+     * @param scene_id
+     */
+    void start_new_scene(int frame_id, int scene_id);
+
+    /**
+     * @brief end_scene
+     * @param dump false if the stats are discarded
+     */
+    void end_scene(bool dump);
+
+    /**
+     * @brief end_frame, prints and resets the core stats
+     * @param frame
+     * @param dump false if the frame is not written
+     */
+    void end_frame(const gltracesim::proto::Frame &frame, bool dump);
+
+    /**
+     * @brief save_checkpoint, writes the state of the models
+     * @param os
+     */
+    void save_checkpoint(ProtoOutputStream *os);
+
+    /**
+     * @brief restore_checkpoint, reads the state written by
+     * save_checkpoint into models of the same types
+     * @param is
+     * @return false if the checkpoint does not match the models
+     */
+    bool restore_checkpoint(ProtoInputStream *is);
+
+public:
+
+    /**
+     * @brief id
+     */
+    size_t id;
+
+    /**
+     * @brief name
+     */
+    std::string name;
+
+    /**
+     * @brief batch_size, packets a core replays per tick
+     */
+    size_t batch_size;
+
+    /**
+     * @brief schedular
+     */
+    schedular::SchedularPtr schedular;
+
+    /**
+     * @brief cpu_core
+     */
+    CorePtr cpu_core;
+
+    /**
+     * @brief gpu_cores
+     */
+    std::vector<CorePtr> gpu_cores;
+
+    /**
+     * @brief schedule_cycles, time spent by the cores getting jobs, items
+     * are jobs
+     */
+    CycleCounter schedule_cycles;
+
+private:
+
+    /**
+     * @brief connect_models, sends the misses and writebacks of every
+     * model with a "mem-side" id to that model
+     * @param models config of the models
+     * @return true if a model has several core side models
+     */
+    bool connect_models(const Json::Value &models);
+
+    /**
+     * @brief dump_telemetry, adds the stage times of the frame to it and
+     * resets them
+     * @param frame
+     */
+    void dump_telemetry(gltracesim::proto::Frame &frame);
+
+    /**
+     * @brief The telemetry_t struct, analyzer time of the current frame
+     */
+    struct telemetry_t {
+        //
+        telemetry_t() : frame_start(0), scene_start(0), scene_pkts(0) {}
+
+        //
+        uint64_t frame_start;
+        //
+        uint64_t scene_start;
+        //
+        uint64_t scene_pkts;
+        //
+        CycleCounter dump_cycles;
+        //
+        gltracesim::proto::Telemetry pb;
+    } telemetry;
+
+    /**
+     * @brief The proto_t struct
+     */
+    struct proto_t {
+        ProtoOutputStream *stats;
+    } pb;
+
+    /**
+     * Analyzers that will be analyzed
+     */
+    std::vector<AnalyzerPtr> analyzers;
+
+    /**
+     * @brief analyzer_names, type and id of the analyzers
+     */
+    std::vector<std::string> analyzer_names;
+
+    /**
+     * @brief roots, analyzers without a core side model, they get the
+     * packets of the cores
+     */
+    std::vector<size_t> roots;
+
+    /**
+     * @brief model_threads, NULL when the models run on the simulator
+     * loop
+     */
+    ModelThreads *model_threads;
+
+};
+
+} // end namespace analyzer
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_ANALYZER_INSTANCE_HH__
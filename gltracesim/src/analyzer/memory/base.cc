@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <sstream>
 
 #include "analyzer/memory/base.hh"
 #include "gem5/packet.pb.h"
+#include "gltracesim.pb.h"
 #include "debug_impl.hh"
 
 namespace gltracesim {
@@ -22,21 +24,26 @@ BaseModel::BaseModel(const Json::Value &p) :
     std::stringstream basename;
     basename << params["output-dir"].asCString() << "/" << id;
 
+    // Private copy of a model, one per core
+    if (params.isMember("core")) {
+        basename << ".core" << params["core"].asInt();
+    }
+
     //
     pb.stats = new ProtoOutputStream(
-        basename.str() + ".stats.pb.gz"
+        ProtoStream::filename(basename.str() + ".stats")
     );
     //
     pb.job_stats = new ProtoOutputStream(
-        basename.str() + ".job_stats.pb.gz"
+        ProtoStream::filename(basename.str() + ".job_stats")
     );
     //
     pb.core_stats = new ProtoOutputStream(
-        basename.str() + ".core_stats.pb.gz"
+        ProtoStream::filename(basename.str() + ".core_stats")
     );
     //
     pb.rsc_stats = new ProtoOutputStream(
-        basename.str() +  ".rsc_stats.pb.gz"
+        ProtoStream::filename(basename.str() + ".rsc_stats")
     );
 
     //
@@ -59,6 +66,50 @@ BaseModel::~BaseModel()
     DPRINTF(Init, "-BaseAnalyzer [id: %i].\n", id);
 }
 
+void
+BaseModel::save_blks(ProtoOutputStream *os, const std::vector<uint64_t> &blks)
+{
+    //
+    for (size_t i = 0; i < blks.size(); i += CHECKPOINT_CHUNK) {
+        //
+        gltracesim::proto::CheckpointBlocks chunk;
+        //
+        size_t n = std::min(CHECKPOINT_CHUNK, blks.size() - i);
+        //
+        chunk.mutable_blks()->Reserve(n);
+        //
+        for (size_t j = i; j < i + n; ++j) {
+            chunk.add_blks(blks[j]);
+        }
+        //
+        os->write(chunk);
+    }
+}
+
+bool
+BaseModel::restore_blks(ProtoInputStream *is, size_t n,
+    std::vector<uint64_t> &blks)
+{
+    //
+    blks.clear();
+    blks.reserve(n);
+
+    //
+    while (blks.size() < n) {
+        //
+        gltracesim::proto::CheckpointBlocks chunk;
+        //
+        if (is->read(chunk) == false || chunk.blks_size() == 0) {
+            return false;
+        }
+        //
+        blks.insert(blks.end(), chunk.blks().begin(), chunk.blks().end());
+    }
+
+    //
+    return blks.size() == n;
+}
+
 } // end namespace memory
 } // end namespace analyzer
 } // end namespace gltracesim
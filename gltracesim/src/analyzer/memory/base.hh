@@ -1,6 +1,8 @@
 #ifndef __GLTRACESIM_ANALYZER_MEMORY_BASE_HH__
 #define __GLTRACESIM_ANALYZER_MEMORY_BASE_HH__
 
+#include <vector>
+
 #include "analyzer.hh"
 #include <json/json.h>
 
@@ -51,6 +53,32 @@ public:
      */
     virtual void reset_stats() = 0;
 
+protected:
+
+    /**
+     * @brief save_blks, writes block addresses in chunks
+     * @param os
+     * @param blks
+     */
+    static void save_blks(ProtoOutputStream *os,
+                          const std::vector<uint64_t> &blks);
+
+    /**
+     * @brief restore_blks, reads the chunks written by save_blks
+     * @param is
+     * @param n blocks written
+     * @param blks
+     * @return false if the stream ends early
+     */
+    static bool restore_blks(ProtoInputStream *is, size_t n,
+                             std::vector<uint64_t> &blks);
+
+    /**
+     * @brief Entries per checkpoint message, well below the message
+     * size limit of the streams
+     */
+    static const size_t CHECKPOINT_CHUNK = 65536;
+
 protected:
 
     /**
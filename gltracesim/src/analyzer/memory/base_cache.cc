@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 
 #include "analyzer/memory/base_cache.pb.h"
@@ -20,33 +21,54 @@ struct BaseCacheModelBuilder : public gltracesim::AnalyzerBuilder
     }
 
     AnalyzerPtr create(const Json::Value &params) {
-        return AnalyzerPtr(new BaseCacheModel(params));
+        return create_cache_model<BaseCacheModel>(params);
     }
 };
 
 //
 BaseCacheModelBuilder vanilla_cache_analyzer_builder;
 
-BaseCacheModel::Cache::Cache(params_t *p) : Base(p)
+template <class policy_t>
+BaseCacheModel<policy_t>::Cache::Cache(params_t *p) : Base(p)
 {
-    for (size_t blk_idx = 0; blk_idx < no_blks; ++blk_idx) {
+    for (size_t blk_idx = 0; blk_idx < this->no_blks; ++blk_idx) {
         //
-        entry_t &ce = data[blk_idx];
+        entry_t &ce = this->data[blk_idx];
         //
         ce.last_frame_nbr = 0;
         //
-        ce.sub_blk_ctrs.resize(no_sub_blks, sat_counter_t(0, 100));
+        ce.sub_blk_ctrs.clear();
     }
 }
 
-BaseCacheModel::BaseCacheModel(const Json::Value &p) :
+template <class policy_t>
+BaseCacheModel<policy_t>::BaseCacheModel(const Json::Value &p) :
     BaseModel(p), tick(0)
 {
     //
     fetch_on_wr_miss = p.get("fetch-on-wr-miss", true).asBool();
 
     //
-    Cache::params_t params;
+    std::string inclusion_name = p.get("inclusion", "nine").asString();
+
+    //
+    if (inclusion_name == "nine") {
+        inclusion = NINE;
+    } else if (inclusion_name == "inclusive") {
+        inclusion = INCLUSIVE;
+    } else if (inclusion_name == "exclusive") {
+        inclusion = EXCLUSIVE;
+    } else {
+        //
+        DPRINTF(Error, "BaseCacheAnalyzer has no inclusion policy %s.\n",
+            inclusion_name.c_str()
+        );
+        //
+        exit(EXIT_FAILURE);
+    }
+
+    //
+    cache_params_t params;
 
     //
     params.size = p["size"].asInt();
@@ -54,13 +76,19 @@ BaseCacheModel::BaseCacheModel(const Json::Value &p) :
     params.blk_size = p.get("blk-size", 64).asInt();
     params.sub_blk_size = p.get("sub-blk-size", 64).asInt();
 
-    DPRINTF(Init, "BaseCacheAnalyzer [id: %i, size: %lu, a: %lu, blk: %lu, sblk: %lu].\n",
-        id, params.size, params.associativity, params.blk_size, params.sub_blk_size
+    DPRINTF(Init, "BaseCacheAnalyzer [id: %i, size: %lu, a: %lu, blk: %lu, sblk: %lu, r: %s].\n",
+        id, params.size, params.associativity, params.blk_size, params.sub_blk_size,
+        p.get("replacement", "lru").asCString()
     );
 
     //
     cache = CachePtr(new Cache(&params));
 
+    // Too many sub-blocks to count in the entries
+    if (cache->no_sub_blks > MAX_SUB_BLKS) {
+        wide_sub_blk_ctrs.assign(cache->no_blks * cache->no_sub_blks, 0);
+    }
+
     //
     blk_utilization.init(0, params.blk_size / params.sub_blk_size, 1);
     blk_reutilization.init(0, params.blk_size / params.sub_blk_size, 1);
@@ -68,24 +96,72 @@ BaseCacheModel::BaseCacheModel(const Json::Value &p) :
     reset_stats();
 }
 
-BaseCacheModel::~BaseCacheModel()
+template <class policy_t>
+BaseCacheModel<policy_t>::~BaseCacheModel()
 {
     DPRINTF(Init, "-BaseCacheAnalyzer [id: %i].\n", id);
 }
 
+template <class policy_t>
 void
-BaseCacheModel::process(const packet_t &pkt)
+BaseCacheModel<policy_t>::process(const packet_t &pkt)
 {
-    // Skip other commands
-    if (_u(pkt.cmd != READ && pkt.cmd != WRITE)) {
+    // Skip other commands, writebacks are clean evictions of the core
+    // side of an exclusive cache
+    if (_u(pkt.cmd != READ && pkt.cmd != WRITE && pkt.cmd != WRITEBACK)) {
         return;
     }
 
+    //
+    access(pkt,
+        job_stats[pkt.job_id], core_stats[pkt.tid], rsc_stats[pkt.rsc_id]
+    );
+}
+
+template <class policy_t>
+void
+BaseCacheModel<policy_t>::process_batch(const replay_batch_t &pkts)
+{
+    // A batch comes from one job on one core, so the stats entries
+    // are looked up when the ids change rather than per packet, the
+    // tables are distinct so the references stay valid
+    stats::Cache *js = NULL, *rs = NULL;
+    //
+    stats::Cache &cs = core_stats[pkts.tid];
+    //
+    int64_t job_id = -1, rsc_id = -1;
+
+    // Replayed packets are reads and writes
+    for (size_t i = 0; i < pkts.n; ++i) {
+        //
+        packet_t pkt = pkts.packet(i);
+
+        //
+        if (_u(js == NULL || job_id != pkt.job_id)) {
+            job_id = pkt.job_id;
+            js = &job_stats[pkt.job_id];
+        }
+        //
+        if (_u(rs == NULL || rsc_id != pkt.rsc_id)) {
+            rsc_id = pkt.rsc_id;
+            rs = &rsc_stats[pkt.rsc_id];
+        }
+
+        //
+        access(pkt, *js, cs, *rs);
+    }
+}
+
+template <class policy_t>
+void
+BaseCacheModel<policy_t>::access(const packet_t &pkt,
+    stats::Cache &js, stats::Cache &cs, stats::Cache &rs)
+{
     // Update time
     ++tick;
 
     //
-    Cache::entry_t *ce, *re;
+    cache_entry_t *ce, *re;
     //
     cache->find(pkt.paddr, ce, re);
 
@@ -93,13 +169,11 @@ BaseCacheModel::process(const packet_t &pkt)
     if (_u(ce)) {
         assert(ce->valid);
 
-        //
-        ce->last_tsc = tick;
         //
         ce->dirty |= (pkt.cmd == WRITE);
 
         //
-        ce->sub_blk_ctrs[cache->get_sub_blk_idx(pkt.paddr)]++;
+        use_sub_blk(ce, pkt.paddr);
 
         // Intra-frame reuse
         if (_l(ce->last_frame_nbr == system->get_frame_nbr())) {
@@ -141,14 +215,19 @@ BaseCacheModel::process(const packet_t &pkt)
         cache_stats.hits[pkt.cmd]++;
         cache_stats.gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
-        job_stats[pkt.job_id].hits[pkt.cmd]++;
-        job_stats[pkt.job_id].gpuside[pkt.cmd] += cache->params.sub_blk_size;
+        js.hits[pkt.cmd]++;
+        js.gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
-        core_stats[pkt.tid].hits[pkt.cmd]++;
-        core_stats[pkt.tid].gpuside[pkt.cmd] += cache->params.sub_blk_size;
+        cs.hits[pkt.cmd]++;
+        cs.gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
-        rsc_stats[pkt.rsc_id].hits[pkt.cmd]++;
-        rsc_stats[pkt.rsc_id].gpuside[pkt.cmd] += cache->params.sub_blk_size;
+        rs.hits[pkt.cmd]++;
+        rs.gpuside[pkt.cmd] += cache->params.sub_blk_size;
+
+        // Exclusive, the block moves to the core side
+        if (_u(inclusion == EXCLUSIVE && pkt.cmd == READ)) {
+            release(pkt, ce, js, cs, rs);
+        }
 
         // Nothing else to do
         return;
@@ -156,16 +235,18 @@ BaseCacheModel::process(const packet_t &pkt)
 
     //
     cache_stats.misses[pkt.cmd]++;
-    job_stats[pkt.job_id].misses[pkt.cmd]++;
-    rsc_stats[pkt.rsc_id].misses[pkt.cmd]++;
+    js.misses[pkt.cmd]++;
+    rs.misses[pkt.cmd]++;
 
-    if (_u((pkt.cmd == WRITE) && fetch_on_wr_miss == false)) {
+    if (_u(pkt.flags & PKT_EVICTION)) {
+        // Eviction of the core side, the whole block, nothing to fetch
+    } else if (_u((pkt.cmd == WRITE) && fetch_on_wr_miss == false)) {
         // Do nothing, only install, no fetch
     } else {
         cache_stats.memside[pkt.cmd] += cache->params.blk_size;
-        job_stats[pkt.job_id].memside[pkt.cmd] += cache->params.blk_size;
-        core_stats[pkt.tid].memside[pkt.cmd] += cache->params.blk_size;
-        rsc_stats[pkt.rsc_id].memside[pkt.cmd] += cache->params.blk_size;
+        js.memside[pkt.cmd] += cache->params.blk_size;
+        cs.memside[pkt.cmd] += cache->params.blk_size;
+        rs.memside[pkt.cmd] += cache->params.blk_size;
 
         // Create a mutible copy
         packet_t apkt = pkt;
@@ -175,6 +256,11 @@ BaseCacheModel::process(const packet_t &pkt)
         send_packet(apkt);
     }
 
+    // Exclusive caches only install core side evictions
+    if (_u(inclusion == EXCLUSIVE && pkt.cmd == READ)) {
+        return;
+    }
+
     // Check if we should bypass
     if (_u(bypass(pkt))) {
         return;
@@ -185,81 +271,166 @@ BaseCacheModel::process(const packet_t &pkt)
 
     // Evict and make room
     if (_l(re->valid)) {
-        cache_stats.evictions++;
-        job_stats[pkt.job_id].evictions++;
-        core_stats[pkt.tid].evictions++;
-        rsc_stats[pkt.rsc_id].evictions++;
-
-        uint8_t touched_sub_blks = 0;
-        uint8_t reused_sub_blks = 0;
-        uint8_t sub_blk_idx = 0;
-        do
-        {
-            //
-            if (_l(re->sub_blk_ctrs[sub_blk_idx].value() > 0))
-            {
-                ++touched_sub_blks;
-                if (_u(re->sub_blk_ctrs[sub_blk_idx].value() > 1)) {
-                    ++reused_sub_blks;
-                }
-                // Clear it for replacement
-                re->sub_blk_ctrs[sub_blk_idx].reset();
-            }
-            //
-            ++sub_blk_idx;
-
-        } while (_u(sub_blk_idx < re->sub_blk_ctrs.size()));
-        //
-        blk_utilization.sample(touched_sub_blks);
-        blk_reutilization.sample(reused_sub_blks);
-
-        //
-        if (_u(re->dirty)) {
-            //
-            cache_stats.writebacks++;
-            job_stats[pkt.job_id].writebacks++;
-            core_stats[pkt.tid].writebacks++;
-            rsc_stats[pkt.rsc_id].writebacks++;
-
-            cache_stats.memside[pkt.cmd] += cache->params.blk_size;
-            job_stats[pkt.job_id].memside[pkt.cmd] += cache->params.blk_size;
-            core_stats[pkt.tid].memside[pkt.cmd] += cache->params.blk_size;
-            rsc_stats[pkt.rsc_id].memside[pkt.cmd] += cache->params.blk_size;
-
-            // Send eviction to memside
-            packet_t apkt;
-            apkt.vaddr = re->addr;
-            apkt.paddr = re->addr;
-            apkt.tid = pkt.tid;
-            apkt.cmd = WRITE;
-            apkt.rsc_id = re->rsc_id;
-            apkt.job_id = re->job_id;
-            apkt.dev_id = re->dev_id;
-            apkt.length = cache->params.blk_size;
-
-            //
-            send_packet(apkt);
-        }
+        evict(pkt, re, js, cs, rs);
     }
 
     // Insert blk
-    re->valid = true;
+    cache->insert(re, cache->get_blk_addr(pkt.paddr));
     re->dirty = (pkt.cmd == WRITE);
-    re->addr = cache->get_blk_addr(pkt.paddr);
     re->rsc_id = pkt.rsc_id;
     re->job_id = pkt.job_id;
     re->dev_id = pkt.dev_id;
-    re->last_tsc = tick;
     re->last_frame_nbr = system->get_frame_nbr();
     re->last_scene_nbr = system->get_scene_nbr();
     re->last_job_nbr = pkt.job_id;
     re->last_rsc_nbr = pkt.rsc_id;
 
-    re->sub_blk_ctrs[cache->get_sub_blk_idx(pkt.paddr)].set(1);
+    set_sub_blk_ctr(re, cache->get_sub_blk_idx(pkt.paddr), 1);
+}
+
+template <class policy_t>
+void
+BaseCacheModel<policy_t>::evict(const packet_t &pkt, cache_entry_t *re,
+    stats::Cache &js, stats::Cache &cs, stats::Cache &rs)
+{
+    //
+    cache_stats.evictions++;
+    js.evictions++;
+    cs.evictions++;
+    rs.evictions++;
+
+    //
+    sample_sub_blks(re);
+    // Clear it for replacement
+    clear_sub_blks(re);
+
+    // Inclusive, the core side drops its copies, dirty ones are
+    // written back with this one
+    if (_u(inclusion == INCLUSIVE) &&
+        send_invalidate(re->addr, cache->params.blk_size)) {
+        re->dirty = true;
+    }
+
+    //
+    send_eviction(pkt, re, js, cs, rs);
+}
+
+template <class policy_t>
+void
+BaseCacheModel<policy_t>::sample_sub_blks(const cache_entry_t *e)
+{
+    //
+    if (_l(wide_sub_blk_ctrs.empty())) {
+        blk_utilization.sample(e->sub_blk_ctrs.count_above(0));
+        blk_reutilization.sample(e->sub_blk_ctrs.count_above(1));
+        return;
+    }
+
+    //
+    const uint8_t *ctrs = wide_ctrs(e);
+    //
+    size_t touched = 0, reused = 0;
+
+    //
+    for (size_t k = 0; k < cache->no_sub_blks; ++k) {
+        touched += ctrs[k] > 0;
+        reused += ctrs[k] > 1;
+    }
+
+    //
+    blk_utilization.sample(touched);
+    blk_reutilization.sample(reused);
+}
+
+template <class policy_t>
+void
+BaseCacheModel<policy_t>::release(const packet_t &pkt, cache_entry_t *ce,
+    stats::Cache &js, stats::Cache &cs, stats::Cache &rs)
+{
+    // The core side installs it clean, so write back dirty data now
+    if (ce->dirty) {
+        send_eviction(pkt, ce, js, cs, rs);
+    }
+
+    //
+    clear_sub_blks(ce);
+    //
+    cache->invalidate(ce);
+}
+
+template <class policy_t>
+void
+BaseCacheModel<policy_t>::send_eviction(const packet_t &pkt,
+    const cache_entry_t *e,
+    stats::Cache &js, stats::Cache &cs, stats::Cache &rs)
+{
+    //
+    if (_u(e->dirty)) {
+        //
+        cache_stats.writebacks++;
+        js.writebacks++;
+        cs.writebacks++;
+        rs.writebacks++;
+
+        cache_stats.memside[pkt.cmd] += cache->params.blk_size;
+        js.memside[pkt.cmd] += cache->params.blk_size;
+        cs.memside[pkt.cmd] += cache->params.blk_size;
+        rs.memside[pkt.cmd] += cache->params.blk_size;
+    } else if (_l(send_clean_evictions == false)) {
+        // Only an exclusive mem side needs clean blocks
+        return;
+    }
+
+    // Send eviction to memside
+    packet_t apkt;
+    apkt.vaddr = e->addr;
+    apkt.paddr = e->addr;
+    apkt.tid = pkt.tid;
+    apkt.cmd = e->dirty ? WRITE : WRITEBACK;
+    apkt.rsc_id = e->rsc_id;
+    apkt.job_id = e->job_id;
+    apkt.dev_id = e->dev_id;
+    apkt.length = cache->params.blk_size;
+    apkt.flags = PKT_EVICTION;
+
+    //
+    send_packet(apkt);
+}
+
+template <class policy_t>
+bool
+BaseCacheModel<policy_t>::invalidate(uint64_t addr, uint64_t size)
+{
+    // Inclusion covers every level above, whatever their own policy
+    bool dirty = send_invalidate(addr, size);
+
+    //
+    for (uint64_t blk_addr = cache->get_blk_addr(addr);
+         blk_addr < addr + size;
+         blk_addr += cache->params.blk_size) {
+        //
+        cache_entry_t *ce, *re;
+        //
+        cache->find(blk_addr, ce, re);
+
+        //
+        if (ce) {
+            //
+            dirty |= ce->dirty;
+            //
+            clear_sub_blks(ce);
+            //
+            cache->invalidate(ce);
+        }
+    }
+
+    //
+    return dirty;
 }
 
+template <class policy_t>
 void
-BaseCacheModel::dump_stats()
+BaseCacheModel<policy_t>::dump_stats()
 {
     // Global Cache stats
     {
@@ -277,48 +448,49 @@ BaseCacheModel::dump_stats()
     }
 
     // Per job stats
-    for (auto &job : job_stats) {
+    job_stats.for_each([this](uint64_t id, stats::Cache &job) {
         //
         gltracesim::proto::BaseCacheJobStats stats;
         //
-        stats.set_id(std::get<0>(job));
+        stats.set_id(id);
         //
-        std::get<1>(job).dump(stats.mutable_cache_stats());
+        job.dump(stats.mutable_cache_stats());
         //
         pb.job_stats->write(stats);
-    }
+    });
 
     // Per job stats
-    for (auto &core : core_stats) {
+    core_stats.for_each([this](uint64_t id, stats::Cache &core) {
         //
         gltracesim::proto::BaseCacheCoreStats stats;
         //
-        stats.set_id(std::get<0>(core));
+        stats.set_id(id);
         //
-        std::get<1>(core).dump(stats.mutable_cache_stats());
+        core.dump(stats.mutable_cache_stats());
         //
         pb.core_stats->write(stats);
-    }
+    });
 
     // Per resource stats
-    for (auto &rsc : rsc_stats) {
+    rsc_stats.for_each([this](uint64_t id, stats::Cache &rsc) {
         //
         gltracesim::proto::BaseCacheRscStats stats;
         //
-        stats.set_id(std::get<0>(rsc));
+        stats.set_id(id);
         //
         stats.set_frame_id(system->get_frame_nbr());
         //
         stats.set_scene_id(system->get_scene_nbr());
         //
-        std::get<1>(rsc).dump(stats.mutable_cache_stats());
+        rsc.dump(stats.mutable_cache_stats());
         //
         pb.rsc_stats->write(stats);
-    }
+    });
 }
 
+template <class policy_t>
 void
-BaseCacheModel::reset_stats()
+BaseCacheModel<policy_t>::reset_stats()
 {
     //
     cache_stats.reset();
@@ -330,6 +502,140 @@ BaseCacheModel::reset_stats()
     rsc_stats.clear();
 }
 
+template <class policy_t>
+void
+BaseCacheModel<policy_t>::save_state(ProtoOutputStream *os)
+{
+    //
+    gltracesim::proto::BaseCacheState state;
+    //
+    state.set_tick(tick);
+    state.set_num_blks(cache->no_blks);
+    state.set_num_sub_blks(cache->no_sub_blks);
+    state.set_replacement(params.get("replacement", "lru").asString());
+    //
+    cache->policy.save(state.mutable_replacement_state());
+    //
+    os->write(state);
+
+    //
+    for (size_t i = 0; i < cache->no_blks; i += CHECKPOINT_CHUNK) {
+        //
+        gltracesim::proto::BaseCacheBlocks blks;
+        //
+        std::string *ctrs = blks.mutable_sub_blk_ctrs();
+
+        //
+        size_t n = std::min<size_t>(CHECKPOINT_CHUNK, cache->no_blks - i);
+
+        //
+        for (size_t blk_idx = i; blk_idx < i + n; ++blk_idx) {
+            //
+            const cache_entry_t &ce = cache->data[blk_idx];
+
+            //
+            blks.add_flags(ce.valid | (ce.dirty << 1));
+            blks.add_addr(ce.addr);
+            blks.add_rsc_id(ce.rsc_id);
+            blks.add_job_id(ce.job_id);
+            blks.add_dev_id(ce.dev_id);
+            blks.add_last_frame_nbr(ce.last_frame_nbr);
+            blks.add_last_scene_nbr(ce.last_scene_nbr);
+            blks.add_last_job_nbr(ce.last_job_nbr);
+            blks.add_last_rsc_nbr(ce.last_rsc_nbr);
+
+            //
+            for (size_t k = 0; k < cache->no_sub_blks; ++k) {
+                ctrs->push_back(char(get_sub_blk_ctr(&ce, k)));
+            }
+        }
+
+        //
+        os->write(blks);
+    }
+}
+
+template <class policy_t>
+bool
+BaseCacheModel<policy_t>::restore_state(ProtoInputStream *is)
+{
+    //
+    gltracesim::proto::BaseCacheState state;
+
+    //
+    if (is->read(state) == false ||
+        state.num_blks() != cache->no_blks ||
+        state.num_sub_blks() != cache->no_sub_blks ||
+        state.replacement() != params.get("replacement", "lru").asString()) {
+        return false;
+    }
+
+    //
+    tick = state.tick();
+
+    //
+    for (size_t i = 0; i < cache->no_blks;) {
+        //
+        gltracesim::proto::BaseCacheBlocks blks;
+
+        //
+        if (is->read(blks) == false || blks.flags_size() == 0) {
+            return false;
+        }
+
+        //
+        size_t n = blks.flags_size();
+
+        //
+        if (i + n > cache->no_blks ||
+            blks.sub_blk_ctrs().size() != n * cache->no_sub_blks) {
+            return false;
+        }
+
+        //
+        const char *ctrs = blks.sub_blk_ctrs().data();
+
+        //
+        for (size_t j = 0; j < n; ++j, ++i) {
+            //
+            cache_entry_t &ce = cache->data[i];
+
+            // Valid entries are inserted, the replacement state is
+            // restored afterwards
+            if (blks.flags(j) & 1) {
+                cache->insert(&ce, blks.addr(j));
+            } else {
+                cache->invalidate(&ce);
+                ce.addr = blks.addr(j);
+            }
+            //
+            ce.dirty = blks.flags(j) & 2;
+            ce.rsc_id = blks.rsc_id(j);
+            ce.job_id = blks.job_id(j);
+            ce.dev_id = blks.dev_id(j);
+            ce.last_frame_nbr = blks.last_frame_nbr(j);
+            ce.last_scene_nbr = blks.last_scene_nbr(j);
+            ce.last_job_nbr = blks.last_job_nbr(j);
+            ce.last_rsc_nbr = blks.last_rsc_nbr(j);
+
+            //
+            for (size_t k = 0; k < cache->no_sub_blks; ++k) {
+                set_sub_blk_ctr(&ce, k, *ctrs++);
+            }
+        }
+    }
+
+    //
+    return cache->policy.restore(state.replacement_state());
+}
+
+//
+template class BaseCacheModel<replacement::LRUPolicy>;
+template class BaseCacheModel<replacement::TreePLRUPolicy>;
+template class BaseCacheModel<replacement::SRRIPPolicy>;
+template class BaseCacheModel<replacement::BRRIPPolicy>;
+template class BaseCacheModel<replacement::RandomPolicy>;
+
 } // end namespace memory
 } // end namespace analyzer
 } // end namespace gltracesim
@@ -1,19 +1,23 @@
 #ifndef __GLTRACESIM_MODEL_CACHE_HH__
 #define __GLTRACESIM_MODEL_CACHE_HH__
 
+#include <algorithm>
 #include <memory>
-#include <unordered_map>
 
 #include "util/cache.hh"
 #include "util/cache_impl.hh"
-#include "util/sat_counter.hh"
+#include "util/packed_counters.hh"
+#include "util/replacement.hh"
 
 #include "stats/cache.hh"
 #include "stats/cache_impl.hh"
 #include "stats/distribution.hh"
 #include "stats/distribution_impl.hh"
+#include "stats/id_table.hh"
+#include "stats/id_table_impl.hh"
 
 #include "analyzer.hh"
+#include "debug.hh"
 #include "analyzer/memory/base.hh"
 #include <json/json.h>
 
@@ -21,6 +25,12 @@ namespace gltracesim {
 namespace analyzer {
 namespace memory {
 
+/**
+ * @brief The BaseCacheModel class, a template of the replacement policy
+ * of the cache so that it is resolved at compile time, the "replacement"
+ * parameter selects the instance (see create_cache_model)
+ */
+template <class policy_t>
 class BaseCacheModel : public BaseModel
 {
 
@@ -35,14 +45,15 @@ protected:
     };
 
     /**
-     * @brief sat_counter_t
+     * @brief Most sub-blocks per block counted in the entries, e.g. 32 B
+     * blocks of 1 B, wider blocks keep their counters in a side table
      */
-    typedef SatCounter<int8_t> sat_counter_t;
+    static const size_t MAX_SUB_BLKS = 32;
 
     /**
-     * @brief blk_util_vector
+     * @brief blk_util_ctrs_t, inline so that the entries are one array
      */
-    typedef std::vector<sat_counter_t> blk_util_vector;
+    typedef PackedCounters<MAX_SUB_BLKS> blk_util_ctrs_t;
 
     /**
      * @brief The cache_entry_t struct
@@ -70,15 +81,16 @@ protected:
         uint16_t last_rsc_nbr;
 
         /**
-         * @brief touched_sub_blks
+         * @brief sub_blk_ctrs, uses of every sub-block
          */
-        blk_util_vector sub_blk_ctrs;
+        blk_util_ctrs_t sub_blk_ctrs;
     };
 
     /**
      * @brief cache_base_t
      */
-    typedef gltracesim::Cache<cache_params_t, cache_entry_t> BaseCache;
+    typedef gltracesim::Cache<cache_params_t, cache_entry_t, policy_t>
+        BaseCache;
 
     /**
      * @brief The BasicCache class
@@ -101,6 +113,18 @@ protected:
     //
     typedef std::shared_ptr<Cache> CachePtr;
 
+    /**
+     * @brief The Inclusion enum, of the blocks of the core side caches
+     */
+    enum Inclusion {
+        // Neither inclusive nor exclusive
+        NINE = 0,
+        // Evictions invalidate the core side
+        INCLUSIVE,
+        // Only core side evictions are installed, read hits move up
+        EXCLUSIVE
+    };
+
 public:
 
     /**
@@ -119,6 +143,12 @@ public:
      */
     void process(const packet_t &pkt);
 
+    /**
+     * @brief process_batch
+     * @param pkts
+     */
+    void process_batch(const replay_batch_t &pkts);
+
     /**
      * @brief bypass
      * @param pkt
@@ -148,6 +178,154 @@ public:
      */
     virtual void reset_stats();
 
+    /**
+     * @brief save_state, the cache entries and replacement state
+     * @param os
+     */
+    virtual void save_state(ProtoOutputStream *os);
+
+    /**
+     * @brief restore_state
+     * @param is
+     * @return false if the geometry or policy of the cache differs
+     */
+    virtual bool restore_state(ProtoInputStream *is);
+
+    /**
+     * @brief invalidate, the blocks of a range, and of the core side
+     * @param addr
+     * @param size
+     * @return true if a dropped copy was dirty
+     */
+    virtual bool invalidate(uint64_t addr, uint64_t size);
+
+    /**
+     * @brief is_exclusive
+     * @return
+     */
+    virtual bool is_exclusive() const { return inclusion == EXCLUSIVE; }
+
+protected:
+
+    /**
+     * @brief access, models a read or write
+     * @param pkt
+     * @param js stats of the packet's job
+     * @param cs stats of the packet's core
+     * @param rs stats of the packet's resource
+     */
+    void access(const packet_t &pkt,
+                stats::Cache &js, stats::Cache &cs, stats::Cache &rs);
+
+    /**
+     * @brief evict, a valid block to make room for pkt
+     * @param pkt
+     * @param re
+     * @param js
+     * @param cs
+     * @param rs
+     */
+    void evict(const packet_t &pkt, cache_entry_t *re,
+               stats::Cache &js, stats::Cache &cs, stats::Cache &rs);
+
+    /**
+     * @brief release, a block read by an exclusive cache's core side
+     * @param pkt
+     * @param ce
+     * @param js
+     * @param cs
+     * @param rs
+     */
+    void release(const packet_t &pkt, cache_entry_t *ce,
+                 stats::Cache &js, stats::Cache &cs, stats::Cache &rs);
+
+    /**
+     * @brief send_eviction, dirty blocks as writes, clean ones as
+     * writebacks if the mem side is exclusive
+     * @param pkt
+     * @param e
+     * @param js
+     * @param cs
+     * @param rs
+     */
+    void send_eviction(const packet_t &pkt, const cache_entry_t *e,
+                       stats::Cache &js, stats::Cache &cs, stats::Cache &rs);
+
+    /**
+     * @brief wide_ctrs, counters of an entry in the side table
+     * @param e
+     * @return
+     */
+    uint8_t* wide_ctrs(const cache_entry_t *e) {
+        return &wide_sub_blk_ctrs[
+            (e - cache->data.data()) * cache->no_sub_blks];
+    }
+
+    /**
+     * @brief use_sub_blk, counts a use of the sub-block of an address
+     * @param e
+     * @param addr
+     */
+    void use_sub_blk(cache_entry_t *e, uint64_t addr) {
+        //
+        size_t k = cache->get_sub_blk_idx(addr);
+        //
+        if (_l(wide_sub_blk_ctrs.empty())) {
+            e->sub_blk_ctrs.increment(k);
+        } else if (wide_ctrs(e)[k] < blk_util_ctrs_t::MAX_VALUE) {
+            wide_ctrs(e)[k]++;
+        }
+    }
+
+    /**
+     * @brief get_sub_blk_ctr
+     * @param e
+     * @param k sub-block index
+     * @return
+     */
+    uint8_t get_sub_blk_ctr(const cache_entry_t *e, size_t k) {
+        //
+        if (_l(wide_sub_blk_ctrs.empty())) {
+            return e->sub_blk_ctrs.value(k);
+        }
+        //
+        return wide_ctrs(e)[k];
+    }
+
+    /**
+     * @brief set_sub_blk_ctr
+     * @param e
+     * @param k sub-block index
+     * @param v saturated like the inline counters
+     */
+    void set_sub_blk_ctr(cache_entry_t *e, size_t k, uint8_t v) {
+        //
+        if (_l(wide_sub_blk_ctrs.empty())) {
+            e->sub_blk_ctrs.set(k, v);
+        } else {
+            wide_ctrs(e)[k] = std::min(v, blk_util_ctrs_t::MAX_VALUE);
+        }
+    }
+
+    /**
+     * @brief clear_sub_blks, for the next block in the entry
+     * @param e
+     */
+    void clear_sub_blks(cache_entry_t *e) {
+        //
+        if (_l(wide_sub_blk_ctrs.empty())) {
+            e->sub_blk_ctrs.clear();
+        } else {
+            std::fill_n(wide_ctrs(e), cache->no_sub_blks, 0);
+        }
+    }
+
+    /**
+     * @brief sample_sub_blks, the utilization of an evicted block
+     * @param e
+     */
+    void sample_sub_blks(const cache_entry_t *e);
+
 protected:
 
     /**
@@ -156,10 +334,16 @@ protected:
     size_t tick;
 
     /**
-     * @brief install_wr_in_lru
+     * @brief fetch_on_wr_miss, of core writes, evictions of the core side
+     * are never fetched
      */
     bool fetch_on_wr_miss;
 
+    /**
+     * @brief inclusion
+     */
+    Inclusion inclusion;
+
     /**
      * @brief cache
      */
@@ -173,17 +357,17 @@ protected:
     /**
      * @brief job_stats
      */
-    std::unordered_map<uint64_t, stats::Cache> job_stats;
+    stats::IdTable<stats::Cache> job_stats;
 
     /**
      * @brief core_stats
      */
-    std::unordered_map<uint64_t, stats::Cache> core_stats;
+    stats::IdTable<stats::Cache> core_stats;
 
     /**
      * @brief rsc_stats
      */
-    std::unordered_map<uint64_t, stats::Cache> rsc_stats;
+    stats::IdTable<stats::Cache> rsc_stats;
 
     /**
      * @brief blk_utilization
@@ -195,8 +379,61 @@ protected:
      */
     stats::Distribution blk_reutilization;
 
+    /**
+     * @brief wide_sub_blk_ctrs, no_sub_blks counters per entry if that is
+     * more than MAX_SUB_BLKS, empty otherwise
+     */
+    std::vector<uint8_t> wide_sub_blk_ctrs;
+
 };
 
+//
+extern template class BaseCacheModel<replacement::LRUPolicy>;
+extern template class BaseCacheModel<replacement::TreePLRUPolicy>;
+extern template class BaseCacheModel<replacement::SRRIPPolicy>;
+extern template class BaseCacheModel<replacement::BRRIPPolicy>;
+extern template class BaseCacheModel<replacement::RandomPolicy>;
+
+/**
+ * @brief create_cache_model, a cache model with the replacement policy
+ * of the "replacement" parameter, LRU by default
+ * @param params
+ * @return NULL if there is no such policy or it does not support the
+ * associativity
+ */
+template <template <class> class model_t>
+AnalyzerPtr
+create_cache_model(const Json::Value &params)
+{
+    //
+    switch (replacement::get_policy(
+                params.get("replacement", "lru").asString())) {
+    case replacement::LRU:
+        return AnalyzerPtr(new model_t<replacement::LRUPolicy>(params));
+    case replacement::TREE_PLRU:
+        //
+        if (!replacement::TreePLRUPolicy::supports(
+                params.get("associativity", 8).asUInt())) {
+            //
+            DPRINTF(Error, "Tree PLRU needs a power of two associativity "
+                "of at most 64.\n"
+            );
+            //
+            return AnalyzerPtr();
+        }
+        //
+        return AnalyzerPtr(new model_t<replacement::TreePLRUPolicy>(params));
+    case replacement::SRRIP:
+        return AnalyzerPtr(new model_t<replacement::SRRIPPolicy>(params));
+    case replacement::BRRIP:
+        return AnalyzerPtr(new model_t<replacement::BRRIPPolicy>(params));
+    case replacement::RANDOM:
+        return AnalyzerPtr(new model_t<replacement::RandomPolicy>(params));
+    default:
+        return AnalyzerPtr();
+    }
+}
+
 } // end namespace memory
 } // end namespace analyzer
 } // end namespace gltracesim
@@ -20,15 +20,16 @@ struct IntelCacheModelBuilder : public gltracesim::AnalyzerBuilder
     }
 
     AnalyzerPtr create(const Json::Value &params) {
-        return AnalyzerPtr(new IntelCacheModel(params));
+        return create_cache_model<IntelCacheModel>(params);
     }
 };
 
 //
 IntelCacheModelBuilder intel_cache_analyzer_builder;
 
-IntelCacheModel::IntelCacheModel(const Json::Value &p) :
-    BaseCacheModel(p)
+template <class policy_t>
+IntelCacheModel<policy_t>::IntelCacheModel(const Json::Value &p) :
+    Base(p)
 {
     DPRINTF(Init, "IntelCacheAnalyzer [id: %i].\n",
         id
@@ -37,13 +38,15 @@ IntelCacheModel::IntelCacheModel(const Json::Value &p) :
     max_rsc_size = p["max-rsc-size"].asUInt64();
 }
 
-IntelCacheModel::~IntelCacheModel()
+template <class policy_t>
+IntelCacheModel<policy_t>::~IntelCacheModel()
 {
     DPRINTF(Init, "-IntelCacheAnalyzer [id: %i].\n", id);
 }
 
+template <class policy_t>
 bool
-IntelCacheModel::bypass(const packet_t &pkt)
+IntelCacheModel<policy_t>::bypass(const packet_t &pkt)
 {
     //
     GpuResourcePtr gpu_resource = system->rt->find_id(pkt.rsc_id);
@@ -58,6 +61,13 @@ IntelCacheModel::bypass(const packet_t &pkt)
     }
 }
 
+//
+template class IntelCacheModel<replacement::LRUPolicy>;
+template class IntelCacheModel<replacement::TreePLRUPolicy>;
+template class IntelCacheModel<replacement::SRRIPPolicy>;
+template class IntelCacheModel<replacement::BRRIPPolicy>;
+template class IntelCacheModel<replacement::RandomPolicy>;
+
 } // end namespace memory
 } // end namespace analyzer
 } // end namespace gltracesim
@@ -19,9 +19,18 @@ namespace analyzer {
 namespace memory {
 
 
-class IntelCacheModel : public BaseCacheModel
+template <class policy_t>
+class IntelCacheModel : public BaseCacheModel<policy_t>
 {
 
+protected:
+
+    //
+    typedef BaseCacheModel<policy_t> Base;
+
+    //
+    using Base::id;
+
 public:
 
     /**
@@ -50,6 +59,13 @@ protected:
 
 };
 
+//
+extern template class IntelCacheModel<replacement::LRUPolicy>;
+extern template class IntelCacheModel<replacement::TreePLRUPolicy>;
+extern template class IntelCacheModel<replacement::SRRIPPolicy>;
+extern template class IntelCacheModel<replacement::BRRIPPolicy>;
+extern template class IntelCacheModel<replacement::RandomPolicy>;
+
 } // end namespace memory
 } // end namespace analyzer
 } // end namespace gltracesim
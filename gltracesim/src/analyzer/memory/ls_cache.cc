@@ -25,15 +25,16 @@ struct LimitStudyCacheModelBuilder : public gltracesim::AnalyzerBuilder
     }
 
     AnalyzerPtr create(const Json::Value &params) {
-        return AnalyzerPtr(new LimitStudyCacheModel(params));
+        return create_cache_model<LimitStudyCacheModel>(params);
     }
 };
 
 //
 LimitStudyCacheModelBuilder limit_study_cache_analyzer_builder;
 
+template <class policy_t>
 void
-LimitStudyCacheModel::load_inter_scene_sharing_data(int frame_id)
+LimitStudyCacheModel<policy_t>::load_inter_scene_sharing_data(int frame_id)
 {
     //
     std::stringstream filename;
@@ -94,8 +95,9 @@ LimitStudyCacheModel::load_inter_scene_sharing_data(int frame_id)
     delete pis;
 }
 
+template <class policy_t>
 void
-LimitStudyCacheModel::load_intra_scene_sharing_data(int frame_id, int scene_id)
+LimitStudyCacheModel<policy_t>::load_intra_scene_sharing_data(int frame_id, int scene_id)
 {
     //
     std::stringstream filename;
@@ -152,8 +154,9 @@ LimitStudyCacheModel::load_intra_scene_sharing_data(int frame_id, int scene_id)
 }
 
 
-LimitStudyCacheModel::LimitStudyCacheModel(const Json::Value &p) :
-    BaseCacheModel(p)
+template <class policy_t>
+LimitStudyCacheModel<policy_t>::LimitStudyCacheModel(const Json::Value &p) :
+    Base(p)
 {
     //
     filter_inter_scene_sharing =
@@ -172,16 +175,19 @@ LimitStudyCacheModel::LimitStudyCacheModel(const Json::Value &p) :
 
 }
 
-LimitStudyCacheModel::~LimitStudyCacheModel()
+template <class policy_t>
+LimitStudyCacheModel<policy_t>::~LimitStudyCacheModel()
 {
     DPRINTF(Init, "-LimitStudyCacheAnalyzer [id: %i].\n", id);
 }
 
+template <class policy_t>
 void
-LimitStudyCacheModel::process(const packet_t &pkt)
+LimitStudyCacheModel<policy_t>::process(const packet_t &pkt)
 {
-    // Skip other commands
-    if (_u(pkt.cmd != READ && pkt.cmd != WRITE)) {
+    // Skip other commands, writebacks are clean evictions of the core
+    // side of an exclusive cache
+    if (_u(pkt.cmd != READ && pkt.cmd != WRITE && pkt.cmd != WRITEBACK)) {
         return;
     }
 
@@ -273,8 +279,13 @@ LimitStudyCacheModel::process(const packet_t &pkt)
         }
     }
 
+    // Every path updates the job and resource stats, the core stats
+    // are only created when used
+    stats::Cache &js = job_stats[pkt.job_id];
+    stats::Cache &rs = rsc_stats[pkt.rsc_id];
+
     //
-    Cache::entry_t *ce, *re;
+    cache_entry_t *ce, *re;
     //
     cache->find(pkt.paddr, ce, re);
 
@@ -282,26 +293,29 @@ LimitStudyCacheModel::process(const packet_t &pkt)
     if (_u(ce)) {
         assert(ce->valid);
 
-        //
-        ce->last_tsc = tick;
         //
         ce->dirty |= (pkt.cmd == WRITE);
 
         //
-        ce->sub_blk_ctrs[cache->get_sub_blk_idx(pkt.paddr)]++;
+        use_sub_blk(ce, pkt.paddr);
 
         //
         cache_stats.hits[pkt.cmd]++;
         cache_stats.gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
-        job_stats[pkt.job_id].hits[pkt.cmd]++;
-        job_stats[pkt.job_id].gpuside[pkt.cmd] += cache->params.sub_blk_size;
+        js.hits[pkt.cmd]++;
+        js.gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
         core_stats[pkt.tid].hits[pkt.cmd]++;
         core_stats[pkt.tid].gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
-        rsc_stats[pkt.rsc_id].hits[pkt.cmd]++;
-        rsc_stats[pkt.rsc_id].gpuside[pkt.cmd] += cache->params.sub_blk_size;
+        rs.hits[pkt.cmd]++;
+        rs.gpuside[pkt.cmd] += cache->params.sub_blk_size;
+
+        // Exclusive, the block moves to the core side
+        if (_u(inclusion == Base::EXCLUSIVE && pkt.cmd == READ)) {
+            release(pkt, ce, js, core_stats[pkt.tid], rs);
+        }
 
         // Nothing else to do
         return;
@@ -312,14 +326,14 @@ LimitStudyCacheModel::process(const packet_t &pkt)
         cache_stats.hits[pkt.cmd]++;
         cache_stats.gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
-        job_stats[pkt.job_id].hits[pkt.cmd]++;
-        job_stats[pkt.job_id].gpuside[pkt.cmd] += cache->params.sub_blk_size;
+        js.hits[pkt.cmd]++;
+        js.gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
         core_stats[pkt.tid].hits[pkt.cmd]++;
         core_stats[pkt.tid].gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
-        rsc_stats[pkt.rsc_id].hits[pkt.cmd]++;
-        rsc_stats[pkt.rsc_id].gpuside[pkt.cmd] += cache->params.sub_blk_size;
+        rs.hits[pkt.cmd]++;
+        rs.gpuside[pkt.cmd] += cache->params.sub_blk_size;
 
         //
         return;
@@ -327,16 +341,18 @@ LimitStudyCacheModel::process(const packet_t &pkt)
 
     //
     cache_stats.misses[pkt.cmd]++;
-    job_stats[pkt.job_id].misses[pkt.cmd]++;
-    rsc_stats[pkt.rsc_id].misses[pkt.cmd]++;
+    js.misses[pkt.cmd]++;
+    rs.misses[pkt.cmd]++;
 
-    if (_u((pkt.cmd == WRITE) && fetch_on_wr_miss == false)) {
+    if (_u(pkt.flags & PKT_EVICTION)) {
+        // Eviction of the core side, the whole block, nothing to fetch
+    } else if (_u((pkt.cmd == WRITE) && fetch_on_wr_miss == false)) {
         // Do nothing, only install, no fetch
     } else {
         cache_stats.memside[pkt.cmd] += cache->params.blk_size;
-        job_stats[pkt.job_id].memside[pkt.cmd] += cache->params.blk_size;
+        js.memside[pkt.cmd] += cache->params.blk_size;
         core_stats[pkt.tid].memside[pkt.cmd] += cache->params.blk_size;
-        rsc_stats[pkt.rsc_id].memside[pkt.cmd] += cache->params.blk_size;
+        rs.memside[pkt.cmd] += cache->params.blk_size;
 
         // Create a mutible copy
         packet_t apkt = pkt;
@@ -346,6 +362,11 @@ LimitStudyCacheModel::process(const packet_t &pkt)
         send_packet(apkt);
     }
 
+    // Exclusive caches only install core side evictions
+    if (_u(inclusion == Base::EXCLUSIVE && pkt.cmd == READ)) {
+        return;
+    }
+
     // Check if we should bypass
     if (_u(bypass(pkt))) {
         return;
@@ -356,81 +377,26 @@ LimitStudyCacheModel::process(const packet_t &pkt)
 
     // Evict and make room
     if (_l(re->valid)) {
-        cache_stats.evictions++;
-        job_stats[pkt.job_id].evictions++;
-        core_stats[pkt.tid].evictions++;
-        rsc_stats[pkt.rsc_id].evictions++;
-
-        uint8_t touched_sub_blks = 0;
-        uint8_t reused_sub_blks = 0;
-        uint8_t sub_blk_idx = 0;
-        do
-        {
-            //
-            if (_l(re->sub_blk_ctrs[sub_blk_idx].value() > 0))
-            {
-                ++touched_sub_blks;
-                if (_u(re->sub_blk_ctrs[sub_blk_idx].value() > 1)) {
-                    ++reused_sub_blks;
-                }
-                // Clear it for replacement
-                re->sub_blk_ctrs[sub_blk_idx].reset();
-            }
-            //
-            ++sub_blk_idx;
-
-        } while (_u(sub_blk_idx < re->sub_blk_ctrs.size()));
-        //
-        blk_utilization.sample(touched_sub_blks);
-        blk_reutilization.sample(reused_sub_blks);
-
-        //
-        if (_u(re->dirty)) {
-            //
-            cache_stats.writebacks++;
-            job_stats[pkt.job_id].writebacks++;
-            core_stats[pkt.tid].writebacks++;
-            rsc_stats[pkt.rsc_id].writebacks++;
-
-            cache_stats.memside[pkt.cmd] += cache->params.blk_size;
-            job_stats[pkt.job_id].memside[pkt.cmd] += cache->params.blk_size;
-            core_stats[pkt.tid].memside[pkt.cmd] += cache->params.blk_size;
-            rsc_stats[pkt.rsc_id].memside[pkt.cmd] += cache->params.blk_size;
-
-            // Send eviction to memside
-            packet_t apkt;
-            apkt.vaddr = re->addr;
-            apkt.paddr = re->addr;
-            apkt.tid = pkt.tid;
-            apkt.cmd = WRITE;
-            apkt.rsc_id = re->rsc_id;
-            apkt.job_id = re->job_id;
-            apkt.dev_id = re->dev_id;
-            apkt.length = cache->params.blk_size;
-
-            //
-            send_packet(apkt);
-        }
+        evict(pkt, re, js, core_stats[pkt.tid], rs);
     }
 
     // Insert blk
-    re->valid = true;
+    cache->insert(re, cache->get_blk_addr(pkt.paddr));
     re->dirty = (pkt.cmd == WRITE);
-    re->addr = cache->get_blk_addr(pkt.paddr);
     re->rsc_id = pkt.rsc_id;
     re->job_id = pkt.job_id;
     re->dev_id = pkt.dev_id;
-    re->last_tsc = tick;
     re->last_frame_nbr = system->get_frame_nbr();
     re->last_scene_nbr = system->get_scene_nbr();
     re->last_job_nbr = pkt.job_id;
     re->last_rsc_nbr = pkt.rsc_id;
 
-    re->sub_blk_ctrs[cache->get_sub_blk_idx(pkt.paddr)].set(1);
+    set_sub_blk_ctr(re, cache->get_sub_blk_idx(pkt.paddr), 1);
 }
 
+template <class policy_t>
 void
-LimitStudyCacheModel::start_new_frame(int frame_id)
+LimitStudyCacheModel<policy_t>::start_new_frame(int frame_id)
 {
     //
     if (filter_inter_scene_sharing) {
@@ -446,8 +412,9 @@ LimitStudyCacheModel::start_new_frame(int frame_id)
     }
 }
 
+template <class policy_t>
 void
-LimitStudyCacheModel::start_new_scene(int frame_id, int scene_id)
+LimitStudyCacheModel<policy_t>::start_new_scene(int frame_id, int scene_id)
 {
     //
     if (filter_intra_scene_sharing) {
@@ -470,6 +437,13 @@ LimitStudyCacheModel::start_new_scene(int frame_id, int scene_id)
 
 }
 
+//
+template class LimitStudyCacheModel<replacement::LRUPolicy>;
+template class LimitStudyCacheModel<replacement::TreePLRUPolicy>;
+template class LimitStudyCacheModel<replacement::SRRIPPolicy>;
+template class LimitStudyCacheModel<replacement::BRRIPPolicy>;
+template class LimitStudyCacheModel<replacement::RandomPolicy>;
+
 } // end namespace memory
 } // end namespace analyzer
 } // end namespace gltracesim
@@ -21,9 +21,38 @@ namespace analyzer {
 namespace memory {
 
 
-class LimitStudyCacheModel : public BaseCacheModel
+template <class policy_t>
+class LimitStudyCacheModel : public BaseCacheModel<policy_t>
 {
 
+protected:
+
+    //
+    typedef BaseCacheModel<policy_t> Base;
+
+    //
+    typedef typename Base::cache_entry_t cache_entry_t;
+
+    //
+    using Base::id;
+    using Base::params;
+    using Base::tick;
+    using Base::fetch_on_wr_miss;
+    using Base::inclusion;
+    using Base::cache;
+    using Base::cache_stats;
+    using Base::job_stats;
+    using Base::core_stats;
+    using Base::rsc_stats;
+    using Base::blk_utilization;
+    using Base::blk_reutilization;
+    using Base::bypass;
+    using Base::send_packet;
+    using Base::evict;
+    using Base::release;
+    using Base::use_sub_blk;
+    using Base::set_sub_blk_ctr;
+
 public:
 
     /**
@@ -42,6 +71,15 @@ public:
      */
     virtual void process(const packet_t &pkt);
 
+    /**
+     * @brief process_batch, per packet as process is overridden
+     * @param pkts
+     * @param n
+     */
+    virtual void process_batch(const replay_batch_t &pkts) {
+        Analyzer::process_batch(pkts);
+    }
+
     /**
      * @brief start_new_frame
      */
@@ -123,6 +161,13 @@ protected:
 
 };
 
+//
+extern template class LimitStudyCacheModel<replacement::LRUPolicy>;
+extern template class LimitStudyCacheModel<replacement::TreePLRUPolicy>;
+extern template class LimitStudyCacheModel<replacement::SRRIPPolicy>;
+extern template class LimitStudyCacheModel<replacement::BRRIPPolicy>;
+extern template class LimitStudyCacheModel<replacement::RandomPolicy>;
+
 } // end namespace memory
 } // end namespace analyzer
 } // end namespace gltracesim
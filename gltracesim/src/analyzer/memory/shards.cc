@@ -0,0 +1,324 @@
+#include "analyzer/memory/shards.hh"
+
+#include "debug_impl.hh"
+#include "resource_impl.hh"
+#include "system.hh"
+
+namespace gltracesim {
+namespace analyzer {
+namespace memory {
+
+/**
+ * @brief The ShardsModelBuilder struct
+ */
+struct ShardsModelBuilder : public gltracesim::AnalyzerBuilder
+{
+    ShardsModelBuilder() : AnalyzerBuilder("Shards") {
+        // Do nothing
+    }
+
+    AnalyzerPtr create(const Json::Value &params) {
+        return AnalyzerPtr(new ShardsModel(params));
+    }
+};
+
+//
+ShardsModelBuilder shards_analyzer_builder;
+
+ShardsModel::curve_t::curve_t(size_t num_buckets) :
+    accesses(0), samples(0), cold_misses(0), overflows(0),
+    dist(num_buckets, 0)
+{
+    // Do nothing
+}
+
+ShardsModel::ShardsModel(const Json::Value &p) :
+    BaseModel(p)
+{
+    //
+    uint32_t blk_size = p.get("blk-size", 64).asUInt();
+    assert(blk_size && (blk_size & (blk_size - 1)) == 0);
+    //
+    blk_shift = __builtin_ctz(blk_size);
+
+    //
+    double sampling_rate = p.get("sampling-rate", 0.01).asDouble();
+    assert(sampling_rate > 0 && sampling_rate <= 1);
+    //
+    threshold = std::max<uint32_t>(1, sampling_rate * MODULUS);
+
+    //
+    max_samples = p.get("max-samples", 8192).asUInt64();
+    assert(max_samples);
+
+    // Up to 4MB by default
+    max_blks = p.get("max-blks", 65536).asUInt64();
+    bucket_size = p.get("bucket-size", 1024).asUInt64();
+    //
+    assert(bucket_size);
+    assert(max_blks % bucket_size == 0);
+
+    //
+    DPRINTF(Init, "ShardsAnalyzer [id: %i, blk: %u, rate: %f, samples: %lu, "
+        "blks: %lu, step: %lu].\n",
+        id, blk_size, sampling_rate, max_samples, max_blks, bucket_size
+    );
+
+    //
+    reset_stats();
+}
+
+ShardsModel::~ShardsModel()
+{
+    DPRINTF(Init, "-ShardsAnalyzer [id: %i].\n", id);
+}
+
+int
+ShardsModel::get_class(int rsc_id) const
+{
+    //
+    GpuResourcePtr gpu_resource = system->rt->find_id(rsc_id);
+
+    // Accesses outside of resources
+    if (_u(gpu_resource == NULL)) {
+        return OTHER;
+    }
+
+    //
+    return gpu_resource->get_class();
+}
+
+void
+ShardsModel::process(const packet_t &pkt)
+{
+    // Skip other commands
+    if (_u(pkt.cmd != READ && pkt.cmd != WRITE)) {
+        return;
+    }
+
+    //
+    access(pkt.paddr, get_class(pkt.rsc_id));
+}
+
+void
+ShardsModel::process_batch(const replay_batch_t &pkts)
+{
+    // Consecutive packets mostly touch the same resource, so the class is
+    // looked up when the id changes rather than per packet
+    int cls = OTHER;
+    //
+    int64_t rsc_id = -1;
+
+    // Replayed packets are reads and writes
+    for (size_t i = 0; i < pkts.n; ++i) {
+        //
+        if (_u(rsc_id != pkts.rsc_id[i])) {
+            rsc_id = pkts.rsc_id[i];
+            cls = get_class(pkts.rsc_id[i]);
+        }
+
+        //
+        access(pkts.paddr[i], cls);
+    }
+}
+
+void
+ShardsModel::access(uint64_t paddr, int cls)
+{
+    //
+    ++curves[cls].accesses;
+    ++curves[ALL].accesses;
+
+    //
+    uint64_t blk = paddr >> blk_shift;
+    //
+    uint32_t h = hash(blk);
+
+    // Not sampled
+    if (_l(h >= threshold)) {
+        return;
+    }
+
+    //
+    uint64_t distance = stack.access(blk);
+
+    //
+    double rate = double(threshold) / MODULUS;
+
+    //
+    sample(curves[cls], distance, 1 / rate);
+    sample(curves[ALL], distance, 1 / rate);
+
+    //
+    if (_u(distance == StackDistance::COLD)) {
+        //
+        samples.push(std::make_pair(h, blk));
+
+        //
+        if (_u(samples.size() > max_samples)) {
+            shrink();
+        }
+    }
+}
+
+void
+ShardsModel::sample(curve_t &curve, uint64_t distance, double weight)
+{
+    //
+    ++curve.samples;
+
+    //
+    if (_u(distance == StackDistance::COLD)) {
+        curve.cold_misses += weight;
+        return;
+    }
+
+    // Distance in the sample, scaled to the whole stream
+    uint64_t scaled = distance * weight;
+
+    //
+    if (_u(scaled >= max_blks)) {
+        curve.overflows += weight;
+    } else {
+        curve.dist[scaled / bucket_size] += weight;
+    }
+}
+
+void
+ShardsModel::shrink()
+{
+    //
+    threshold = samples.top().first;
+
+    // Drop every block at or above the new threshold
+    while (!samples.empty() && samples.top().first >= threshold) {
+        //
+        stack.remove(samples.top().second);
+        //
+        samples.pop();
+    }
+
+    //
+    DPRINTF(Info, "ShardsAnalyzer [id: %i, rate: %f].\n",
+        id, double(threshold) / MODULUS
+    );
+}
+
+void
+ShardsModel::dump_stats()
+{
+    //
+    gltracesim::proto::ShardsStats stats;
+    //
+    stats.set_frame_id(system->get_frame_nbr());
+    stats.set_scene_id(system->get_scene_nbr());
+    stats.set_blk_size(1 << blk_shift);
+    stats.set_sampling_rate(double(threshold) / MODULUS);
+    stats.set_sampled_blks(samples.size());
+
+    //
+    for (int cls = 0; cls < NUM_CURVES; ++cls) {
+        //
+        const curve_t &curve = curves[cls];
+
+        //
+        gltracesim::proto::ShardsCurve *c = stats.add_curves();
+
+        //
+        if (cls < GpuResource::NUM_CLASSES) {
+            c->set_name(GpuResource::get_class_name(cls));
+        } else {
+            c->set_name(cls == OTHER ? "OTHER" : "ALL");
+        }
+
+        //
+        c->set_accesses(curve.accesses);
+        c->set_samples(curve.samples);
+        c->set_cold_misses(curve.cold_misses);
+
+        // The sample weights only estimate the accesses, the difference to
+        // the real count is credited to the smallest distances (SHARDS_adj),
+        // which leaves the estimated misses as they are
+        double misses = curve.cold_misses + curve.overflows;
+        //
+        std::vector<double> points(curve.dist.size());
+        //
+        for (size_t i = curve.dist.size(); i-- > 0;) {
+            //
+            points[i] = std::min<double>(misses, curve.accesses);
+            //
+            misses += curve.dist[i];
+        }
+
+        //
+        for (size_t i = 0; i < curve.dist.size(); ++i) {
+            c->add_blks((i + 1) * bucket_size);
+            c->add_misses(points[i]);
+        }
+    }
+
+    //
+    pb.stats->write(stats);
+}
+
+void
+ShardsModel::reset_stats()
+{
+    // The sample stays warm across scenes
+    curves.assign(NUM_CURVES, curve_t(max_blks / bucket_size));
+}
+
+void
+ShardsModel::save_state(ProtoOutputStream *os)
+{
+    //
+    std::vector<uint64_t> blks;
+    //
+    stack.get_blks(blks);
+
+    //
+    gltracesim::proto::ShardsState state;
+    //
+    state.set_threshold(threshold);
+    state.set_num_blks(blks.size());
+    //
+    os->write(state);
+
+    //
+    save_blks(os, blks);
+}
+
+bool
+ShardsModel::restore_state(ProtoInputStream *is)
+{
+    //
+    gltracesim::proto::ShardsState state;
+    //
+    std::vector<uint64_t> blks;
+
+    //
+    if (is->read(state) == false ||
+        restore_blks(is, state.num_blks(), blks) == false) {
+        return false;
+    }
+
+    //
+    threshold = state.threshold();
+
+    //
+    stack.set_blks(blks);
+
+    // The sample is the blocks of the stack
+    samples = std::priority_queue<sample_t>();
+    //
+    for (auto blk: blks) {
+        samples.push(std::make_pair(hash(blk), blk));
+    }
+
+    //
+    return true;
+}
+
+} // end namespace memory
+} // end namespace analyzer
+} // end namespace gltracesim
@@ -0,0 +1,222 @@
+#ifndef __GLTRACESIM_MODEL_SHARDS_HH__
+#define __GLTRACESIM_MODEL_SHARDS_HH__
+
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "util/cflags.hh"
+#include "util/stack_distance.hh"
+
+#include "analyzer.hh"
+#include "analyzer/memory/base.hh"
+#include "analyzer/memory/shards.pb.h"
+#include "resource.hh"
+#include <json/json.h>
+
+namespace gltracesim {
+namespace analyzer {
+namespace memory {
+
+/**
+ * @brief The ShardsModel class, approximate miss ratio curves of fully
+ * associative LRU caches from a spatially hashed sample of the blocks.
+ *
+ * A block is sampled iff its hash is below a threshold, so every
+ * reference to a sampled block is seen and the stack distances within
+ * the sample, scaled by the inverse sampling rate, estimate the real
+ * distances. The sample is bounded by max-samples blocks: when it
+ * overflows, the threshold is lowered to drop the blocks with the
+ * largest hash (fixed-size SHARDS). Curves are kept per resource class
+ * and are emitted every scene.
+ */
+class ShardsModel : public BaseModel
+{
+
+protected:
+
+    /**
+     * @brief Curves of the resource classes, then other and all accesses
+     */
+    enum {
+        OTHER = GpuResource::NUM_CLASSES,
+        ALL,
+        NUM_CURVES
+    };
+
+    /**
+     * @brief The curve_t struct, scaled stack distance histogram
+     */
+    struct curve_t {
+
+        /**
+         * @brief curve_t
+         * @param num_buckets
+         */
+        curve_t(size_t num_buckets);
+
+        //
+        uint64_t accesses;
+        //
+        uint64_t samples;
+        //
+        double cold_misses;
+        //
+        double overflows;
+        //
+        std::vector<double> dist;
+    };
+
+    /**
+     * @brief hash, block pair of a sampled block
+     */
+    typedef std::pair<uint32_t, uint64_t> sample_t;
+
+public:
+
+    /**
+     * @brief Analyzer
+     */
+    ShardsModel(const Json::Value &params);
+
+    /**
+     * @brief ~Analyzer
+     */
+    virtual ~ShardsModel();
+
+    /**
+     * @brief process
+     * @param pkt
+     */
+    void process(const packet_t &pkt);
+
+    /**
+     * @brief process_batch
+     * @param pkts
+     */
+    void process_batch(const replay_batch_t &pkts);
+
+    /**
+     * @brief process
+     * @param buffer
+     */
+    virtual void dump_stats();
+
+    /**
+     * @brief process
+     * @param buffer
+     */
+    virtual void reset_stats();
+
+    /**
+     * @brief save_state, the sampling threshold and the stack of the sample
+     * @param os
+     */
+    virtual void save_state(ProtoOutputStream *os);
+
+    /**
+     * @brief restore_state
+     * @param is
+     * @return
+     */
+    virtual bool restore_state(ProtoInputStream *is);
+
+protected:
+
+    /**
+     * @brief access
+     * @param paddr
+     * @param cls curve of the packet's resource
+     */
+    void access(uint64_t paddr, int cls);
+
+    /**
+     * @brief get_class
+     * @param rsc_id
+     * @return curve of the resource
+     */
+    int get_class(int rsc_id) const;
+
+    /**
+     * @brief sample
+     * @param curve
+     * @param distance
+     * @param weight
+     */
+    void sample(curve_t &curve, uint64_t distance, double weight);
+
+    /**
+     * @brief shrink, lowers the threshold until the sample fits
+     */
+    void shrink();
+
+    /**
+     * @brief hash
+     * @param blk
+     * @return
+     */
+    static uint32_t hash(uint64_t blk) {
+        // 64-bit finalizer of MurmurHash3
+        blk ^= blk >> 33;
+        blk *= 0xff51afd7ed558ccdULL;
+        blk ^= blk >> 33;
+        blk *= 0xc4ceb9fe1a85ec53ULL;
+        blk ^= blk >> 33;
+        //
+        return blk & (MODULUS - 1);
+    }
+
+protected:
+
+    /**
+     * @brief Hash space
+     */
+    static const uint32_t MODULUS = 1 << 24;
+
+    /**
+     * @brief blk_shift
+     */
+    uint32_t blk_shift;
+
+    /**
+     * @brief Blocks with a hash below are sampled
+     */
+    uint32_t threshold;
+
+    /**
+     * @brief max_samples
+     */
+    size_t max_samples;
+
+    /**
+     * @brief max_blks
+     */
+    uint64_t max_blks;
+
+    /**
+     * @brief bucket_size
+     */
+    uint64_t bucket_size;
+
+    /**
+     * @brief stack of the sampled blocks
+     */
+    StackDistance stack;
+
+    /**
+     * @brief sampled blocks, largest hash on top
+     */
+    std::priority_queue<sample_t> samples;
+
+    /**
+     * @brief curves
+     */
+    std::vector<curve_t> curves;
+
+};
+
+} // end namespace memory
+} // end namespace analyzer
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_MODEL_SHARDS_HH__
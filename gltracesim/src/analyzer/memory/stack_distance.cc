@@ -0,0 +1,344 @@
+#include "analyzer/memory/stack_distance.hh"
+
+#include "debug_impl.hh"
+#include "system.hh"
+
+namespace gltracesim {
+namespace analyzer {
+namespace memory {
+
+/**
+ * @brief The StackDistanceModelBuilder struct
+ */
+struct StackDistanceModelBuilder : public gltracesim::AnalyzerBuilder
+{
+    StackDistanceModelBuilder() : AnalyzerBuilder("StackDistance") {
+        // Do nothing
+    }
+
+    AnalyzerPtr create(const Json::Value &params) {
+        return AnalyzerPtr(new StackDistanceModel(params));
+    }
+};
+
+//
+StackDistanceModelBuilder stack_distance_analyzer_builder;
+
+StackDistanceModel::curve_t::curve_t(const config_t &config) :
+    accesses(0), cold_misses(0), overflows(0),
+    dist(config.max_ways / config.bucket_size, 0)
+{
+    // Do nothing
+}
+
+void
+StackDistanceModel::curve_t::dump(const config_t &config,
+    gltracesim::proto::StackDistanceCurve *curve) const
+{
+    //
+    curve->set_num_sets(config.num_sets);
+    curve->set_accesses(accesses);
+    curve->set_cold_misses(cold_misses);
+
+    // Misses with ways = (i + 1) * bucket_size are the distances in the
+    // buckets after i
+    uint64_t misses = cold_misses + overflows;
+    //
+    std::vector<uint64_t> points(dist.size());
+    //
+    for (size_t i = dist.size(); i-- > 0;) {
+        //
+        points[i] = misses;
+        //
+        misses += dist[i];
+    }
+
+    //
+    for (size_t i = 0; i < dist.size(); ++i) {
+        curve->add_ways((i + 1) * config.bucket_size);
+        curve->add_misses(points[i]);
+    }
+
+    //
+    gltracesim::proto::Distribution *distances = curve->mutable_distances();
+    //
+    distances->set_samples(accesses - cold_misses);
+    distances->set_underflows(0);
+    distances->set_overflows(overflows);
+    //
+    for (size_t i = 0; i < dist.size(); ++i) {
+        distances->add_dist(dist[i]);
+    }
+}
+
+StackDistanceModel::StackDistanceModel(const Json::Value &p) :
+    BaseModel(p)
+{
+    //
+    uint32_t blk_size = p.get("blk-size", 64).asUInt();
+    assert(blk_size && (blk_size & (blk_size - 1)) == 0);
+    //
+    blk_shift = __builtin_ctz(blk_size);
+
+    // Fully associative up to 4MB by default
+    Json::Value default_configs(Json::arrayValue);
+    //
+    default_configs[0]["sets"] = 1;
+    default_configs[0]["max-ways"] = 65536;
+    default_configs[0]["bucket-size"] = 1024;
+
+    //
+    const Json::Value &cc = p.isMember("configs") ?
+        p["configs"] : default_configs;
+
+    //
+    for (unsigned i = 0; i < cc.size(); ++i) {
+        //
+        config_t config;
+
+        //
+        config.num_sets = cc[i].get("sets", 1).asUInt64();
+        config.max_ways = cc[i].get("max-ways", 16).asUInt64();
+        config.bucket_size = cc[i].get("bucket-size", 1).asUInt64();
+
+        //
+        assert(config.bucket_size);
+        assert(config.max_ways % config.bucket_size == 0);
+
+        //
+        config.stacks = std::make_shared<SetStackDistance>(config.num_sets);
+
+        //
+        DPRINTF(Init, "StackDistanceAnalyzer [id: %i, blk: %u, sets: %lu, "
+            "ways: %lu, step: %lu].\n",
+            id, blk_size, config.num_sets, config.max_ways,
+            config.bucket_size
+        );
+
+        //
+        configs.push_back(config);
+    }
+
+    //
+    reset_stats();
+}
+
+StackDistanceModel::~StackDistanceModel()
+{
+    DPRINTF(Init, "-StackDistanceAnalyzer [id: %i].\n", id);
+}
+
+StackDistanceModel::curves_t
+StackDistanceModel::new_curves() const
+{
+    //
+    curves_t c;
+
+    //
+    for (auto &config: configs) {
+        c.push_back(curve_t(config));
+    }
+
+    //
+    return c;
+}
+
+StackDistanceModel::curves_t&
+StackDistanceModel::get_curves(
+    std::unordered_map<uint64_t, curves_t> &curves, uint64_t id)
+{
+    //
+    auto it = curves.find(id);
+
+    //
+    if (_u(it == curves.end())) {
+        it = curves.insert(std::make_pair(id, new_curves())).first;
+    }
+
+    //
+    return it->second;
+}
+
+void
+StackDistanceModel::process(const packet_t &pkt)
+{
+    // Skip other commands
+    if (_u(pkt.cmd != READ && pkt.cmd != WRITE)) {
+        return;
+    }
+
+    //
+    access(pkt.paddr,
+        get_curves(job_curves, pkt.job_id), get_curves(rsc_curves, pkt.rsc_id)
+    );
+}
+
+void
+StackDistanceModel::process_batch(const replay_batch_t &pkts)
+{
+    // A batch comes from one job, so the curves are looked up when the
+    // ids change rather than per packet
+    curves_t *jc = NULL, *rc = NULL;
+    //
+    int64_t job_id = -1, rsc_id = -1;
+
+    // Replayed packets are reads and writes
+    for (size_t i = 0; i < pkts.n; ++i) {
+        //
+        if (_u(jc == NULL || job_id != pkts.job_id[i])) {
+            job_id = pkts.job_id[i];
+            jc = &get_curves(job_curves, pkts.job_id[i]);
+        }
+        //
+        if (_u(rc == NULL || rsc_id != pkts.rsc_id[i])) {
+            rsc_id = pkts.rsc_id[i];
+            rc = &get_curves(rsc_curves, pkts.rsc_id[i]);
+        }
+
+        //
+        access(pkts.paddr[i], *jc, *rc);
+    }
+}
+
+void
+StackDistanceModel::access(uint64_t paddr, curves_t &jc, curves_t &rc)
+{
+    //
+    uint64_t blk = paddr >> blk_shift;
+
+    //
+    for (size_t i = 0; i < configs.size(); ++i) {
+        //
+        const config_t &config = configs[i];
+
+        //
+        uint64_t distance = config.stacks->access(blk);
+
+        //
+        curves[i].sample(config, distance);
+        jc[i].sample(config, distance);
+        rc[i].sample(config, distance);
+    }
+}
+
+void
+StackDistanceModel::dump_stats()
+{
+    // Global curves
+    {
+        gltracesim::proto::StackDistanceStats stats;
+        //
+        stats.set_frame_id(system->get_frame_nbr());
+        stats.set_scene_id(system->get_scene_nbr());
+        stats.set_blk_size(1 << blk_shift);
+        //
+        for (size_t i = 0; i < configs.size(); ++i) {
+            curves[i].dump(configs[i], stats.add_curves());
+        }
+        //
+        pb.stats->write(stats);
+    }
+
+    // Per job curves
+    for (auto &job : job_curves) {
+        //
+        gltracesim::proto::StackDistanceJobStats stats;
+        //
+        stats.set_id(std::get<0>(job));
+        //
+        for (size_t i = 0; i < configs.size(); ++i) {
+            std::get<1>(job)[i].dump(configs[i], stats.add_curves());
+        }
+        //
+        pb.job_stats->write(stats);
+    }
+
+    // Per resource curves
+    for (auto &rsc : rsc_curves) {
+        //
+        gltracesim::proto::StackDistanceRscStats stats;
+        //
+        stats.set_id(std::get<0>(rsc));
+        //
+        stats.set_frame_id(system->get_frame_nbr());
+        //
+        stats.set_scene_id(system->get_scene_nbr());
+        //
+        for (size_t i = 0; i < configs.size(); ++i) {
+            std::get<1>(rsc)[i].dump(configs[i], stats.add_curves());
+        }
+        //
+        pb.rsc_stats->write(stats);
+    }
+}
+
+void
+StackDistanceModel::reset_stats()
+{
+    //
+    curves = new_curves();
+
+    //
+    job_curves.clear();
+    rsc_curves.clear();
+}
+
+void
+StackDistanceModel::save_state(ProtoOutputStream *os)
+{
+    //
+    std::vector<uint64_t> blks;
+
+    //
+    for (auto &config: configs) {
+        //
+        for (size_t set = 0; set < config.num_sets; ++set) {
+            //
+            config.stacks->get_set(set).get_blks(blks);
+
+            //
+            gltracesim::proto::StackDistanceState state;
+            //
+            state.set_num_sets(config.num_sets);
+            state.set_num_blks(blks.size());
+            //
+            os->write(state);
+
+            //
+            save_blks(os, blks);
+        }
+    }
+}
+
+bool
+StackDistanceModel::restore_state(ProtoInputStream *is)
+{
+    //
+    std::vector<uint64_t> blks;
+
+    //
+    for (auto &config: configs) {
+        //
+        for (size_t set = 0; set < config.num_sets; ++set) {
+            //
+            gltracesim::proto::StackDistanceState state;
+
+            //
+            if (is->read(state) == false ||
+                state.num_sets() != config.num_sets ||
+                restore_blks(is, state.num_blks(), blks) == false) {
+                return false;
+            }
+
+            //
+            config.stacks->get_set(set).set_blks(blks);
+        }
+    }
+
+    //
+    return true;
+}
+
+} // end namespace memory
+} // end namespace analyzer
+} // end namespace gltracesim
@@ -0,0 +1,208 @@
+#ifndef __GLTRACESIM_MODEL_STACK_DISTANCE_HH__
+#define __GLTRACESIM_MODEL_STACK_DISTANCE_HH__
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "util/cflags.hh"
+#include "util/stack_distance.hh"
+
+#include "analyzer.hh"
+#include "analyzer/memory/base.hh"
+#include "analyzer/memory/stack_distance.pb.h"
+#include <json/json.h>
+
+namespace gltracesim {
+namespace analyzer {
+namespace memory {
+
+/**
+ * @brief The StackDistanceModel class, miss ratio curves of LRU caches
+ * in a single pass.
+ *
+ * Every configured set count keeps the LRU stack of each set. The stack
+ * distance of an access tells the smallest associativity it hits in, so
+ * one pass gives the misses of every cache size with that set count.
+ * Distances are bucketed, and a curve point is emitted at the end of
+ * every bucket, globally, per job and per resource every scene.
+ */
+class StackDistanceModel : public BaseModel
+{
+
+protected:
+
+    /**
+     * @brief The config_t struct, caches with the same set count
+     */
+    struct config_t {
+        //
+        size_t num_sets;
+        // Largest associativity of the curve
+        size_t max_ways;
+        // Associativity between curve points
+        size_t bucket_size;
+        //
+        std::shared_ptr<SetStackDistance> stacks;
+    };
+
+    /**
+     * @brief The curve_t struct, stack distance histogram of a config
+     */
+    struct curve_t {
+
+        /**
+         * @brief curve_t
+         * @param config
+         */
+        curve_t(const config_t &config);
+
+        /**
+         * @brief sample
+         * @param config
+         * @param distance
+         */
+        void sample(const config_t &config, uint64_t distance) {
+            //
+            ++accesses;
+            //
+            if (_u(distance == StackDistance::COLD)) {
+                ++cold_misses;
+            } else if (_u(distance >= config.max_ways)) {
+                ++overflows;
+            } else {
+                ++dist[distance / config.bucket_size];
+            }
+        }
+
+        /**
+         * @brief dump
+         * @param config
+         * @param curve
+         */
+        void dump(const config_t &config,
+                  gltracesim::proto::StackDistanceCurve *curve) const;
+
+        //
+        uint64_t accesses;
+        //
+        uint64_t cold_misses;
+        //
+        uint64_t overflows;
+        //
+        std::vector<uint64_t> dist;
+    };
+
+    /**
+     * @brief curves of all configs
+     */
+    typedef std::vector<curve_t> curves_t;
+
+public:
+
+    /**
+     * @brief Analyzer
+     */
+    StackDistanceModel(const Json::Value &params);
+
+    /**
+     * @brief ~Analyzer
+     */
+    virtual ~StackDistanceModel();
+
+    /**
+     * @brief process
+     * @param pkt
+     */
+    void process(const packet_t &pkt);
+
+    /**
+     * @brief process_batch
+     * @param pkts
+     */
+    void process_batch(const replay_batch_t &pkts);
+
+    /**
+     * @brief process
+     * @param buffer
+     */
+    virtual void dump_stats();
+
+    /**
+     * @brief process
+     * @param buffer
+     */
+    virtual void reset_stats();
+
+    /**
+     * @brief save_state, the LRU stacks of every config
+     * @param os
+     */
+    virtual void save_state(ProtoOutputStream *os);
+
+    /**
+     * @brief restore_state
+     * @param is
+     * @return
+     */
+    virtual bool restore_state(ProtoInputStream *is);
+
+protected:
+
+    /**
+     * @brief access
+     * @param paddr
+     * @param jc curves of the packet's job
+     * @param rc curves of the packet's resource
+     */
+    void access(uint64_t paddr, curves_t &jc, curves_t &rc);
+
+    /**
+     * @brief new_curves
+     * @return empty curves of all configs
+     */
+    curves_t new_curves() const;
+
+    /**
+     * @brief get_curves
+     * @param curves
+     * @param id
+     * @return
+     */
+    curves_t& get_curves(std::unordered_map<uint64_t, curves_t> &curves,
+                         uint64_t id);
+
+protected:
+
+    /**
+     * @brief blk_shift
+     */
+    uint32_t blk_shift;
+
+    /**
+     * @brief configs
+     */
+    std::vector<config_t> configs;
+
+    /**
+     * @brief curves
+     */
+    curves_t curves;
+
+    /**
+     * @brief job_curves
+     */
+    std::unordered_map<uint64_t, curves_t> job_curves;
+
+    /**
+     * @brief rsc_curves
+     */
+    std::unordered_map<uint64_t, curves_t> rsc_curves;
+
+};
+
+} // end namespace memory
+} // end namespace analyzer
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_MODEL_STACK_DISTANCE_HH__
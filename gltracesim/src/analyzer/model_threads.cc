@@ -0,0 +1,169 @@
+#include <chrono>
+
+#include "analyzer/model_threads.hh"
+
+#include "debug_impl.hh"
+
+namespace gltracesim {
+namespace analyzer {
+
+ModelThreads::ModelThreads(const std::vector<AnalyzerPtr> &analyzers,
+    size_t num_slots) :
+    slots(num_slots), head(0), stop(false)
+{
+    //
+    assert(num_slots);
+
+    //
+    DPRINTF(Init, "ModelThreads [threads: %lu, slots: %lu].\n",
+        analyzers.size(), num_slots
+    );
+
+    //
+    for (auto &analyzer: analyzers) {
+        //
+        workers.push_back(std::unique_ptr<worker_t>(new worker_t()));
+        //
+        workers.back()->analyzer = analyzer;
+        workers.back()->tail = 0;
+    }
+
+    // Start once all workers exist
+    for (size_t wid = 0; wid < workers.size(); ++wid) {
+        workers[wid]->thread = std::thread([this, wid] { work_loop(wid); });
+    }
+}
+
+ModelThreads::~ModelThreads()
+{
+    //
+    sync();
+
+    //
+    stop = true;
+
+    //
+    for (auto &worker: workers) {
+        worker->thread.join();
+    }
+}
+
+void
+ModelThreads::send_packets(const replay_batch_t &pkts)
+{
+    //
+    uint64_t pos = head.load(std::memory_order_relaxed);
+
+    // Wait for the slowest model to free a slot
+    unsigned spins = 0;
+    //
+    while (_u(pos - min_tail() >= slots.size())) {
+        backoff(spins);
+    }
+
+    //
+    slot_t &slot = slots[pos % slots.size()];
+    //
+    slot.pkts.assign(pkts);
+    slot.n = pkts.n;
+    slot.tid = pkts.tid;
+
+    // Publish
+    head.store(pos + 1, std::memory_order_release);
+}
+
+void
+ModelThreads::sync()
+{
+    //
+    uint64_t pos = head.load(std::memory_order_relaxed);
+
+    //
+    unsigned spins = 0;
+    //
+    while (min_tail() != pos) {
+        backoff(spins);
+    }
+}
+
+void
+ModelThreads::work_loop(size_t wid)
+{
+    //
+    worker_t &worker = *workers[wid];
+
+    //
+    uint64_t pos = worker.tail.load(std::memory_order_relaxed);
+
+    //
+    unsigned spins = 0;
+
+    //
+    while (true) {
+        //
+        if (pos == head.load(std::memory_order_acquire)) {
+            //
+            if (stop) {
+                return;
+            }
+            //
+            backoff(spins);
+            //
+            continue;
+        }
+
+        //
+        spins = 0;
+
+        //
+        const slot_t &slot = slots[pos % slots.size()];
+
+        //
+        replay_batch_t pkts = slot.pkts.batch(0, slot.n);
+        //
+        pkts.tid = slot.tid;
+
+        //
+        worker.analyzer->process_timed_batch(pkts);
+
+        // Hand back the slot
+        worker.tail.store(++pos, std::memory_order_release);
+    }
+}
+
+uint64_t
+ModelThreads::min_tail() const
+{
+    //
+    uint64_t tail = head.load(std::memory_order_relaxed);
+
+    //
+    for (auto &worker: workers) {
+        tail = std::min(tail, worker->tail.load(std::memory_order_acquire));
+    }
+
+    //
+    return tail;
+}
+
+void
+ModelThreads::backoff(unsigned &spins)
+{
+    //
+    ++spins;
+
+    //
+    if (spins < 64) {
+        return;
+    }
+
+    //
+    if (spins < 1024) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+} // end namespace analyzer
+} // end namespace gltracesim
@@ -0,0 +1,127 @@
+#ifndef __GLTRACESIM_ANALYZER_MODEL_THREADS_HH__
+#define __GLTRACESIM_ANALYZER_MODEL_THREADS_HH__
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "analyzer.hh"
+#include "packet.hh"
+
+namespace gltracesim {
+namespace analyzer {
+
+/**
+ * @brief The ModelThreads class, runs every model on its own thread.
+ *
+ * The simulator loop is the single producer of a ring of packet
+ * batches, and every model thread consumes all batches in order, so
+ * each model sees the same packet stream as in a serial run. Batches
+ * are copied once into the ring and shared by all models. A slot is
+ * reused once the slowest model is done with it.
+ *
+ * Models are only called from their threads while packets are in
+ * flight. The simulator calls sync() before touching the models or the
+ * state they read, e.g. at scene and frame boundaries.
+ */
+class ModelThreads {
+
+public:
+
+    /**
+     * @brief ModelThreads
+     * @param analyzers
+     * @param num_slots batches in flight
+     */
+    ModelThreads(const std::vector<AnalyzerPtr> &analyzers,
+                 size_t num_slots);
+
+    /**
+     * @brief ~ModelThreads, processes the batches in flight
+     */
+    ~ModelThreads();
+
+    /**
+     * @brief send_packets to all models, blocks while the ring is full
+     * @param pkts copied, may be reused after the call
+     */
+    void send_packets(const replay_batch_t &pkts);
+
+    /**
+     * @brief sync, waits until all models processed all batches
+     */
+    void sync();
+
+private:
+
+    /**
+     * @brief work_loop
+     * @param wid
+     */
+    void work_loop(size_t wid);
+
+    /**
+     * @brief min_tail
+     * @return number of batches processed by the slowest model
+     */
+    uint64_t min_tail() const;
+
+    /**
+     * @brief backoff, spins, then yields, then sleeps
+     * @param spins
+     */
+    static void backoff(unsigned &spins);
+
+    /**
+     * @brief The worker_t struct
+     */
+    struct worker_t {
+        //
+        AnalyzerPtr analyzer;
+        //
+        std::thread thread;
+        // Batches processed
+        std::atomic<uint64_t> tail;
+        // Keep the tails on separate cache lines
+        char pad[64];
+    };
+
+    /**
+     * @brief The slot_t struct
+     */
+    struct slot_t {
+        //
+        replay_buffer_t pkts;
+        //
+        size_t n;
+        //
+        uint8_t tid;
+    };
+
+    /**
+     * @brief slots
+     */
+    std::vector<slot_t> slots;
+
+    /**
+     * @brief workers
+     */
+    std::vector<std::unique_ptr<worker_t>> workers;
+
+    /**
+     * @brief batches sent
+     */
+    std::atomic<uint64_t> head;
+
+    /**
+     * @brief stop
+     */
+    std::atomic<bool> stop;
+
+};
+
+} // end namespace analyzer
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_ANALYZER_MODEL_THREADS_HH__
@@ -0,0 +1,136 @@
+#include "analyzer/private_models.hh"
+
+#include "debug_impl.hh"
+
+namespace gltracesim {
+namespace analyzer {
+
+PrivateModels::PrivateModels(const Json::Value &params,
+    const std::vector<AnalyzerPtr> &models) :
+    Analyzer(params, params["id"].asInt()), models(models)
+{
+    //
+    assert(models.size());
+
+    //
+    DPRINTF(Init, "PrivateModels [id: %i, cores: %lu].\n",
+        id, models.size()
+    );
+}
+
+PrivateModels::~PrivateModels()
+{
+    // Do nothing
+}
+
+void
+PrivateModels::process(const packet_t &pkt)
+{
+    //
+    assert(pkt.tid < models.size());
+    //
+    models[pkt.tid]->process(pkt);
+}
+
+void
+PrivateModels::process_batch(const replay_batch_t &pkts)
+{
+    //
+    assert(pkts.tid < models.size());
+    //
+    models[pkts.tid]->process_batch(pkts);
+}
+
+void
+PrivateModels::start_new_frame(int frame_id)
+{
+    for (auto &model: models) {
+        model->start_new_frame(frame_id);
+    }
+}
+
+void
+PrivateModels::start_new_scene(int frame_id, int scene_id)
+{
+    for (auto &model: models) {
+        model->start_new_scene(frame_id, scene_id);
+    }
+}
+
+void
+PrivateModels::dump_stats()
+{
+    for (auto &model: models) {
+        model->dump_stats();
+    }
+}
+
+void
+PrivateModels::reset_stats()
+{
+    for (auto &model: models) {
+        model->reset_stats();
+    }
+}
+
+void
+PrivateModels::save_state(ProtoOutputStream *os)
+{
+    for (auto &model: models) {
+        model->save_state(os);
+    }
+}
+
+bool
+PrivateModels::restore_state(ProtoInputStream *is)
+{
+    //
+    for (auto &model: models) {
+        //
+        if (model->restore_state(is) == false) {
+            return false;
+        }
+    }
+
+    //
+    return true;
+}
+
+void
+PrivateModels::add_child_analyzer(Analyzer *analyzer)
+{
+    //
+    PrivateModels *child = dynamic_cast<PrivateModels*>(analyzer);
+
+    // E.g. private L1 and L2 caches, pair the copies of a core
+    if (child && child->models.size() == models.size()) {
+        //
+        for (size_t i = 0; i < models.size(); ++i) {
+            models[i]->add_child_analyzer(child->models[i].get());
+        }
+        //
+        return;
+    }
+
+    // The child sees every copy as its core side
+    for (auto &model: models) {
+        model->add_child_analyzer(analyzer);
+    }
+}
+
+void
+PrivateModels::add_core_side_analyzer(Analyzer *analyzer)
+{
+    for (auto &model: models) {
+        model->add_core_side_analyzer(analyzer);
+    }
+}
+
+bool
+PrivateModels::is_exclusive() const
+{
+    return models[0]->is_exclusive();
+}
+
+} // end namespace analyzer
+} // end namespace gltracesim
@@ -0,0 +1,118 @@
+#ifndef __GLTRACESIM_ANALYZER_PRIVATE_MODELS_HH__
+#define __GLTRACESIM_ANALYZER_PRIVATE_MODELS_HH__
+
+#include <vector>
+
+#include <json/json.h>
+
+#include "analyzer.hh"
+#include "packet.hh"
+
+namespace gltracesim {
+namespace analyzer {
+
+/**
+ * @brief The PrivateModels class, one copy of a model per core, e.g.
+ * private L1 caches. Packets go to the copy of their core (tid), the
+ * other calls to all copies in core order.
+ */
+class PrivateModels : public Analyzer
+{
+
+public:
+
+    /**
+     * @brief PrivateModels
+     * @param params of the model
+     * @param models copy of every core, indexed by tid
+     */
+    PrivateModels(const Json::Value &params,
+                  const std::vector<AnalyzerPtr> &models);
+
+    /**
+     * @brief ~PrivateModels
+     */
+    virtual ~PrivateModels();
+
+public:
+
+    /**
+     * @brief process
+     * @param pkt
+     */
+    void process(const packet_t &pkt);
+
+    /**
+     * @brief process_batch, a batch comes from one core
+     * @param pkts
+     */
+    void process_batch(const replay_batch_t &pkts);
+
+    /**
+     * @brief start_new_frame
+     * @param frame_id
+     */
+    void start_new_frame(int frame_id);
+
+    /**
+     * @brief start_new_scene
+     * @param frame_id
+     * @param scene_id
+     */
+    void start_new_scene(int frame_id, int scene_id);
+
+    /**
+     * @brief dump_stats
+     */
+    void dump_stats();
+
+    /**
+     * @brief reset_stats
+     */
+    void reset_stats();
+
+    /**
+     * @brief save_state
+     * @param os
+     */
+    void save_state(ProtoOutputStream *os);
+
+    /**
+     * @brief restore_state
+     * @param is
+     * @return
+     */
+    bool restore_state(ProtoInputStream *is);
+
+    /**
+     * @brief add_child_analyzer, shared by all copies, or copy by copy
+     * if the child is private as well
+     * @param analyzer
+     */
+    void add_child_analyzer(Analyzer *analyzer);
+
+    /**
+     * @brief add_core_side_analyzer, of all copies
+     * @param analyzer
+     */
+    void add_core_side_analyzer(Analyzer *analyzer);
+
+    /**
+     * @brief is_exclusive
+     * @return
+     */
+    bool is_exclusive() const;
+
+private:
+
+    /**
+     * @brief models
+     */
+    std::vector<AnalyzerPtr> models;
+
+};
+
+} // end namespace analyzer
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_ANALYZER_PRIVATE_MODELS_HH__
@@ -12,11 +12,15 @@ namespace gltracesim {
 namespace analyzer {
 namespace schedular {
 
-Schedular::Schedular(const Json::Value &params)
+Schedular::Schedular(const Json::Value &params) :
+    dump_schedule(true)
 {
     //
     system_barrier_id[dev::CPU] = 0;
     system_barrier_id[dev::GPU] = 0;
+    //
+    waiters[dev::CPU] = NULL;
+    waiters[dev::GPU] = NULL;
 
     //
     ProtoMessage::PacketHeader hdr;
@@ -28,7 +32,9 @@ Schedular::Schedular(const Json::Value &params)
 
     //
     pb.output_schedule = new ProtoOutputStream(
-        params["output-dir"].asString() + "/output_schedule.pb.gz"
+        ProtoStream::filename(
+            params["output-dir"].asString() + "/output_schedule"
+        )
     );
 
     pb.output_schedule->write(hdr);
@@ -43,6 +49,11 @@ Schedular::~Schedular()
 void
 Schedular::dump_schedule_descision(GpuJobPtr &job)
 {
+    // Warmup frames of a frame chunk
+    if (_u(dump_schedule == false)) {
+        return;
+    }
+
     //
     gltracesim::proto::JobSchedule schedule;
     //
@@ -53,6 +64,29 @@ Schedular::dump_schedule_descision(GpuJobPtr &job)
     pb.output_schedule->write(schedule);
 }
 
+void
+Schedular::interleave(
+    const std::deque<GpuJobPtr> &cpu_jobs,
+    const std::deque<GpuJobPtr> &gpu_jobs,
+    std::vector<GpuJobPtr> &jobs)
+{
+    //
+    size_t i = 0, j = 0;
+
+    // Proportional merge, both queues are expected to drain at the
+    // same time
+    while (i < cpu_jobs.size() || j < gpu_jobs.size()) {
+        //
+        if (j == gpu_jobs.size() ||
+            (i < cpu_jobs.size() &&
+             i * gpu_jobs.size() <= j * cpu_jobs.size())) {
+            jobs.push_back(cpu_jobs[i++]);
+        } else {
+            jobs.push_back(gpu_jobs[j++]);
+        }
+    }
+}
+
 bool
 Schedular::provide(uint64_t id)
 {
@@ -1,11 +1,15 @@
 #ifndef __GLTRACESIM_ANALYZER_SCHEDULAR_BASE_HH__
 #define __GLTRACESIM_ANALYZER_SCHEDULAR_BASE_HH__
 
+#include <deque>
+#include <vector>
 #include <json/json.h>
 
 #include "util/cflags.hh"
 #include "job.hh"
 
+#include "analyzer/event_queue.hh"
+
 namespace gltracesim {
 namespace analyzer {
 namespace schedular {
@@ -80,6 +84,15 @@ public:
         return job;
     }
 
+    /**
+     * @brief peek_jobs, the queued jobs in the order they are expected
+     * to be handed out, used to decode traces ahead of the cores
+     * @param jobs
+     */
+    virtual void peek_jobs(std::vector<GpuJobPtr> &jobs) {
+        // Do nothing
+    }
+
     /**
      * @brief start_new_frame
      */
@@ -90,6 +103,14 @@ public:
      */
     virtual void start_new_scene(int frame_id, int scene_id) = 0;
 
+    /**
+     * @brief set_dump_schedule, decisions are not written while disabled
+     * @param enable
+     */
+    void set_dump_schedule(bool enable) {
+        dump_schedule = enable;
+    }
+
 public:
 
     /**
@@ -112,6 +133,17 @@ public:
      */
     void set_gpu_ready(uint64_t id) {
         system_barrier_id[dev::GPU] = id;
+        //
+        notify(dev::GPU);
+    }
+
+    /**
+     * @brief wait_gpu_ready, wakes the event when the GPU reaches its
+     * next barrier
+     * @param event
+     */
+    void wait_gpu_ready(Event *event) {
+        waiters[dev::GPU] = event;
     }
 
     /**
@@ -134,6 +166,17 @@ public:
      */
     void set_cpu_ready(uint64_t id) {
         system_barrier_id[dev::CPU] = id;
+        //
+        notify(dev::CPU);
+    }
+
+    /**
+     * @brief wait_cpu_ready, wakes the event when the CPU reaches its
+     * next barrier
+     * @param event
+     */
+    void wait_cpu_ready(Event *event) {
+        waiters[dev::CPU] = event;
     }
 
     /**
@@ -150,6 +193,38 @@ public:
      */
     bool require(uint64_t id);
 
+protected:
+
+    /**
+     * @brief notify, wakes the event waiting for a device
+     * @param dev
+     */
+    void notify(int dev) {
+        //
+        Event *event = waiters[dev];
+
+        //
+        if (event) {
+            //
+            waiters[dev] = NULL;
+            //
+            event->wake();
+        }
+    }
+
+    /**
+     * @brief interleave the CPU and GPU job orders, the queues are
+     * drained in parallel
+     * @param cpu_jobs
+     * @param gpu_jobs
+     * @param jobs
+     */
+    static void interleave(
+        const std::deque<GpuJobPtr> &cpu_jobs,
+        const std::deque<GpuJobPtr> &gpu_jobs,
+        std::vector<GpuJobPtr> &jobs
+    );
+
 protected:
 
     /**
@@ -160,6 +235,11 @@ protected:
         ProtoOutputStream *output_schedule;
     } pb;
 
+    /**
+     * @brief dump_schedule
+     */
+    bool dump_schedule;
+
 protected:
 
     /**
@@ -174,6 +254,11 @@ protected:
      */
     std::array<uint64_t, 2> system_barrier_id;
 
+    /**
+     * @brief waiters, events waiting for a device to reach a barrier
+     */
+    std::array<Event*, 2> waiters;
+
     /**
      * @brief scoreboard
      */
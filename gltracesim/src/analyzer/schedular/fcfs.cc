@@ -53,6 +53,12 @@ FCFSSchedular::get_next_gpu_job(int core_id)
     return job;
 }
 
+void
+FCFSSchedular::peek_jobs(std::vector<GpuJobPtr> &jobs)
+{
+    interleave(cpu_queue, gpu_queue, jobs);
+}
+
 void
 FCFSSchedular::start_new_frame(int frame_id)
 {
@@ -42,6 +42,12 @@ public:
      */
     virtual GpuJobPtr get_next_gpu_job(int core_id);
 
+    /**
+     * @brief peek_jobs
+     * @param jobs
+     */
+    virtual void peek_jobs(std::vector<GpuJobPtr> &jobs);
+
     /**
      * @brief start_new_frame
      */
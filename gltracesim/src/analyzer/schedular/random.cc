@@ -53,6 +53,12 @@ RandomSchedular::get_next_gpu_job(int core_id)
     return job;
 }
 
+void
+RandomSchedular::peek_jobs(std::vector<GpuJobPtr> &jobs)
+{
+    interleave(cpu_queue, gpu_queue, jobs);
+}
+
 void
 RandomSchedular::start_new_frame(int frame_id)
 {
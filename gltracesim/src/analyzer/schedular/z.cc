@@ -80,6 +80,25 @@ ZSchedular::get_next_gpu_job(int core_id)
     return NULL;
 }
 
+void
+ZSchedular::peek_jobs(std::vector<GpuJobPtr> &jobs)
+{
+    // GPU queues are drained one after the other
+    std::deque<GpuJobPtr> gpu_queue(
+        gpu_draw_queue.begin(), gpu_draw_queue.end()
+    );
+    //
+    gpu_queue.insert(
+        gpu_queue.end(), gpu_tile_queue.begin(), gpu_tile_queue.end()
+    );
+    gpu_queue.insert(
+        gpu_queue.end(), gpu_misc_queue.begin(), gpu_misc_queue.end()
+    );
+
+    //
+    interleave(cpu_queue, gpu_queue, jobs);
+}
+
 void
 ZSchedular::start_new_frame(int frame_id)
 {
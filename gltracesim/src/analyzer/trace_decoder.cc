@@ -0,0 +1,234 @@
+#include "analyzer/trace_decoder.hh"
+
+#include "debug_impl.hh"
+
+namespace gltracesim {
+
+TraceDecoderPtr trace_decoder;
+
+TraceDecoder::TraceDecoder(const Json::Value &p)
+    : used(0), stop(false)
+{
+    //
+    budget = p.get("trace-decode-budget-mb", 512).asUInt64() << 20;
+
+    //
+    unsigned num_threads = p.get("trace-decode-threads", 2).asUInt();
+
+    //
+    DPRINTF(Init, "TraceDecoder [threads: %u, budget: %luMB].\n",
+        num_threads, budget >> 20
+    );
+
+    //
+    for (unsigned i = 0; i < num_threads; ++i) {
+        threads.emplace_back([this] { decode_loop(); });
+    }
+
+    // Blocks after the first are decoded by the core without threads
+    if (num_threads) {
+        GpuJob::schedule_read_ahead = [](const GpuJobPtr &job) {
+            trace_decoder->read_ahead(job);
+        };
+    }
+}
+
+TraceDecoder::~TraceDecoder()
+{
+    //
+    GpuJob::schedule_read_ahead = NULL;
+
+    //
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        //
+        stop = true;
+    }
+
+    //
+    cv.notify_all();
+
+    //
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    //
+    DPRINTF(Init, "TraceDecoder [ready: %lu, waits: %lu, misses: %lu, "
+        "read aheads: %lu].\n",
+        stats.no_ready, stats.no_waits, stats.no_misses,
+        stats.no_read_aheads
+    );
+}
+
+void
+TraceDecoder::prefetch(const std::vector<GpuJobPtr> &jobs)
+{
+    // Decode on demand only
+    if (threads.empty()) {
+        return;
+    }
+
+    //
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+
+        //
+        for (auto &job: jobs) {
+            //
+            if (state.count(job)) {
+                continue;
+            }
+            //
+            state[job] = QUEUED;
+            //
+            queue.push_back(job);
+        }
+    }
+
+    //
+    cv.notify_all();
+}
+
+void
+TraceDecoder::decode_loop()
+{
+    //
+    std::unique_lock<std::mutex> lock(mtx);
+
+    //
+    while (true) {
+        // Wait for work that fits in the budget
+        cv.wait(lock, [this] {
+            return stop || read_ahead_queue.size() ||
+                (queue.size() && used < budget);
+        });
+
+        //
+        if (stop) {
+            return;
+        }
+
+        // Cores wait on these first
+        if (read_ahead_queue.size()) {
+            //
+            GpuJobPtr job = read_ahead_queue.front();
+            //
+            read_ahead_queue.pop_front();
+
+            //
+            lock.unlock();
+            //
+            job->read_ahead();
+            //
+            job.reset();
+            //
+            lock.lock();
+
+            //
+            stats.no_read_aheads++;
+            //
+            continue;
+        }
+
+        //
+        GpuJobPtr job = queue.front();
+        //
+        queue.pop_front();
+
+        // Already picked up by a core
+        auto it = state.find(job);
+        //
+        if (it == state.end() || it->second != QUEUED) {
+            continue;
+        }
+
+        //
+        it->second = DECODING;
+
+        //
+        lock.unlock();
+        //
+        job->load_trace();
+        //
+        lock.lock();
+
+        //
+        state[job] = READY;
+        //
+        used += trace_size(job);
+
+        //
+        cv.notify_all();
+    }
+}
+
+void
+TraceDecoder::load(GpuJobPtr &job)
+{
+    //
+    std::unique_lock<std::mutex> lock(mtx);
+
+    //
+    auto it = state.find(job);
+
+    // Not queued or not started, decode it here
+    if (it == state.end() || it->second == QUEUED) {
+        //
+        if (it != state.end()) {
+            stats.no_misses++;
+        }
+
+        // Keep the workers away from it
+        state[job] = DECODING;
+
+        //
+        lock.unlock();
+        //
+        job->load_trace();
+        //
+        lock.lock();
+
+        //
+        state.erase(job);
+        //
+        return;
+    }
+
+    //
+    if (it->second == DECODING) {
+        //
+        stats.no_waits++;
+        //
+        cv.wait(lock, [&] { return state[job] == READY; });
+    } else {
+        //
+        stats.no_ready++;
+    }
+
+    // Hand over to the core, which frees budget
+    used -= trace_size(job);
+    //
+    state.erase(job);
+
+    //
+    lock.unlock();
+    //
+    cv.notify_all();
+}
+
+void
+TraceDecoder::read_ahead(const GpuJobPtr &job)
+{
+    //
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        //
+        read_ahead_queue.push_back(job);
+    }
+
+    //
+    cv.notify_one();
+}
+
+} // end namespace gltracesim
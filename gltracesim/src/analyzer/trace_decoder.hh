@@ -0,0 +1,189 @@
+#ifndef __GLTRACESIM_ANALYZER_TRACE_DECODER_HH__
+#define __GLTRACESIM_ANALYZER_TRACE_DECODER_HH__
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <json/json.h>
+
+#include "job.hh"
+
+namespace gltracesim {
+
+/**
+ * @brief The TraceDecoder class, decodes job traces ahead of the cores
+ * on a pool of threads. Jobs are opened and their first packets are
+ * buffered in the order the schedular expects to hand them out, as long
+ * as the buffered jobs not yet picked up by a core fit in the memory
+ * budget. The rest of a trace is streamed by the core, the threads
+ * read the next block of a trace ahead while the core replays the
+ * current one.
+ */
+class TraceDecoder {
+
+public:
+
+    /**
+     * @brief TraceDecoder
+     * @param params
+     */
+    TraceDecoder(const Json::Value &params);
+
+    /**
+     *
+     */
+    ~TraceDecoder();
+
+    /**
+     * @brief queue jobs for decoding, in the order they are expected
+     * to be picked up
+     * @param jobs
+     */
+    void prefetch(const std::vector<GpuJobPtr> &jobs);
+
+    /**
+     * @brief load the trace of a job, waits for it if it is being
+     * decoded and decodes it on the calling thread if it is not
+     * decoded yet
+     * @param job
+     */
+    void load(GpuJobPtr &job);
+
+    /**
+     * @brief read_ahead, queues the next block of a job for decoding,
+     * ahead of the jobs queued by prefetch
+     * @param job
+     */
+    void read_ahead(const GpuJobPtr &job);
+
+private:
+
+    /**
+     * @brief decode_loop
+     */
+    void decode_loop();
+
+    /**
+     * @brief The DecodeState enum
+     */
+    enum DecodeState {
+        QUEUED,
+        DECODING,
+        READY
+    };
+
+    /**
+     * @brief bytes of a decoded job trace
+     * @param job
+     * @return
+     */
+    static size_t trace_size(const GpuJobPtr &job) {
+        return job->buffered_size();
+    }
+
+    /**
+     * @brief mtx
+     */
+    std::mutex mtx;
+
+    /**
+     * @brief signalled when a job is decoded or budget is freed
+     */
+    std::condition_variable cv;
+
+    /**
+     * @brief queue of jobs to decode
+     */
+    std::deque<GpuJobPtr> queue;
+
+    /**
+     * @brief read_ahead_queue, jobs picked up by a core with a block to
+     * decode
+     */
+    std::deque<GpuJobPtr> read_ahead_queue;
+
+    /**
+     * @brief state of the jobs queued, decoding or decoded
+     */
+    std::unordered_map<GpuJobPtr, DecodeState> state;
+
+    /**
+     * @brief bytes of decoded jobs not yet picked up
+     */
+    size_t used;
+
+    /**
+     * @brief budget
+     */
+    size_t budget;
+
+    /**
+     * @brief stop
+     */
+    bool stop;
+
+    /**
+     * @brief threads
+     */
+    std::vector<std::thread> threads;
+
+public:
+
+    /**
+     * @brief The stats_t struct
+     */
+    struct stats_t {
+
+        /**
+         * @brief stats_t
+         */
+        stats_t() :
+            no_ready(0),
+            no_waits(0),
+            no_misses(0),
+            no_read_aheads(0)
+        {
+            // Do nothing
+        }
+
+        /**
+         * @brief jobs decoded before they were picked up
+         */
+        size_t no_ready;
+
+        /**
+         * @brief jobs picked up while being decoded
+         */
+        size_t no_waits;
+
+        /**
+         * @brief jobs decoded by the core itself
+         */
+        size_t no_misses;
+
+        /**
+         * @brief blocks read ahead
+         */
+        size_t no_read_aheads;
+
+    } stats;
+
+};
+
+/**
+ * @brief TraceDecoderPtr
+ */
+typedef std::unique_ptr<TraceDecoder> TraceDecoderPtr;
+
+/**
+ * @brief trace_decoder
+ */
+extern TraceDecoderPtr trace_decoder;
+
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_ANALYZER_TRACE_DECODER_HH__
@@ -25,19 +25,25 @@ TraceManager::TraceManager(const Json::Value &p)
     DPRINTF(Init, "TraceManager.\n");
 
     //
-    pb.frames = new ProtoInputStream(
-        p["input-dir"].asString() + "/frames.pb.gz"
+    std::string frames_file = ProtoStream::find(
+        p["input-dir"].asString() + "/frames"
     );
-    pb.scenes = new ProtoInputStream(
-        p["input-dir"].asString() + "/scenes.pb.gz"
+    std::string scenes_file = ProtoStream::find(
+        p["input-dir"].asString() + "/scenes"
     );
-    pb.jobs = new ProtoInputStream(
-        p["input-dir"].asString() + "/jobs.pb.gz"
+    std::string jobs_file = ProtoStream::find(
+        p["input-dir"].asString() + "/jobs"
     );
-    pb.resources = new ProtoInputStream(
-        p["input-dir"].asString() + "/resources.pb.gz"
+    std::string resources_file = ProtoStream::find(
+        p["input-dir"].asString() + "/resources"
     );
 
+    //
+    pb.frames = new ProtoInputStream(frames_file);
+    pb.scenes = new ProtoInputStream(scenes_file);
+    pb.jobs = new ProtoInputStream(jobs_file);
+    pb.resources = new ProtoInputStream(resources_file);
+
     //
     ProtoMessage::PacketHeader hdr;
 
@@ -47,6 +53,18 @@ TraceManager::TraceManager(const Json::Value &p)
     pb.jobs->read(hdr);
     pb.resources->read(hdr);
 
+    // Sidecar indices are optional, missing ones are built on demand
+    index.frames.load(frames_file + ".idx");
+    index.scenes.load(scenes_file + ".idx");
+    index.jobs.load(jobs_file + ".idx");
+    index.resources.load(resources_file + ".idx");
+
+    //
+    DPRINTF(Init, "Loaded indices [frames: %lu, scenes: %lu, jobs: %lu, "
+        "resources: %lu].\n",
+        index.frames.size(), index.scenes.size(),
+        index.jobs.size(), index.resources.size()
+    );
 }
 
 TraceManager::~TraceManager()
@@ -65,6 +83,63 @@ TraceManager::~TraceManager()
     delete pb.resources;
 }
 
+void
+TraceManager::rewind(ProtoInputStream *is)
+{
+    //
+    is->reset();
+
+    //
+    ProtoMessage::PacketHeader hdr;
+    is->read(hdr);
+}
+
+template <class info_t, class key_fn_t>
+bool
+TraceManager::seek(ProtoInputStream *is, ProtoIndex &index, size_t key,
+    key_fn_t key_fn)
+{
+    // No sidecar, build the index with a single pass over the stream
+    if (index.empty()) {
+        //
+        rewind(is);
+
+        //
+        for (size_t ordinal = 0; ; ++ordinal) {
+            //
+            ProtoStreamPos pos = is->tell();
+
+            //
+            info_t info;
+
+            //
+            if (is->read(info) == false) {
+                break;
+            }
+
+            //
+            index.insert(key_fn(info, ordinal), pos);
+        }
+
+        //
+        DPRINTF(Init, "Built index with %lu keys.\n", index.size());
+
+        //
+        rewind(is);
+    }
+
+    //
+    ProtoStreamPos pos;
+
+    //
+    if (index.find(key, pos) == false) {
+        return false;
+    }
+
+    //
+    return is->seek(pos);
+}
+
 void
 TraceManager::prefetch_fs_metadata()
 {
@@ -73,22 +148,48 @@ TraceManager::prefetch_fs_metadata()
         //
         GpuJobPtr &job = std::get<1>(it);
 
-        std::stringstream filename;
-        filename << system->get_input_dir() << "/"
+        std::stringstream basename;
+        basename << system->get_input_dir() << "/"
             << "f" << job->frame_id << "/"
             << "s" << job->scene_id << "/"
-            << "j" << job->id << ".trace.pb.gz";
+            << "j" << job->id << ".trace";
+
+        //
+        std::string filename = ProtoStream::find(basename.str());
 
         //
         std::ifstream ifs(
-            filename.str().c_str(), std::ios::in | std::ios::binary
+            filename.c_str(), std::ios::in | std::ios::binary
         );
 
         //
         if (!ifs.good()) {
-            DPRINTF(Warn, "Error reading %s\n", filename.str().c_str());
+            DPRINTF(Warn, "Error reading %s\n", filename.c_str());
+        }
+    }
+}
+
+size_t
+TraceManager::get_num_frames()
+{
+    // Every frame is indexed, build the index if there is no sidecar
+    bool found = seek<gltracesim::proto::FrameInfo>(
+        pb.frames, index.frames, 0,
+        [](const gltracesim::proto::FrameInfo &, size_t ordinal) {
+            return ordinal;
         }
+    );
+
+    //
+    if (found == false) {
+        rewind(pb.frames);
     }
+
+    //
+    frame_id = 0;
+
+    //
+    return index.frames.size();
 }
 
 FramePtr
@@ -102,12 +203,25 @@ TraceManager::get_frame(size_t id)
         return last_frame;
     }
 
-    // Start from beginning
-    if (frame_id < id) {
+    // Not the next frame in the stream, jump to it
+    if (frame_id != id) {
         //
-        frame_id = 0;
+        bool found = seek<gltracesim::proto::FrameInfo>(
+            pb.frames, index.frames, id,
+            [](const gltracesim::proto::FrameInfo &, size_t ordinal) {
+                return ordinal;
+            }
+        );
+
         //
-        pb.frames->reset();
+        if (found) {
+            frame_id = id;
+        } else if (frame_id > id) {
+            //
+            frame_id = 0;
+            //
+            rewind(pb.frames);
+        }
     }
 
     while (frame == NULL) {
@@ -155,12 +269,25 @@ TraceManager::get_scene(size_t id)
         return last_scene;
     }
 
-    // Start from beginning
-    if (scene_id < id) {
+    // Not the next scene in the stream, jump to it
+    if (scene_id != id) {
         //
-        scene_id = 0;
+        bool found = seek<gltracesim::proto::SceneInfo>(
+            pb.scenes, index.scenes, id,
+            [](const gltracesim::proto::SceneInfo &, size_t ordinal) {
+                return ordinal;
+            }
+        );
+
         //
-        pb.scenes->reset();
+        if (found) {
+            scene_id = id;
+        } else if (scene_id > id) {
+            //
+            scene_id = 0;
+            //
+            rewind(pb.scenes);
+        }
     }
 
     while (scene == NULL) {
@@ -218,12 +345,17 @@ TraceManager::get_job(size_t frame_id, size_t id)
         return jobs[id];
     }
 
-    // Start from beginning
-    if (job_frame_id < frame_id) {
-        //
-        job_frame_id = 0;
-        //
-        pb.jobs->reset();
+    // Jump to the first job of the frame
+    bool found = seek<gltracesim::proto::JobInfo>(
+        pb.jobs, index.jobs, frame_id,
+        [](const gltracesim::proto::JobInfo &info, size_t) {
+            return info.frame_id();
+        }
+    );
+
+    //
+    if (found == false) {
+        rewind(pb.jobs);
     }
 
     // Wait
@@ -318,12 +450,25 @@ TraceManager::get_resource(size_t id)
     //
     GpuResourcePtr resource = NULL;
 
-    // Start from beginning
-    if (resource_id < id) {
+    // Not the next resource in the stream, jump to it
+    if (resource_id != id) {
         //
-        resource_id = 0;
+        bool found = seek<gltracesim::proto::ResourceInfo>(
+            pb.resources, index.resources, id,
+            [](const gltracesim::proto::ResourceInfo &, size_t ordinal) {
+                return ordinal;
+            }
+        );
+
         //
-        pb.resources->reset();
+        if (found) {
+            resource_id = id;
+        } else if (resource_id > id) {
+            //
+            resource_id = 0;
+            //
+            rewind(pb.resources);
+        }
     }
 
     while (resource == NULL) {
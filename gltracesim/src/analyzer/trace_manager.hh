@@ -9,6 +9,8 @@
 #include "scene.hh"
 #include "job.hh"
 
+#include "gem5/protoio.hh"
+
 namespace gltracesim {
 
 class TraceManager {
@@ -42,8 +44,29 @@ private:
         ProtoInputStream *resources;
     } pb;
 
+    /**
+     * @brief Offset indices of the metadata streams, loaded from the
+     * sidecar files or built on the first out-of-order access.
+     */
+    struct index_t {
+        //
+        ProtoIndex frames;
+        //
+        ProtoIndex scenes;
+        //
+        ProtoIndex jobs;
+        //
+        ProtoIndex resources;
+    } index;
+
 public:
 
+    /**
+     * @brief get_num_frames
+     * @return frames in the trace
+     */
+    size_t get_num_frames();
+
     /**
      * @brief get_frame
      * @param id
@@ -74,6 +97,25 @@ public:
 
 private:
 
+    /**
+     * @brief rewind stream to the first message after the header
+     * @param is
+     */
+    void rewind(ProtoInputStream *is);
+
+    /**
+     * @brief seek stream to the first message with key, building the
+     * index with a single pass over the stream if needed
+     * @param is
+     * @param index
+     * @param key
+     * @param key_fn maps a message and its ordinal to its key
+     * @return true if the key was found
+     */
+    template <class info_t, class key_fn_t>
+    bool seek(ProtoInputStream *is, ProtoIndex &index, size_t key,
+        key_fn_t key_fn);
+
     /**
      * @brief prefetch_fs_metadata
      */
@@ -25,6 +25,7 @@ Debug::debug_flag_names[] = {
     "GpuThreadEvent",
     "Prefetcher",
     "VirtualMemoryManager",
+    "Telemetry",
 };
 
 const char*
@@ -42,6 +42,7 @@ public:
         GpuThreadEvent,
         Prefetcher,
         VirtualMemoryManager,
+        Telemetry,
         NUM_DEBUG_FLAGS
     };
 
@@ -0,0 +1,1015 @@
+/**
+ * @file
+ * Definition of a seekable block container for proto streams.
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __GLTRACESIM_ZSTD_ON__
+#include <zstd.h>
+#endif
+
+#ifdef __GLTRACESIM_LZ4_ON__
+#include <lz4frame.h>
+#endif
+
+#ifndef __USING_PIN__
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "gem5/blockio.hh"
+
+using namespace std;
+
+namespace {
+
+/// Trailer magic, "GTBS"
+const uint32_t trailerMagic = 0x53425447;
+
+/// Version of the block stream format
+const uint32_t trailerVersion = 1;
+
+/// Size of the trailer payload
+const size_t trailerSize = 24;
+
+/// Size of a directory entry
+const size_t entrySize = 24;
+
+void
+put32(string& s, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) {
+        s.push_back(char((v >> (8 * i)) & 0xff));
+    }
+}
+
+void
+put64(string& s, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i) {
+        s.push_back(char((v >> (8 * i)) & 0xff));
+    }
+}
+
+uint32_t
+get32(const char* p)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= uint32_t((unsigned char) p[i]) << (8 * i);
+    }
+    return v;
+}
+
+uint64_t
+get64(const char* p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v |= uint64_t((unsigned char) p[i]) << (8 * i);
+    }
+    return v;
+}
+
+string
+extension(const string& filename)
+{
+    size_t dot = filename.find_last_of('.');
+    return dot == string::npos ? string() : filename.substr(dot + 1);
+}
+
+#if defined(__GLTRACESIM_ZSTD_ON__) || defined(__GLTRACESIM_LZ4_ON__)
+/// Magic number of the skippable frames of zstd and LZ4, the low
+/// nibble is free to use
+const uint32_t skippableMagic = 0x184d2a50;
+
+void
+writeSkippable(BlockCodec::MetadataType type, const string& payload,
+               string& frame)
+{
+    put32(frame, skippableMagic | type);
+    put32(frame, payload.size());
+    frame.append(payload);
+}
+
+bool
+readSkippable(BlockCodec::MetadataType type, const char* frame,
+              size_t frameSize, string& payload)
+{
+    if (frameSize < 8 || get32(frame) != (skippableMagic | type) ||
+        get32(frame + 4) != frameSize - 8) {
+        return false;
+    }
+
+    payload.assign(frame + 8, frameSize - 8);
+    return true;
+}
+#endif
+
+#ifndef __USING_PIN__
+/**
+ * Threads decompressing blocks ahead of the readers of all block
+ * streams. The threads live as long as the process, so moving to
+ * another position never waits for a thread to start or to finish a
+ * block that is no longer needed.
+ */
+class DecodePool
+{
+
+  public:
+
+    /**
+     * Pool of the calling process. Threads do not survive a fork, so
+     * a forked child gets a new pool and the inherited one is leaked.
+     */
+    static DecodePool& get();
+
+    /**
+     * Grow the pool to at least a number of threads.
+     */
+    void reserve(unsigned numThreads);
+
+    /**
+     * Queue a task for the next idle thread.
+     */
+    void submit(function<void()> task);
+
+  private:
+
+    /**
+     * Run tasks until the process exits.
+     */
+    void work();
+
+    /// Protects the queue
+    mutex mtx;
+
+    /// Signalled when a task is queued
+    condition_variable cv;
+
+    /// Tasks in submission order
+    deque<function<void()>> tasks;
+
+    /// Worker threads, never joined
+    vector<thread> threads;
+
+};
+
+DecodePool&
+DecodePool::get()
+{
+    static mutex poolMtx;
+    static DecodePool* pool = NULL;
+    static pid_t owner = 0;
+
+    lock_guard<mutex> lock(poolMtx);
+    if (pool == NULL || owner != getpid()) {
+        pool = new DecodePool;
+        owner = getpid();
+    }
+
+    return *pool;
+}
+
+void
+DecodePool::reserve(unsigned numThreads)
+{
+    lock_guard<mutex> lock(mtx);
+    while (threads.size() < numThreads) {
+        threads.emplace_back(&DecodePool::work, this);
+        threads.back().detach();
+    }
+}
+
+void
+DecodePool::submit(function<void()> task)
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        tasks.push_back(move(task));
+    }
+    cv.notify_one();
+}
+
+void
+DecodePool::work()
+{
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(mtx);
+            cv.wait(lock, [this] { return !tasks.empty(); });
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+#endif
+
+} // end anonymous namespace
+
+bool
+BlockCodec::supported(const string& ext)
+{
+    if (ext == "gz") {
+        return true;
+    }
+#ifdef __GLTRACESIM_ZSTD_ON__
+    if (ext == "zst") {
+        return true;
+    }
+#endif
+#ifdef __GLTRACESIM_LZ4_ON__
+    if (ext == "lz4") {
+        return true;
+    }
+#endif
+    return false;
+}
+
+BlockCodec*
+BlockCodec::create(const string& filename)
+{
+    string ext = extension(filename);
+
+    if (ext == "gz") {
+        return new GzipBlockCodec();
+    }
+#ifdef __GLTRACESIM_ZSTD_ON__
+    if (ext == "zst") {
+        return new ZstdBlockCodec();
+    }
+#endif
+#ifdef __GLTRACESIM_LZ4_ON__
+    if (ext == "lz4") {
+        return new Lz4BlockCodec();
+    }
+#endif
+
+    if (ext == "zst" || ext == "lz4") {
+        printf("Cannot open %s, built without %s support\n",
+               filename.c_str(), ext.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    return NULL;
+}
+
+BlockCodec*
+BlockCodec::detect(const unsigned char* bytes, size_t size)
+{
+    GzipBlockCodec gzip;
+    if (gzip.matchMagic(bytes, size)) {
+        return new GzipBlockCodec();
+    }
+#ifdef __GLTRACESIM_ZSTD_ON__
+    ZstdBlockCodec zstd;
+    if (zstd.matchMagic(bytes, size)) {
+        return new ZstdBlockCodec();
+    }
+#endif
+#ifdef __GLTRACESIM_LZ4_ON__
+    Lz4BlockCodec lz4;
+    if (lz4.matchMagic(bytes, size)) {
+        return new Lz4BlockCodec();
+    }
+#endif
+    return NULL;
+}
+
+void
+GzipBlockCodec::compress(const char* data, size_t size, string& frame) const
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+
+    // A window of 15 bits plus 16 selects a gzip wrapper
+    int ret = deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8,
+                           Z_DEFAULT_STRATEGY);
+    assert(ret == Z_OK);
+
+    size_t start = frame.size();
+    frame.resize(start + deflateBound(&zs, size));
+
+    zs.next_in = (Bytef*) data;
+    zs.avail_in = size;
+    zs.next_out = (Bytef*) &frame[start];
+    zs.avail_out = frame.size() - start;
+
+    ret = deflate(&zs, Z_FINISH);
+    assert(ret == Z_STREAM_END);
+
+    frame.resize(start + zs.total_out);
+    deflateEnd(&zs);
+}
+
+bool
+GzipBlockCodec::decompress(const char* frame, size_t frameSize,
+                           char* data, size_t size) const
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        return false;
+    }
+
+    zs.next_in = (Bytef*) frame;
+    zs.avail_in = frameSize;
+    zs.next_out = (Bytef*) data;
+    zs.avail_out = size;
+
+    int ret = inflate(&zs, Z_FINISH);
+    bool ok = (ret == Z_STREAM_END) && (zs.total_out == size);
+
+    inflateEnd(&zs);
+    return ok;
+}
+
+void
+GzipBlockCodec::writeMetadata(MetadataType type, const string& payload,
+                              string& frame) const
+{
+    assert(payload.size() <= maxMetadataSize());
+
+    // Empty gzip member with the payload as a subfield of the extra
+    // field (RFC 1952), gzip decoders skip the extra field
+    static const char header[] = {
+        '\x1f', '\x8b', '\x08', '\x04', 0, 0, 0, 0, 0, '\xff'
+    };
+    frame.append(header, sizeof(header));
+
+    uint16_t xlen = payload.size() + 4;
+    frame.push_back(char(xlen & 0xff));
+    frame.push_back(char(xlen >> 8));
+    frame.push_back('G');
+    frame.push_back(type == BlockDirectory ? 'D' : 'T');
+    frame.push_back(char(payload.size() & 0xff));
+    frame.push_back(char(payload.size() >> 8));
+    frame.append(payload);
+
+    // Empty final deflate block, CRC32 and size of the empty data
+    static const char footer[] = { 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    frame.append(footer, sizeof(footer));
+
+    assert(frame.size() >= metadataSize(payload.size()));
+}
+
+bool
+GzipBlockCodec::readMetadata(MetadataType type, const char* frame,
+                             size_t frameSize, string& payload) const
+{
+    if (frameSize < metadataSize(0)) {
+        return false;
+    }
+
+    const unsigned char* p = (const unsigned char*) frame;
+    if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 0x08 || p[3] != 0x04) {
+        return false;
+    }
+
+    size_t xlen = p[10] | (p[11] << 8);
+    size_t len = p[14] | (p[15] << 8);
+    if (p[12] != 'G' || p[13] != (type == BlockDirectory ? 'D' : 'T') ||
+        xlen != len + 4 || metadataSize(len) != frameSize) {
+        return false;
+    }
+
+    payload.assign(frame + 16, len);
+    return true;
+}
+
+#ifdef __GLTRACESIM_ZSTD_ON__
+void
+ZstdBlockCodec::compress(const char* data, size_t size, string& frame) const
+{
+    size_t start = frame.size();
+    frame.resize(start + ZSTD_compressBound(size));
+
+    size_t ret = ZSTD_compress(&frame[start], frame.size() - start,
+                               data, size, level);
+    assert(!ZSTD_isError(ret));
+
+    frame.resize(start + ret);
+}
+
+bool
+ZstdBlockCodec::decompress(const char* frame, size_t frameSize,
+                           char* data, size_t size) const
+{
+    size_t ret = ZSTD_decompress(data, size, frame, frameSize);
+    return !ZSTD_isError(ret) && ret == size;
+}
+
+void
+ZstdBlockCodec::writeMetadata(MetadataType type, const string& payload,
+                              string& frame) const
+{
+    writeSkippable(type, payload, frame);
+}
+
+bool
+ZstdBlockCodec::readMetadata(MetadataType type, const char* frame,
+                             size_t frameSize, string& payload) const
+{
+    return readSkippable(type, frame, frameSize, payload);
+}
+#endif
+
+#ifdef __GLTRACESIM_LZ4_ON__
+void
+Lz4BlockCodec::compress(const char* data, size_t size, string& frame) const
+{
+    LZ4F_preferences_t prefs;
+    memset(&prefs, 0, sizeof(prefs));
+    prefs.frameInfo.contentSize = size;
+
+    size_t start = frame.size();
+    frame.resize(start + LZ4F_compressFrameBound(size, &prefs));
+
+    size_t ret = LZ4F_compressFrame(&frame[start], frame.size() - start,
+                                    data, size, &prefs);
+    assert(!LZ4F_isError(ret));
+
+    frame.resize(start + ret);
+}
+
+bool
+Lz4BlockCodec::decompress(const char* frame, size_t frameSize,
+                          char* data, size_t size) const
+{
+    LZ4F_dctx* dctx;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx,
+                                                     LZ4F_VERSION))) {
+        return false;
+    }
+
+    // The frame decoder may stop early, keep feeding it
+    size_t in = 0, out = 0, ret = 1;
+    while (ret != 0 && in < frameSize) {
+        size_t srcSize = frameSize - in;
+        size_t dstSize = size - out;
+        ret = LZ4F_decompress(dctx, data + out, &dstSize, frame + in,
+                              &srcSize, NULL);
+        if (LZ4F_isError(ret)) {
+            break;
+        }
+        in += srcSize;
+        out += dstSize;
+    }
+
+    LZ4F_freeDecompressionContext(dctx);
+    return ret == 0 && out == size;
+}
+
+void
+Lz4BlockCodec::writeMetadata(MetadataType type, const string& payload,
+                             string& frame) const
+{
+    writeSkippable(type, payload, frame);
+}
+
+bool
+Lz4BlockCodec::readMetadata(MetadataType type, const char* frame,
+                            size_t frameSize, string& payload) const
+{
+    return readSkippable(type, frame, frameSize, payload);
+}
+#endif
+
+BlockOutputStream::BlockOutputStream(ostream* out, BlockCodec* codec,
+                                     size_t blockSize) :
+    out(out), codec(codec), blockSize(blockSize), buffer(blockSize),
+    used(0), fileOffset(0), flushedBytes(0), closed(false)
+{
+    assert(blockSize > 0);
+}
+
+BlockOutputStream::~BlockOutputStream()
+{
+    close();
+}
+
+bool
+BlockOutputStream::Next(void** data, int* size)
+{
+    assert(!closed);
+
+    // Messages are never split, grow the buffer if a message does not
+    // fit in the remainder of the block
+    if (used == buffer.size()) {
+        buffer.resize(buffer.size() * 2);
+    }
+
+    *data = &buffer[used];
+    *size = min<size_t>(buffer.size() - used, INT_MAX);
+    used += *size;
+
+    return true;
+}
+
+void
+BlockOutputStream::BackUp(int count)
+{
+    assert(count >= 0 && (size_t) count <= used);
+    used -= count;
+}
+
+int64_t
+BlockOutputStream::ByteCount() const
+{
+    return flushedBytes + used;
+}
+
+void
+BlockOutputStream::sync()
+{
+    if (used >= blockSize) {
+        flushBlock();
+    }
+}
+
+void
+BlockOutputStream::flushBlock()
+{
+    if (used == 0) {
+        return;
+    }
+
+    frame.clear();
+    codec->compress(buffer.data(), used, frame);
+    out->write(frame.data(), frame.size());
+
+    BlockInfo info;
+    info.offset = fileOffset;
+    info.frameSize = frame.size();
+    info.size = used;
+    directory.push_back(info);
+
+    fileOffset += frame.size();
+    flushedBytes += used;
+    used = 0;
+
+    // Give back memory of blocks that outgrew the block size
+    if (buffer.size() > blockSize) {
+        buffer.resize(blockSize);
+        buffer.shrink_to_fit();
+    }
+}
+
+void
+BlockOutputStream::close()
+{
+    if (closed) {
+        return;
+    }
+
+    flushBlock();
+
+    uint64_t dirOffset = fileOffset;
+
+    // Directory, split over as many metadata frames as needed
+    size_t perFrame = codec->maxMetadataSize() / entrySize;
+    for (size_t i = 0; i < directory.size(); i += perFrame) {
+        string payload;
+        for (size_t j = i; j < min(i + perFrame, directory.size()); ++j) {
+            put64(payload, directory[j].offset);
+            put64(payload, directory[j].frameSize);
+            put64(payload, directory[j].size);
+        }
+
+        frame.clear();
+        codec->writeMetadata(BlockCodec::BlockDirectory, payload, frame);
+        out->write(frame.data(), frame.size());
+        fileOffset += frame.size();
+    }
+
+    // Fixed size trailer pointing at the directory
+    string payload;
+    put32(payload, trailerMagic);
+    put32(payload, trailerVersion);
+    put64(payload, dirOffset);
+    put64(payload, directory.size());
+    assert(payload.size() == trailerSize);
+
+    frame.clear();
+    codec->writeMetadata(BlockCodec::BlockTrailer, payload, frame);
+    out->write(frame.data(), frame.size());
+    fileOffset += frame.size();
+
+    out->flush();
+    closed = true;
+}
+
+#ifndef __USING_PIN__
+/**
+ * A block decompressed ahead of the reader. The job is claimed by
+ * either a pool thread or the reader, whichever gets to it first, and
+ * a job dropped before it is claimed never touches the stream.
+ */
+struct BlockInputStream::DecodeJob
+{
+    enum State {
+        Queued,
+        Running,
+        Done,
+        Dropped
+    };
+
+    DecodeJob(size_t idx) : idx(idx), state(Queued), ok(false) {}
+
+    /**
+     * Take a queued job.
+     *
+     * @return False if it is running, done or dropped
+     */
+    bool claim()
+    {
+        lock_guard<mutex> lock(mtx);
+        if (state != Queued) {
+            return false;
+        }
+        state = Running;
+        return true;
+    }
+
+    /**
+     * Publish the result of a claimed job.
+     */
+    void finish(bool result)
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            ok = result;
+            state = Done;
+        }
+        cv.notify_all();
+    }
+
+    /**
+     * Cancel a job that is not claimed yet.
+     *
+     * @return False if it is still running
+     */
+    bool drop()
+    {
+        lock_guard<mutex> lock(mtx);
+        if (state == Queued) {
+            state = Dropped;
+        }
+        return state != Running;
+    }
+
+    /**
+     * Wait for a claimed job to finish.
+     */
+    void wait()
+    {
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [this] { return state == Done; });
+    }
+
+    /// Index of the block
+    size_t idx;
+
+    /// Protects the state and the result
+    mutex mtx;
+
+    /// Signalled when the job is done
+    condition_variable cv;
+
+    /// Progress of the job
+    State state;
+
+    /// Block was decoded
+    bool ok;
+
+    /// Uncompressed data of the block
+    string data;
+};
+#endif
+
+BlockInputStream::BlockInputStream(const string& filename, BlockCodec* codec,
+                                   unsigned lookahead) :
+    fd(-1), codec(codec), lookahead(lookahead), isValid(false),
+    current(0), pos(0), failed(false)
+{
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    isValid = readDirectory();
+    if (isValid) {
+#ifndef __USING_PIN__
+        if (lookahead > 0) {
+            DecodePool::get().reserve(lookahead);
+        }
+#endif
+        loadBlock(0);
+    }
+}
+
+BlockInputStream::~BlockInputStream()
+{
+#ifndef __USING_PIN__
+    // Decoders still reading the file finish before it is closed
+    for (auto& job : pending) {
+        dropJob(job);
+    }
+    for (auto& job : dropped) {
+        job->wait();
+    }
+#endif
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool
+BlockInputStream::readAt(uint64_t offset, size_t size, string& data) const
+{
+    data.resize(size);
+
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = ::pread(fd, &data[done], size - done, offset + done);
+        if (ret <= 0) {
+            return false;
+        }
+        done += ret;
+    }
+
+    return true;
+}
+
+bool
+BlockInputStream::readDirectory()
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+
+    uint64_t fileSize = st.st_size;
+    size_t trailerFrameSize = codec->metadataSize(trailerSize);
+    if (fileSize < trailerFrameSize) {
+        return false;
+    }
+
+    // Trailer
+    uint64_t trailerOffset = fileSize - trailerFrameSize;
+    string frame, payload;
+    if (!readAt(trailerOffset, trailerFrameSize, frame) ||
+        !codec->readMetadata(BlockCodec::BlockTrailer, frame.data(),
+                             frame.size(), payload) ||
+        payload.size() != trailerSize ||
+        get32(&payload[0]) != trailerMagic ||
+        get32(&payload[4]) != trailerVersion) {
+        return false;
+    }
+
+    uint64_t dirOffset = get64(&payload[8]);
+    uint64_t numBlocks = get64(&payload[16]);
+    if (dirOffset > trailerOffset || numBlocks == 0) {
+        return false;
+    }
+
+    // Directory
+    string dir;
+    if (!readAt(dirOffset, trailerOffset - dirOffset, dir)) {
+        return false;
+    }
+
+    size_t perFrame = codec->maxMetadataSize() / entrySize;
+    size_t dirPos = 0;
+    while (directory.size() < numBlocks) {
+        size_t count = min<uint64_t>(perFrame, numBlocks - directory.size());
+        size_t size = codec->metadataSize(count * entrySize);
+
+        if (dirPos + size > dir.size() ||
+            !codec->readMetadata(BlockCodec::BlockDirectory,
+                                 dir.data() + dirPos, size, payload) ||
+            payload.size() != count * entrySize) {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            BlockInfo info;
+            info.offset = get64(&payload[i * entrySize]);
+            info.frameSize = get64(&payload[i * entrySize + 8]);
+            info.size = get64(&payload[i * entrySize + 16]);
+            directory.push_back(info);
+        }
+
+        dirPos += size;
+    }
+
+    // Uncompressed offsets of the blocks
+    uint64_t offset = 0;
+    for (auto& info : directory) {
+        startOffsets.push_back(offset);
+        offset += info.size;
+    }
+
+    return true;
+}
+
+bool
+BlockInputStream::decodeBlock(size_t idx, string& data) const
+{
+    const BlockInfo& info = directory[idx];
+
+    string frame;
+    data.resize(info.size);
+
+    return readAt(info.offset, info.frameSize, frame) &&
+           codec->decompress(frame.data(), frame.size(), &data[0],
+                             data.size());
+}
+
+#ifndef __USING_PIN__
+void
+BlockInputStream::dropJob(const shared_ptr<DecodeJob>& job)
+{
+    if (!job->drop()) {
+        dropped.push_back(job);
+    }
+}
+#endif
+
+bool
+BlockInputStream::loadBlock(size_t idx)
+{
+    assert(idx < directory.size());
+
+    bool ok;
+
+#ifndef __USING_PIN__
+    // Forget finished jobs dropped earlier
+    dropped.erase(remove_if(dropped.begin(), dropped.end(),
+        [](const shared_ptr<DecodeJob>& job) { return job->drop(); }),
+        dropped.end());
+
+    // Drop blocks decoded ahead for a different position, without
+    // waiting for them
+    while (!pending.empty() && pending.front()->idx != idx) {
+        dropJob(pending.front());
+        pending.pop_front();
+    }
+
+    if (!pending.empty()) {
+        shared_ptr<DecodeJob> job = pending.front();
+        pending.pop_front();
+
+        // Not started yet, decode it here rather than wait for a thread
+        if (job->claim()) {
+            ok = decodeBlock(idx, block);
+            job->finish(ok);
+        } else {
+            job->wait();
+            ok = job->ok;
+            block.swap(job->data);
+        }
+    } else {
+        ok = decodeBlock(idx, block);
+    }
+
+    // Keep the decoders busy with the following blocks
+    size_t next = pending.empty() ? idx + 1 : pending.back()->idx + 1;
+    while (ok && pending.size() < lookahead && next < directory.size()) {
+        shared_ptr<DecodeJob> job = make_shared<DecodeJob>(next);
+        DecodePool::get().submit([this, job] {
+            if (job->claim()) {
+                job->finish(decodeBlock(job->idx, job->data));
+            }
+        });
+        pending.push_back(job);
+        ++next;
+    }
+#else
+    ok = decodeBlock(idx, block);
+#endif
+
+    current = idx;
+    pos = 0;
+
+    // The messages of the block are lost, end the stream like a
+    // corrupt gzip stream does
+    if (!ok) {
+        printf("Unable to decompress block at offset %lu\n",
+               directory[idx].offset);
+        block.clear();
+        failed = true;
+    }
+
+    return ok;
+}
+
+bool
+BlockInputStream::Next(const void** data, int* size)
+{
+    if (failed) {
+        return false;
+    }
+
+    // Move on to the next non-empty block
+    while (pos == block.size()) {
+        if (current + 1 >= directory.size() || !loadBlock(current + 1)) {
+            return false;
+        }
+    }
+
+    *data = block.data() + pos;
+    *size = min<size_t>(block.size() - pos, INT_MAX);
+    pos += *size;
+
+    return true;
+}
+
+void
+BlockInputStream::BackUp(int count)
+{
+    assert(count >= 0 && (size_t) count <= pos);
+    pos -= count;
+}
+
+bool
+BlockInputStream::Skip(int count)
+{
+    if (count < 0) {
+        return false;
+    }
+    return seekTo(ByteCount() + count);
+}
+
+int64_t
+BlockInputStream::ByteCount() const
+{
+    return startOffsets[current] + pos;
+}
+
+bool
+BlockInputStream::seekTo(uint64_t offset)
+{
+    if (failed) {
+        return false;
+    }
+
+    uint64_t total = startOffsets.back() + directory.back().size;
+
+    // Park at the end of the stream
+    if (offset >= total) {
+        if (current != directory.size() - 1 &&
+            !loadBlock(directory.size() - 1)) {
+            return false;
+        }
+        pos = block.size();
+        return offset == total;
+    }
+
+    // Whole blocks in between are never decompressed
+    size_t idx = upper_bound(startOffsets.begin(), startOffsets.end(),
+                             offset) - startOffsets.begin() - 1;
+    if (idx != current && !loadBlock(idx)) {
+        return false;
+    }
+    pos = offset - startOffsets[idx];
+
+    return pos <= block.size();
+}
+
+bool
+BlockInputStream::seek(uint64_t blockOffset, uint64_t offset)
+{
+    auto it = lower_bound(directory.begin(), directory.end(), blockOffset,
+        [](const BlockInfo& info, uint64_t off) {
+            return info.offset < off;
+        });
+
+    if (it == directory.end() || it->offset != blockOffset) {
+        return false;
+    }
+
+    return seekTo(startOffsets[it - directory.begin()] + offset);
+}
+
+uint64_t
+BlockInputStream::blockOffset() const
+{
+    return directory[current].offset;
+}
@@ -0,0 +1,509 @@
+/**
+ * @file
+ * Declaration of a seekable block container for proto streams.
+ *
+ * A block stream is the plain proto stream (magic number, header and
+ * length-prefixed messages) cut at message boundaries into blocks that
+ * are compressed independently. The blocks are followed by a block
+ * directory and a fixed size trailer pointing at the directory, both
+ * stored in metadata frames that regular decoders of the codec format
+ * skip. A block stream written with the gzip codec is therefore also a
+ * valid multi-member gzip file decompressing to the legacy stream.
+ */
+
+#ifndef __PROTO_BLOCKIO_HH__
+#define __PROTO_BLOCKIO_HH__
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef __USING_PIN__
+#include <memory>
+#endif
+
+/**
+ * A BlockCodec compresses the blocks of a block stream into self
+ * contained frames, and wraps metadata in frames that are ignored when
+ * the file is decoded as a regular file of the codec format.
+ */
+class BlockCodec
+{
+
+  public:
+
+    /// Metadata frame types
+    enum MetadataType {
+        BlockDirectory = 1,
+        BlockTrailer = 2,
+    };
+
+    virtual ~BlockCodec() {}
+
+    /**
+     * Compress a block into a self contained frame.
+     *
+     * @param data Uncompressed block
+     * @param size Size of the uncompressed block
+     * @param frame Compressed frame is appended here
+     */
+    virtual void compress(const char* data, size_t size,
+                          std::string& frame) const = 0;
+
+    /**
+     * Decompress a frame.
+     *
+     * @param frame Compressed frame
+     * @param frameSize Size of the compressed frame
+     * @param data Buffer of the uncompressed size of the block
+     * @param size Uncompressed size of the block
+     * @return True if the frame decompressed to exactly size bytes
+     */
+    virtual bool decompress(const char* frame, size_t frameSize,
+                            char* data, size_t size) const = 0;
+
+    /**
+     * Wrap a metadata payload in a frame skipped by regular decoders.
+     *
+     * @param type Type of the metadata
+     * @param payload Payload of at most maxMetadataSize() bytes
+     * @param frame Metadata frame is appended here
+     */
+    virtual void writeMetadata(MetadataType type,
+                               const std::string& payload,
+                               std::string& frame) const = 0;
+
+    /**
+     * Extract the payload of a metadata frame.
+     *
+     * @param type Expected type of the metadata
+     * @param frame Metadata frame
+     * @param frameSize Size of the metadata frame
+     * @param payload Payload of the metadata frame
+     * @return True if the frame is a metadata frame of the given type
+     */
+    virtual bool readMetadata(MetadataType type, const char* frame,
+                              size_t frameSize,
+                              std::string& payload) const = 0;
+
+    /**
+     * Size of a metadata frame holding a payload of a given size.
+     */
+    virtual size_t metadataSize(size_t payloadSize) const = 0;
+
+    /**
+     * Largest payload of a single metadata frame.
+     */
+    virtual size_t maxMetadataSize() const = 0;
+
+    /**
+     * Check if a file starts like a frame of this codec.
+     */
+    virtual bool matchMagic(const unsigned char* bytes,
+                            size_t size) const = 0;
+
+    /**
+     * Create the codec for a file name, based on its extension (gz,
+     * zst or lz4). Exits if the codec is not compiled in.
+     *
+     * @param filename File name
+     * @return Codec, or NULL for uncompressed files
+     */
+    static BlockCodec* create(const std::string& filename);
+
+    /**
+     * Check if a codec extension is known and compiled in.
+     *
+     * @param ext Extension without the dot
+     */
+    static bool supported(const std::string& ext);
+
+    /**
+     * Create the codec matching the first bytes of a file.
+     *
+     * @param bytes First bytes of the file
+     * @param size Number of bytes
+     * @return Codec, or NULL if no codec matches
+     */
+    static BlockCodec* detect(const unsigned char* bytes, size_t size);
+
+};
+
+/**
+ * Gzip codec, every block is a gzip member and metadata is stored in
+ * the extra field of empty gzip members.
+ */
+class GzipBlockCodec : public BlockCodec
+{
+
+  public:
+
+    /**
+     * @param level zlib compression level
+     */
+    GzipBlockCodec(int level = -1) : level(level) {}
+
+    void compress(const char* data, size_t size,
+                  std::string& frame) const override;
+
+    bool decompress(const char* frame, size_t frameSize,
+                    char* data, size_t size) const override;
+
+    void writeMetadata(MetadataType type, const std::string& payload,
+                       std::string& frame) const override;
+
+    bool readMetadata(MetadataType type, const char* frame,
+                      size_t frameSize,
+                      std::string& payload) const override;
+
+    size_t metadataSize(size_t payloadSize) const override {
+        return payloadSize + 26;
+    }
+
+    size_t maxMetadataSize() const override { return 65531; }
+
+    bool matchMagic(const unsigned char* bytes,
+                    size_t size) const override {
+        return size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b;
+    }
+
+  private:
+
+    /// zlib compression level
+    int level;
+
+};
+
+#ifdef __GLTRACESIM_ZSTD_ON__
+/**
+ * Zstandard codec, every block is a zstd frame and metadata is stored
+ * in skippable frames.
+ */
+class ZstdBlockCodec : public BlockCodec
+{
+
+  public:
+
+    /**
+     * @param level zstd compression level
+     */
+    ZstdBlockCodec(int level = 3) : level(level) {}
+
+    void compress(const char* data, size_t size,
+                  std::string& frame) const override;
+
+    bool decompress(const char* frame, size_t frameSize,
+                    char* data, size_t size) const override;
+
+    void writeMetadata(MetadataType type, const std::string& payload,
+                       std::string& frame) const override;
+
+    bool readMetadata(MetadataType type, const char* frame,
+                      size_t frameSize,
+                      std::string& payload) const override;
+
+    size_t metadataSize(size_t payloadSize) const override {
+        return payloadSize + 8;
+    }
+
+    size_t maxMetadataSize() const override { return 1 << 20; }
+
+    bool matchMagic(const unsigned char* bytes,
+                    size_t size) const override {
+        return size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 &&
+            bytes[2] == 0x2f && bytes[3] == 0xfd;
+    }
+
+  private:
+
+    /// zstd compression level
+    int level;
+
+};
+#endif
+
+#ifdef __GLTRACESIM_LZ4_ON__
+/**
+ * LZ4 codec, every block is an LZ4 frame and metadata is stored in
+ * skippable frames.
+ */
+class Lz4BlockCodec : public BlockCodec
+{
+
+  public:
+
+    void compress(const char* data, size_t size,
+                  std::string& frame) const override;
+
+    bool decompress(const char* frame, size_t frameSize,
+                    char* data, size_t size) const override;
+
+    void writeMetadata(MetadataType type, const std::string& payload,
+                       std::string& frame) const override;
+
+    bool readMetadata(MetadataType type, const char* frame,
+                      size_t frameSize,
+                      std::string& payload) const override;
+
+    size_t metadataSize(size_t payloadSize) const override {
+        return payloadSize + 8;
+    }
+
+    size_t maxMetadataSize() const override { return 1 << 20; }
+
+    bool matchMagic(const unsigned char* bytes,
+                    size_t size) const override {
+        return size >= 4 && bytes[0] == 0x04 && bytes[1] == 0x22 &&
+            bytes[2] == 0x4d && bytes[3] == 0x18;
+    }
+
+};
+#endif
+
+/**
+ * Block directory entry.
+ */
+struct BlockInfo
+{
+    /// File offset of the compressed frame
+    uint64_t offset;
+
+    /// Size of the compressed frame
+    uint64_t frameSize;
+
+    /// Uncompressed size of the block
+    uint64_t size;
+};
+
+/**
+ * Zero-copy output stream buffering the uncompressed data of the
+ * current block. The owner calls sync() at message boundaries, which
+ * compresses and writes the block once it exceeds the block size.
+ */
+class BlockOutputStream : public google::protobuf::io::ZeroCopyOutputStream
+{
+
+  public:
+
+    /**
+     * @param out File to write to, owned by the caller
+     * @param codec Codec used for the blocks, owned by the caller
+     * @param blockSize Uncompressed size after which a block is cut
+     */
+    BlockOutputStream(std::ostream* out, BlockCodec* codec,
+                      size_t blockSize);
+
+    /**
+     * Flush the last block and write the directory, if not closed yet.
+     */
+    ~BlockOutputStream();
+
+    bool Next(void** data, int* size) override;
+
+    void BackUp(int count) override;
+
+    int64_t ByteCount() const override;
+
+    /**
+     * Called at message boundaries, cuts the block when it is full.
+     */
+    void sync();
+
+    /**
+     * Flush the last block, and write the block directory and the
+     * trailer.
+     */
+    void close();
+
+    /**
+     * File offset of the current block.
+     */
+    uint64_t blockOffset() const { return fileOffset; }
+
+    /**
+     * Uncompressed offset within the current block.
+     */
+    uint64_t offset() const { return used; }
+
+  private:
+
+    /**
+     * Compress and write the current block.
+     */
+    void flushBlock();
+
+    /// File written to
+    std::ostream* out;
+
+    /// Codec of the blocks
+    BlockCodec* codec;
+
+    /// Uncompressed size after which a block is cut
+    size_t blockSize;
+
+    /// Uncompressed data of the current block
+    std::vector<char> buffer;
+
+    /// Bytes used in the buffer
+    size_t used;
+
+    /// Size of the file so far
+    uint64_t fileOffset;
+
+    /// Uncompressed bytes of all flushed blocks
+    uint64_t flushedBytes;
+
+    /// Directory of the flushed blocks
+    std::vector<BlockInfo> directory;
+
+    /// Scratch space for compressed frames
+    std::string frame;
+
+    /// Set once the directory is written
+    bool closed;
+
+};
+
+/**
+ * Zero-copy input stream over a block stream. Skipping moves over
+ * whole blocks without decompressing them, and the next blocks can be
+ * decompressed ahead of the reader on a pool of threads shared by all
+ * block streams. A block that cannot be read or decompressed ends the
+ * stream.
+ */
+class BlockInputStream : public google::protobuf::io::ZeroCopyInputStream
+{
+
+  public:
+
+    /**
+     * Open a block stream. Use valid() to check if the file actually
+     * is a block stream, legacy files have no trailer.
+     *
+     * @param filename File to read from
+     * @param codec Codec of the blocks, owned by the caller
+     * @param lookahead Number of blocks to decompress ahead
+     */
+    BlockInputStream(const std::string& filename, BlockCodec* codec,
+                     unsigned lookahead);
+
+    ~BlockInputStream();
+
+    /**
+     * Check if the file has a valid trailer and directory.
+     */
+    bool valid() const { return isValid; }
+
+    bool Next(const void** data, int* size) override;
+
+    void BackUp(int count) override;
+
+    bool Skip(int count) override;
+
+    int64_t ByteCount() const override;
+
+    /**
+     * Move to an uncompressed offset within the block starting at a
+     * file offset. Offsets beyond the end of the block continue into
+     * the next blocks.
+     *
+     * @param blockOffset File offset of the block
+     * @param offset Uncompressed offset within the block
+     * @return True if the position exists
+     */
+    bool seek(uint64_t blockOffset, uint64_t offset);
+
+    /**
+     * File offset of the current block.
+     */
+    uint64_t blockOffset() const;
+
+    /**
+     * Uncompressed offset within the current block.
+     */
+    uint64_t offset() const { return pos; }
+
+  private:
+
+    /**
+     * Read the trailer and the directory.
+     */
+    bool readDirectory();
+
+    /**
+     * Move to an offset in the uncompressed stream.
+     */
+    bool seekTo(uint64_t offset);
+
+    /**
+     * Read a part of the file.
+     */
+    bool readAt(uint64_t offset, size_t size, std::string& data) const;
+
+    /**
+     * Read and decompress a block.
+     *
+     * @return False if the block cannot be read or decompressed
+     */
+    bool decodeBlock(size_t idx, std::string& data) const;
+
+    /**
+     * Make a block the current block.
+     *
+     * @return False if the block cannot be decoded, the stream fails
+     */
+    bool loadBlock(size_t idx);
+
+    /// File descriptor
+    int fd;
+
+    /// Codec of the blocks
+    BlockCodec* codec;
+
+    /// Number of blocks decompressed ahead of the reader
+    unsigned lookahead;
+
+    /// File has a trailer and a directory
+    bool isValid;
+
+    /// Block directory
+    std::vector<BlockInfo> directory;
+
+    /// Uncompressed offset of every block
+    std::vector<uint64_t> startOffsets;
+
+    /// Index of the current block, directory.size() at the end
+    size_t current;
+
+    /// Uncompressed data of the current block
+    std::string block;
+
+    /// Read position within the current block
+    size_t pos;
+
+    /// A block could not be decoded, nothing more is read
+    bool failed;
+
+#ifndef __USING_PIN__
+    /// A block queued for decompression on the decode pool
+    struct DecodeJob;
+
+    /**
+     * Stop waiting for a block decompressed ahead of the reader. A
+     * queued job is cancelled, a running one is kept until it is done.
+     */
+    void dropJob(const std::shared_ptr<DecodeJob>& job);
+
+    /// Blocks being decompressed ahead of the reader, in block order
+    std::deque<std::shared_ptr<DecodeJob>> pending;
+
+    /// Dropped blocks still being decompressed, waited for on close
+    std::vector<std::shared_ptr<DecodeJob>> dropped;
+#endif
+
+};
+
+#endif //__PROTO_BLOCKIO_HH__
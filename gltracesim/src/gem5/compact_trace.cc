@@ -0,0 +1,92 @@
+#include <cassert>
+
+#include "gem5/compact_trace.hh"
+
+namespace gltracesim {
+namespace gem5 {
+
+CompactTraceEncoder::CompactTraceEncoder(
+    const ProtoMessage::CompactTraceHeader &hdr)
+    : num_records(0), blk_shift(hdr.blk_shift()), blk(0),
+      rsc_id(hdr.rsc_id()), job_id(hdr.job_id()), dev_id(hdr.dev_id()),
+      size(hdr.size())
+{
+    // Do nothing
+}
+
+void
+CompactTraceEncoder::put_varint(uint64_t v)
+{
+    //
+    while (v >= 0x80) {
+        data.push_back(char((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    //
+    data.push_back(char(v));
+}
+
+void
+CompactTraceEncoder::encode(const packet_t &pkt)
+{
+    assert(pkt.cmd == READ || pkt.cmd == WRITE);
+
+    //
+    uint64_t pkt_blk = pkt.paddr >> blk_shift;
+    uint64_t offset = pkt.paddr & ((uint64_t(1) << blk_shift) - 1);
+
+    // Fields that differ from the previous record
+    uint32_t flags = 0;
+    //
+    if (uint32_t(pkt.rsc_id) != rsc_id) flags |= CT_RSC_ID;
+    if (uint32_t(pkt.job_id) != job_id) flags |= CT_JOB_ID;
+    if (uint32_t(pkt.dev_id) != dev_id) flags |= CT_DEV_ID;
+    if (offset) flags |= CT_OFFSET;
+    if (uint32_t(pkt.length) != size) flags |= CT_SIZE;
+
+    //
+    uint64_t v = zigzag_encode(int64_t(pkt_blk - blk)) << 2;
+    //
+    if (pkt.cmd == WRITE) v |= CT_WRITE;
+    if (flags) v |= CT_ESCAPE;
+
+    //
+    put_varint(v);
+
+    //
+    if (flags) {
+        //
+        put_varint(flags);
+        //
+        if (flags & CT_RSC_ID) put_varint(uint32_t(pkt.rsc_id));
+        if (flags & CT_JOB_ID) put_varint(uint32_t(pkt.job_id));
+        if (flags & CT_DEV_ID) put_varint(pkt.dev_id);
+        if (flags & CT_OFFSET) put_varint(offset);
+        if (flags & CT_SIZE) put_varint(pkt.length);
+    }
+
+    //
+    blk = pkt_blk;
+    rsc_id = pkt.rsc_id;
+    job_id = pkt.job_id;
+    dev_id = pkt.dev_id;
+    size = pkt.length;
+
+    //
+    ++num_records;
+}
+
+void
+CompactTraceEncoder::flush(ProtoMessage::CompactPacketBlock *pb_blk)
+{
+    //
+    pb_blk->set_count(num_records);
+    pb_blk->mutable_data()->swap(data);
+
+    //
+    data.clear();
+    num_records = 0;
+}
+
+} // end namespace gem5
+} // end namespace gltracesim
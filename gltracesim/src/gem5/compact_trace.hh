@@ -0,0 +1,253 @@
+#ifndef __GLTRACESIM_COMPACT_TRACE_HH__
+#define __GLTRACESIM_COMPACT_TRACE_HH__
+
+#include <string>
+#include <cstdint>
+
+#include "packet.hh"
+#include "gem5/packet.pb.h"
+
+namespace gltracesim {
+namespace gem5 {
+
+/**
+ * Compact job trace format.
+ *
+ * A compact trace is a proto stream with a PacketHeader of version 1,
+ * a CompactTraceHeader with the initial per-job fields, and a sequence
+ * of CompactPacketBlock messages. Every block holds varint encoded
+ * records, one per access:
+ *
+ *   record  := varint(zigzag(blk - prev_blk) << 2 | ESCAPE | WRITE)
+ *              [ varint(flags) [rsc_id] [job_id] [dev_id] [offset] [size] ]
+ *
+ * The address is delta encoded in blocks of the trace block size. The
+ * escape part is only present when a field differs from the previous
+ * record (run-length encoding of rsc_id, job_id, dev_id and size) or
+ * the address is not block aligned. Ticks are implicit.
+ */
+enum CompactTraceVersion {
+    PacketTraceVersion = 0,
+    CompactTraceVersion = 1,
+};
+
+enum CompactRecordBits {
+    CT_WRITE = 0x1,
+    CT_ESCAPE = 0x2,
+};
+
+enum CompactEscapeFlags {
+    CT_RSC_ID = 0x1,
+    CT_JOB_ID = 0x2,
+    CT_DEV_ID = 0x4,
+    CT_OFFSET = 0x8,
+    CT_SIZE = 0x10,
+};
+
+/**
+ * @brief zigzag encode a signed delta
+ */
+inline uint64_t
+zigzag_encode(int64_t v)
+{
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+/**
+ * @brief zigzag decode a signed delta
+ */
+inline int64_t
+zigzag_decode(uint64_t v)
+{
+    return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+/**
+ * @brief The CompactTraceEncoder class, encodes packets into records.
+ */
+class CompactTraceEncoder
+{
+
+public:
+
+    /**
+     * @brief CompactTraceEncoder
+     * @param hdr initial field values
+     */
+    CompactTraceEncoder(const ProtoMessage::CompactTraceHeader &hdr);
+
+    /**
+     * @brief encode packet
+     * @param pkt
+     */
+    void encode(const packet_t &pkt);
+
+    /**
+     * @brief number of records in the current block
+     */
+    uint32_t count() const {
+        return num_records;
+    }
+
+    /**
+     * @brief move the current block into a message and start a new one
+     * @param blk
+     */
+    void flush(ProtoMessage::CompactPacketBlock *blk);
+
+private:
+
+    /**
+     * @brief put_varint
+     * @param v
+     */
+    void put_varint(uint64_t v);
+
+    /**
+     * @brief encoded records of the current block
+     */
+    std::string data;
+
+    /**
+     * @brief num_records in the current block
+     */
+    uint32_t num_records;
+
+    /**
+     * @brief blk_shift
+     */
+    uint32_t blk_shift;
+
+    /**
+     * @brief previous field values
+     */
+    uint64_t blk;
+    uint32_t rsc_id;
+    uint32_t job_id;
+    uint32_t dev_id;
+    uint32_t size;
+
+};
+
+/**
+ * @brief The CompactTraceDecoder class, decodes the records of one
+ * block at a time.
+ */
+class CompactTraceDecoder
+{
+
+public:
+
+    /**
+     * @brief CompactTraceDecoder
+     * @param hdr initial field values
+     */
+    CompactTraceDecoder(const ProtoMessage::CompactTraceHeader &hdr)
+        : pos(NULL), end(NULL), blk_shift(hdr.blk_shift()), blk(0),
+          rsc_id(hdr.rsc_id()), job_id(hdr.job_id()),
+          dev_id(hdr.dev_id()), size(hdr.size())
+    {
+        // Do nothing
+    }
+
+    /**
+     * @brief set the records to decode, the data must outlive decoding
+     * @param data
+     * @param length
+     */
+    void set_block(const char *data, size_t length) {
+        pos = (const uint8_t*) data;
+        end = pos + length;
+    }
+
+    /**
+     * @brief decode the next record of the block
+     * @param pkt
+     * @return false at the end of the block
+     */
+    bool next(packet_t &pkt) {
+        //
+        if (pos == end) {
+            return false;
+        }
+
+        //
+        uint64_t v = get_varint();
+        uint64_t offset = 0;
+
+        //
+        if (v & CT_ESCAPE) {
+            //
+            uint64_t flags = get_varint();
+            //
+            if (flags & CT_RSC_ID) rsc_id = get_varint();
+            if (flags & CT_JOB_ID) job_id = get_varint();
+            if (flags & CT_DEV_ID) dev_id = get_varint();
+            if (flags & CT_OFFSET) offset = get_varint();
+            if (flags & CT_SIZE) size = get_varint();
+        }
+
+        //
+        blk += zigzag_decode(v >> 2);
+
+        //
+        pkt.cmd = (v & CT_WRITE) ? WRITE : READ;
+        pkt.paddr = (blk << blk_shift) | offset;
+        pkt.length = size;
+        pkt.rsc_id = rsc_id;
+        pkt.job_id = job_id;
+        pkt.dev_id = dev_id;
+
+        //
+        return true;
+    }
+
+private:
+
+    /**
+     * @brief get_varint, truncated data ends the block
+     * @return
+     */
+    uint64_t get_varint() {
+        //
+        uint64_t v = 0;
+        //
+        for (int shift = 0; pos != end && shift < 64; shift += 7) {
+            uint8_t b = *pos++;
+            v |= uint64_t(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                return v;
+            }
+        }
+        //
+        pos = end;
+        //
+        return v;
+    }
+
+    /**
+     * @brief read position within the block
+     */
+    const uint8_t *pos;
+    const uint8_t *end;
+
+    /**
+     * @brief blk_shift
+     */
+    uint32_t blk_shift;
+
+    /**
+     * @brief current field values
+     */
+    uint64_t blk;
+    uint32_t rsc_id;
+    uint32_t job_id;
+    uint32_t dev_id;
+    uint32_t size;
+
+};
+
+} // end namespace gem5
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_COMPACT_TRACE_HH__
@@ -37,36 +37,301 @@
  * Authors: Andreas Hansson
  */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <unordered_map>
+
 #include "system.hh"
+#include "gem5/packet.pb.h"
 #include "gem5/protoio.hh"
+#include "util/threads.hh"
 
 using namespace std;
 using namespace google::protobuf;
 
+bool
+ProtoIndex::load(const string& filename)
+{
+    // Check for the sidecar before handing it to the input stream,
+    // which treats a missing file as a fatal error
+    ifstream probe(filename.c_str(), ios::in | ios::binary);
+    if (!probe.good()) {
+        return false;
+    }
+    probe.close();
+
+    ProtoInputStream is(filename);
+    if (!is.good()) {
+        return false;
+    }
+
+    ProtoMessage::IndexEntry entry;
+    while (is.read(entry)) {
+        insert(entry.key(),
+               ProtoStreamPos(entry.blk_offset(), entry.offset()));
+    }
+
+    return true;
+}
+
+void
+ProtoIndex::insert(uint64_t key, const ProtoStreamPos& pos)
+{
+    // Keys are normally appended in order, fall back to a sorted
+    // insert otherwise
+    if (entries.empty() || entries.back().first < key) {
+        entries.emplace_back(key, pos);
+        return;
+    }
+
+    auto it = lower_bound(entries.begin(), entries.end(), key,
+        [](const pair<uint64_t, ProtoStreamPos>& e, uint64_t k) {
+            return e.first < k;
+        });
+
+    if (it == entries.end() || it->first != key) {
+        entries.emplace(it, key, pos);
+    }
+}
+
+bool
+ProtoIndex::find(uint64_t key, ProtoStreamPos& pos) const
+{
+    auto it = lower_bound(entries.begin(), entries.end(), key,
+        [](const pair<uint64_t, ProtoStreamPos>& e, uint64_t k) {
+            return e.first < k;
+        });
+
+    if (it == entries.end() || it->first != key) {
+        return false;
+    }
+
+    pos = it->second;
+    return true;
+}
+
+bool
+CountingInputStream::Next(const void** data, int* size)
+{
+    if (!stream->Next(data, size)) {
+        return false;
+    }
+    count += *size;
+    return true;
+}
+
+void
+CountingInputStream::BackUp(int size)
+{
+    stream->BackUp(size);
+    count -= size;
+}
+
+bool
+CountingInputStream::Skip(int size)
+{
+    // Skip through Next/BackUp to keep the count exact
+    while (size > 0) {
+        const void* data;
+        int avail;
+        if (!Next(&data, &avail)) {
+            return false;
+        }
+        if (avail > size) {
+            BackUp(avail - size);
+            size = 0;
+        } else {
+            size -= avail;
+        }
+    }
+    return true;
+}
+
+const uint64_t MmapInputStream::chunkSize;
+
+MmapInputStream::MmapInputStream(const string& filename) :
+    base(NULL), size(0), pos(0), lastSize(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    // Empty files cannot be mapped, leave them to the regular reader
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // Streams are mostly read front to back, let the kernel
+            // read ahead aggressively
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            base = (const char*) addr;
+            size = st.st_size;
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MmapInputStream::~MmapInputStream()
+{
+    if (base != NULL) {
+        munmap((void*) base, size);
+    }
+}
+
+bool
+MmapInputStream::Next(const void** data, int* count)
+{
+    if (pos == size) {
+        lastSize = 0;
+        return false;
+    }
+
+    lastSize = min(size - pos, chunkSize);
+    *data = base + pos;
+    *count = lastSize;
+    pos += lastSize;
+    return true;
+}
+
+void
+MmapInputStream::BackUp(int count)
+{
+    assert(count >= 0 && count <= lastSize);
+    pos -= count;
+    lastSize -= count;
+}
+
+bool
+MmapInputStream::Skip(int count)
+{
+    lastSize = 0;
+    if (count < 0) {
+        return false;
+    }
+    if (size - pos < (uint64_t) count) {
+        pos = size;
+        return false;
+    }
+    pos += count;
+    return true;
+}
+
+bool
+MmapInputStream::seek(uint64_t offset)
+{
+    lastSize = 0;
+    if (offset > size) {
+        return false;
+    }
+    pos = offset;
+    return true;
+}
+
+string ProtoStream::defaultCodec = "gz";
+
+namespace {
+
+/// Stream extension of every directory searched by ProtoStream::find
+unordered_map<string, string> dirExtensions;
+
+/// Protects dirExtensions
+gltracesim::Mutex findMutex;
+
+} // end anonymous namespace
+
+size_t ProtoOutputStream::blockSize = 1 << 20;
+
+string
+ProtoStream::filename(const string& basename)
+{
+    if (defaultCodec == "none") {
+        return basename + ".pb";
+    }
+    return basename + ".pb." + defaultCodec;
+}
+
+string
+ProtoStream::find(const string& basename)
+{
+    // The streams of a directory are written with one codec, so only
+    // the first lookup in a directory probes the file system
+    size_t slash = basename.find_last_of('/');
+    string dir = slash == string::npos ? string() : basename.substr(0, slash);
+
+    findMutex.lock();
+    auto it = dirExtensions.find(dir);
+    if (it != dirExtensions.end()) {
+        string filename = basename + it->second;
+        findMutex.unlock();
+        return filename;
+    }
+    findMutex.unlock();
+
+    // Prefer the default codec, then try all others
+    for (const char* ext : { defaultCodec.c_str(), "gz", "zst", "lz4",
+                             "none" }) {
+        string suffix = ".pb";
+        if (string(ext) != "none") {
+            suffix += string(".") + ext;
+        }
+        if (ifstream((basename + suffix).c_str()).good()) {
+            findMutex.lock();
+            dirExtensions[dir] = suffix;
+            findMutex.unlock();
+            return basename + suffix;
+        }
+    }
+    return filename(basename);
+}
+
+void
+ProtoStream::setDefaultCodec(const string& ext)
+{
+    if (ext != "none" && !BlockCodec::supported(ext)) {
+        printf("Unsupported proto stream codec %s\n", ext.c_str());
+        exit(EXIT_FAILURE);
+    }
+    defaultCodec = ext;
+}
+
+unsigned ProtoInputStream::decodeThreads = 0;
+
 ProtoOutputStream::ProtoOutputStream(const string& filename) :
+    fileName(filename),
     fileStream(filename.c_str(), ios::out | ios::binary | ios::trunc),
-    wrappedFileStream(NULL), gzipStream(NULL), zeroCopyStream(NULL)
+    wrappedFileStream(NULL), codec(NULL), blockStream(NULL),
+    zeroCopyStream(NULL), indexStream(NULL), lastKey(0)
 {
     if (!fileStream.good()) {
         printf("Could not open %s for writing\n", filename.c_str());
         exit(EXIT_FAILURE);
     }
 
-    // Wrap the output file in a zero copy stream, that in turn is
-    // wrapped in a gzip stream if the filename ends with .gz. The
-    // latter stream is in turn wrapped in a coded stream
-    wrappedFileStream = new io::OstreamOutputStream(&fileStream);
-    if (filename.find_last_of('.') != string::npos &&
-        filename.substr(filename.find_last_of('.') + 1) == "gz") {
-        gzipStream = new io::GzipOutputStream(wrappedFileStream);
-        zeroCopyStream = gzipStream;
+    // Compressed files are written as block streams of independently
+    // compressed blocks, picking the codec based on the extension.
+    // Uncompressed files are wrapped in a zero copy stream. Either is
+    // in turn wrapped in a coded stream
+    codec = BlockCodec::create(filename);
+    if (codec != NULL) {
+        blockStream = new BlockOutputStream(&fileStream, codec, blockSize);
+        zeroCopyStream = blockStream;
     } else {
+        wrappedFileStream = new io::OstreamOutputStream(&fileStream);
         zeroCopyStream = wrappedFileStream;
     }
 
     // Write the magic number to the file
-    io::CodedOutputStream codedStream(zeroCopyStream);
-    codedStream.WriteLittleEndian32(magicNumber);
+    {
+        io::CodedOutputStream codedStream(zeroCopyStream);
+        codedStream.WriteLittleEndian32(magicNumber);
+    }
 
     // Note that each type of stream (packet, instruction etc) should
     // add its own header and perform the appropriate checks
@@ -74,10 +339,16 @@ ProtoOutputStream::ProtoOutputStream(const string& filename) :
 
 ProtoOutputStream::~ProtoOutputStream()
 {
+    if (indexStream != NULL)
+        delete indexStream;
     // As the compression is optional, see if the stream exists
-    if (gzipStream != NULL)
-        delete gzipStream;
-    delete wrappedFileStream;
+    if (blockStream != NULL) {
+        blockStream->close();
+        delete blockStream;
+        delete codec;
+    }
+    if (wrappedFileStream != NULL)
+        delete wrappedFileStream;
     fileStream.close();
 }
 
@@ -87,19 +358,64 @@ ProtoOutputStream::write(const Message& msg)
     // Due to the byte limit of the coded stream we create it for
     // every single mesage (based on forum discussions around the size
     // limitation)
-    io::CodedOutputStream codedStream(zeroCopyStream);
+    {
+        io::CodedOutputStream codedStream(zeroCopyStream);
+
+        // Write the size of the message to the stream
+        codedStream.WriteVarint32(msg.ByteSize());
 
-    // Write the size of the message to the stream
-    codedStream.WriteVarint32(msg.ByteSize());
+        // Write the message itself to the stream
+        msg.SerializeWithCachedSizes(&codedStream);
+    }
+
+    // Blocks are only cut at message boundaries, once the coded
+    // stream has returned any unused buffer space
+    if (blockStream != NULL)
+        blockStream->sync();
+}
+
+void
+ProtoOutputStream::write(const Message& msg, uint64_t key)
+{
+    // Only the first message of every key is indexed
+    if (indexStream == NULL || key != lastKey) {
+        if (indexStream == NULL) {
+            indexStream = new ProtoOutputStream(fileName + ".idx");
+        }
+
+        ProtoStreamPos pos = tell();
+
+        ProtoMessage::IndexEntry entry;
+        entry.set_key(key);
+        entry.set_blk_offset(pos.blk_offset);
+        entry.set_offset(pos.offset);
+        indexStream->write(entry);
+
+        lastKey = key;
+    }
 
-    // Write the message itself to the stream
-    msg.SerializeWithCachedSizes(&codedStream);
+    write(msg);
+}
+
+ProtoStreamPos
+ProtoOutputStream::tell() const
+{
+    if (blockStream != NULL) {
+        return ProtoStreamPos(blockStream->blockOffset(),
+                              blockStream->offset());
+    }
+
+    // The coded streams are destroyed after every message, which
+    // returns any unused buffer space, so the byte count is exact
+    return ProtoStreamPos(0, zeroCopyStream->ByteCount());
 }
 
 ProtoInputStream::ProtoInputStream(const string& filename) :
     fileStream(filename.c_str(), ios::in | ios::binary), fileName(filename),
-    useGzip(false), magic_check(0),
-    wrappedFileStream(NULL), gzipStream(NULL), zeroCopyStream(NULL)
+    useGzip(false), codec(NULL), blockStream(NULL), mmapStream(NULL),
+    magic_check(0),
+    wrappedFileStream(NULL), gzipStream(NULL), countingStream(NULL),
+    zeroCopyStream(NULL)
 {
     if (!fileStream.good()) {
         printf("Could not open %s for reading\n", filename.c_str());
@@ -107,20 +423,22 @@ ProtoInputStream::ProtoInputStream(const string& filename) :
         gltracesim::system->stop();
     }
 
-    if (filename.find_last_of('.') != string::npos &&
-        filename.substr(filename.find_last_of('.') + 1) == "gz") {
-        useGzip = true;
-    } else {
-        // check the magic number to see if this is a gzip stream
-        unsigned char bytes[2];
-        fileStream.read((char*) bytes, 2);
-        useGzip = fileStream.good() && bytes[0] == 0x1f && bytes[1] == 0x8b;
+    codec = BlockCodec::create(filename);
+    if (codec == NULL) {
+        // check the magic number to see if this is a compressed stream
+        unsigned char bytes[4] = { 0 };
+        fileStream.read((char*) bytes, 4);
+        codec = BlockCodec::detect(bytes, fileStream.gcount());
 
         // seek to the start of the input file and clear any flags
         fileStream.clear();
         fileStream.seekg(0, ifstream::beg);
     }
 
+    // Compressed files without a block directory are legacy
+    // single-member gzip streams
+    useGzip = dynamic_cast<GzipBlockCodec*>(codec) != NULL;
+
     createStreams();
 }
 
@@ -128,18 +446,45 @@ void
 ProtoInputStream::createStreams()
 {
     // All streams should be NULL at this point
-    assert(wrappedFileStream == NULL && gzipStream == NULL &&
+    assert(blockStream == NULL && mmapStream == NULL &&
+           wrappedFileStream == NULL &&
+           gzipStream == NULL && countingStream == NULL &&
            zeroCopyStream == NULL);
 
-    // Wrap the input file in a zero copy stream, that in turn is
-    // wrapped in a gzip stream if the filename ends with .gz. The
+    // Compressed files with a block directory are read block by block
+    if (codec != NULL) {
+        blockStream = new BlockInputStream(fileName, codec, decodeThreads);
+        if (blockStream->valid()) {
+            zeroCopyStream = blockStream;
+        } else {
+            delete blockStream;
+            blockStream = NULL;
+        }
+    }
+
+    // Uncompressed files are parsed straight from the page cache
+    if (codec == NULL) {
+        mmapStream = new MmapInputStream(fileName);
+        if (mmapStream->valid()) {
+            zeroCopyStream = mmapStream;
+        } else {
+            delete mmapStream;
+            mmapStream = NULL;
+        }
+    }
+
+    // Otherwise wrap the input file in a zero copy stream, that in
+    // turn is wrapped in a gzip stream if the file is compressed. The
     // latter stream is in turn wrapped in a coded stream
-    wrappedFileStream = new io::IstreamInputStream(&fileStream);
-    if (useGzip) {
-        gzipStream = new io::GzipInputStream(wrappedFileStream);
-        zeroCopyStream = gzipStream;
-    } else {
-        zeroCopyStream = wrappedFileStream;
+    if (zeroCopyStream == NULL) {
+        wrappedFileStream = new io::IstreamInputStream(&fileStream);
+        if (useGzip) {
+            gzipStream = new io::GzipInputStream(wrappedFileStream);
+            countingStream = new CountingInputStream(gzipStream);
+        } else {
+            countingStream = new CountingInputStream(wrappedFileStream);
+        }
+        zeroCopyStream = countingStream;
     }
 
     io::CodedInputStream codedStream(zeroCopyStream);
@@ -156,6 +501,15 @@ ProtoInputStream::createStreams()
 void
 ProtoInputStream::destroyStreams()
 {
+    delete blockStream;
+    blockStream = NULL;
+
+    delete mmapStream;
+    mmapStream = NULL;
+
+    delete countingStream;
+    countingStream = NULL;
+
     // As the compression is optional, see if the stream exists
     if (gzipStream != NULL) {
         delete gzipStream;
@@ -172,6 +526,7 @@ ProtoInputStream::~ProtoInputStream()
 {
     destroyStreams();
     fileStream.close();
+    delete codec;
 }
 
 
@@ -185,18 +540,68 @@ ProtoInputStream::reset()
     createStreams();
 }
 
+ProtoStreamPos
+ProtoInputStream::tell() const
+{
+    if (blockStream != NULL) {
+        return ProtoStreamPos(blockStream->blockOffset(),
+                              blockStream->offset());
+    }
+
+    // Any read-ahead of the coded stream is backed up when it is
+    // destroyed at the end of every read
+    return ProtoStreamPos(0, zeroCopyStream->ByteCount());
+}
+
 bool
-ProtoInputStream::read(Message& msg)
+ProtoInputStream::seek(const ProtoStreamPos& pos)
 {
-    // Read a message from the stream by getting the size, using it as
-    // a limit when parsing the message, then popping the limit again
-    uint32_t size;
+    // Block streams decompress the target block only
+    if (blockStream != NULL) {
+        return blockStream->seek(pos.blk_offset, pos.offset);
+    }
+
+    assert(pos.blk_offset == 0);
 
+    // Mapped files move anywhere without reading
+    if (mmapStream != NULL) {
+        return mmapStream->seek(pos.offset);
+    }
+
+    if (pos.offset < (uint64_t) zeroCopyStream->ByteCount()) {
+        reset();
+    }
+
+    // Skip takes an int, so move forward in bounded steps
+    while ((uint64_t) zeroCopyStream->ByteCount() < pos.offset) {
+        uint64_t count = pos.offset - zeroCopyStream->ByteCount();
+        if (!zeroCopyStream->Skip(min<uint64_t>(count, 1 << 30))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+ProtoInputStream::read(Message& msg)
+{
     // Due to the byte limit of the coded stream we create it for
     // every single mesage (based on forum discussions around the size
-    // limitation)
+    // limitation), use read_batch to read many messages at once
     io::CodedInputStream codedStream(zeroCopyStream);
 
+    return readMessage(codedStream, msg);
+}
+
+bool
+ProtoInputStream::readMessage(io::CodedInputStream& codedStream,
+                              Message& msg)
+{
+    // Read a message from the stream by getting the size, using it as
+    // a limit when parsing the message, then popping the limit again
+    uint32_t size;
+
     if (codedStream.ReadVarint32(&size)) {
         io::CodedInputStream::Limit limit = codedStream.PushLimit(size);
         if (msg.ParseFromCodedStream(&codedStream)) {
@@ -52,6 +52,9 @@
 #include <google/protobuf/message.h>
 
 #include <fstream>
+#include <vector>
+
+#include "gem5/blockio.hh"
 
 /**
  * A ProtoStream provides the shared functionality of the input and
@@ -60,8 +63,42 @@
 class ProtoStream
 {
 
+  public:
+
+    /**
+     * Name of a stream file written with the default codec, e.g.
+     * "dir/frames" becomes "dir/frames.pb.gz".
+     *
+     * @param basename Path of the stream without extension
+     * @return Path of the stream file
+     */
+    static std::string filename(const std::string& basename);
+
+    /**
+     * Name of an existing stream file written with any codec, or the
+     * name with the default codec if there is none. The codec is
+     * resolved on the first lookup in a directory and reused for the
+     * other streams of that directory.
+     *
+     * @param basename Path of the stream without extension
+     * @return Path of the stream file
+     */
+    static std::string find(const std::string& basename);
+
+    /**
+     * Set the codec of streams named through filename(), given by its
+     * extension: gz, zst or lz4, or none for uncompressed streams
+     * ("dir/frames.pb"). Exits if the codec is not compiled in.
+     *
+     * @param ext Codec extension
+     */
+    static void setDefaultCodec(const std::string& ext);
+
   protected:
 
+    /// Extension of the default codec
+    static std::string defaultCodec;
+
     /// Use the ASCII characters gem5 as our magic number
     static const uint32_t magicNumber = 0x356d6567;
 
@@ -81,6 +118,95 @@ class ProtoStream
     /** @} */
 };
 
+/**
+ * Position of a message within a proto stream. The block offset is the
+ * file offset of the independently decodable block holding the message,
+ * and the offset is the uncompressed byte offset within that block.
+ * Streams that are not split into blocks use a single block at offset
+ * zero, i.e. the offset is relative to the start of the uncompressed
+ * stream (including the magic number).
+ */
+struct ProtoStreamPos
+{
+    /// File offset of the block
+    uint64_t blk_offset;
+
+    /// Uncompressed offset within the block
+    uint64_t offset;
+
+    ProtoStreamPos() : blk_offset(0), offset(0) {}
+
+    ProtoStreamPos(uint64_t blk_offset, uint64_t offset) :
+        blk_offset(blk_offset), offset(offset) {}
+
+    bool operator<(const ProtoStreamPos& other) const {
+        return blk_offset < other.blk_offset ||
+            (blk_offset == other.blk_offset && offset < other.offset);
+    }
+};
+
+/**
+ * A ProtoIndex maps keys (frame, scene, resource ids etc.) to the
+ * position of the first message carrying that key in a stream. Only
+ * the first position of every key is kept, lookups are binary searches
+ * over the sorted keys. An index is either loaded from the sidecar file
+ * written next to the stream (see ProtoOutputStream::write(msg, key))
+ * or built in memory by the reader with a single pass over the stream.
+ */
+class ProtoIndex
+{
+
+  public:
+
+    ProtoIndex() {}
+
+    /**
+     * Load the index from a sidecar file.
+     *
+     * @param filename Path to the index file
+     * @return True if the file exists and was loaded
+     */
+    bool load(const std::string& filename);
+
+    /**
+     * Add a key, duplicates of an existing key are ignored.
+     *
+     * @param key Key of the message
+     * @param pos Position of the message in the stream
+     */
+    void insert(uint64_t key, const ProtoStreamPos& pos);
+
+    /**
+     * Look up the position of the first message with a key.
+     *
+     * @param key Key to find
+     * @param pos Position of the message, if found
+     * @return True if the key is in the index
+     */
+    bool find(uint64_t key, ProtoStreamPos& pos) const;
+
+    /**
+     * Number of keys in the index.
+     */
+    size_t size() const { return entries.size(); }
+
+    /**
+     * Whether the index holds no keys.
+     */
+    bool empty() const { return entries.empty(); }
+
+    /**
+     * Drop all keys.
+     */
+    void clear() { entries.clear(); }
+
+  private:
+
+    /// Index entries sorted by key
+    std::vector<std::pair<uint64_t, ProtoStreamPos>> entries;
+
+};
+
 /**
  * A ProtoOutputStream wraps a coded stream, potentially with
  * compression, based on looking at the file name. Writing to the
@@ -96,7 +222,8 @@ class ProtoOutputStream : public ProtoStream
 
     /**
      * Create an output stream for a given file name. If the filename
-     * ends with .gz then the file will be compressed accordinly.
+     * ends with .gz then the file will be compressed accordinly, as a
+     * seekable block stream (see BlockOutputStream).
      *
      * @param filename Path to the file to create or truncate
      */
@@ -116,20 +243,151 @@ class ProtoOutputStream : public ProtoStream
      */
     void write(const google::protobuf::Message& msg);
 
+    /**
+     * Write a message to the stream and record its position in the
+     * sidecar index (<filename>.idx) if the key differs from the key
+     * of the previous indexed message. Keys of consecutive messages
+     * are expected to be grouped, e.g. all jobs of a frame.
+     *
+     * @param msg Message to write to the stream
+     * @param key Key identifying the message in the index
+     */
+    void write(const google::protobuf::Message& msg, uint64_t key);
+
+    /**
+     * Position at which the next message will be written.
+     */
+    ProtoStreamPos tell() const;
+
+    /**
+     * Set the uncompressed size after which blocks of compressed
+     * streams created from now on are cut.
+     *
+     * @param size Block size in bytes
+     */
+    static void setBlockSize(size_t size) { blockSize = size; }
+
   private:
 
+    /// Uncompressed block size of compressed streams
+    static size_t blockSize;
+
+    /// Hold on to the file name to derive the index file name
+    const std::string fileName;
+
     /// Underlying file output stream
     std::ofstream fileStream;
 
     /// Zero Copy stream wrapping the STL output stream
     google::protobuf::io::OstreamOutputStream* wrappedFileStream;
 
-    /// Optional Gzip stream to wrap the Zero Copy stream
-    google::protobuf::io::GzipOutputStream* gzipStream;
+    /// Codec of compressed streams
+    BlockCodec* codec;
+
+    /// Optional block stream compressing the Zero Copy stream
+    BlockOutputStream* blockStream;
 
     /// Top-level zero-copy stream, either with compression or not
     google::protobuf::io::ZeroCopyOutputStream* zeroCopyStream;
 
+    /// Sidecar index stream, created on the first indexed write
+    ProtoOutputStream* indexStream;
+
+    /// Key of the last indexed message
+    uint64_t lastKey;
+
+};
+
+/**
+ * Zero-copy input stream adaptor keeping an exact count of the bytes
+ * handed out by the wrapped stream. The GzipInputStream byte count
+ * includes data decompressed ahead of the reader, which makes it
+ * unusable as a stream position.
+ */
+class CountingInputStream : public google::protobuf::io::ZeroCopyInputStream
+{
+
+  public:
+
+    CountingInputStream(google::protobuf::io::ZeroCopyInputStream* stream) :
+        stream(stream), count(0) {}
+
+    bool Next(const void** data, int* size) override;
+
+    void BackUp(int size) override;
+
+    bool Skip(int size) override;
+
+    int64_t ByteCount() const override { return count; }
+
+  private:
+
+    /// Wrapped stream
+    google::protobuf::io::ZeroCopyInputStream* stream;
+
+    /// Bytes consumed so far
+    int64_t count;
+
+};
+
+/**
+ * Zero-copy input stream over a memory mapped file. Data is handed out
+ * straight from the page cache, in chunks bounded by the int sizes of
+ * the zero-copy interface, so files beyond 2GB are supported.
+ */
+class MmapInputStream : public google::protobuf::io::ZeroCopyInputStream
+{
+
+  public:
+
+    /**
+     * Map a file for reading. Use valid() to check if the mapping
+     * succeeded.
+     *
+     * @param filename File to map
+     */
+    MmapInputStream(const std::string& filename);
+
+    ~MmapInputStream();
+
+    /**
+     * Check if the file is mapped.
+     */
+    bool valid() const { return base != NULL; }
+
+    bool Next(const void** data, int* size) override;
+
+    void BackUp(int count) override;
+
+    bool Skip(int count) override;
+
+    int64_t ByteCount() const override { return pos; }
+
+    /**
+     * Move to an offset in the file.
+     *
+     * @param offset Offset to move to
+     * @return True if the offset is within the file
+     */
+    bool seek(uint64_t offset);
+
+  private:
+
+    /// Largest chunk returned by Next
+    static const uint64_t chunkSize = 1 << 30;
+
+    /// Start of the mapping
+    const char* base;
+
+    /// Size of the file
+    uint64_t size;
+
+    /// Read position
+    uint64_t pos;
+
+    /// Size of the last chunk, the limit of BackUp
+    int lastSize;
+
 };
 
 /**
@@ -147,6 +405,7 @@ class ProtoInputStream : public ProtoStream
     /**
      * Create an input stream for a given file name. If the filename
      * ends with .gz then the file will be decompressed accordingly.
+     * Uncompressed files are memory mapped and parsed in place.
      *
      * @param filename Path to the file to read from
      */
@@ -166,6 +425,32 @@ class ProtoInputStream : public ProtoStream
      */
     bool read(google::protobuf::Message& msg);
 
+    /**
+     * Read up to n messages into a vector through a single coded
+     * stream. The vector is grown to hold at least n messages and is
+     * never shrunk, so the message objects and their allocations are
+     * reused across batches.
+     *
+     * @param msgs Messages read from the stream, the first ones valid
+     * @param n Maximum number of messages to read
+     * @return Number of messages read, less than n at the end
+     */
+    template <class Msg>
+    size_t read_batch(std::vector<Msg>& msgs, size_t n);
+
+    /**
+     * Read up to n messages through a single coded stream, parsing
+     * each into the same message and handing it to a visitor. The
+     * visitor must not use the stream itself.
+     *
+     * @param msg Message reused for every read
+     * @param n Maximum number of messages to read
+     * @param visit Called for every message, returns false to stop
+     * @return Number of messages read
+     */
+    template <class Msg, class Visitor>
+    size_t read_each(Msg& msg, size_t n, Visitor visit);
+
     /**
      * @brief good
      * @return
@@ -177,8 +462,51 @@ class ProtoInputStream : public ProtoStream
      */
     void reset();
 
+    /**
+     * Position of the next message in the stream.
+     */
+    ProtoStreamPos tell() const;
+
+    /**
+     * Seek to a position previously obtained through tell() or from
+     * an index. Seeking backwards restarts decompression from the
+     * beginning of the file.
+     *
+     * @param pos Position of the next message to read
+     * @return True if the position could be reached
+     */
+    bool seek(const ProtoStreamPos& pos);
+
+    /**
+     * Set the number of blocks of block streams opened from now on
+     * that are decompressed ahead of the reader, each on its own
+     * thread. Zero decompresses blocks on demand.
+     *
+     * @param threads Number of decoder threads per stream
+     */
+    static void setDecodeThreads(unsigned threads) {
+        decodeThreads = threads;
+    }
+
   private:
 
+    /// Decoder threads of block streams
+    static unsigned decodeThreads;
+
+    /// Bytes read through a coded stream before it is recreated, well
+    /// below the total bytes limit of any protobuf version
+    static const int maxCodedBytes = 32 << 20;
+
+    /**
+     * Read a length-prefixed message from a coded stream.
+     *
+     * @param codedStream Coded stream wrapping zeroCopyStream
+     * @param msg Message read from the stream
+     * @return True if a message was read
+     */
+    bool readMessage(google::protobuf::io::CodedInputStream& codedStream,
+                     google::protobuf::Message& msg);
+
     /**
      * Create the internal streams that are wrapping the input file.
      */
@@ -198,6 +526,15 @@ class ProtoInputStream : public ProtoStream
     /// Boolean flag to remember whether we use gzip or not
     bool useGzip;
 
+    /// Codec of the file, if compressed
+    BlockCodec* codec;
+
+    /// Block stream, if the file has a block directory
+    BlockInputStream* blockStream;
+
+    /// Memory mapped stream, if the file is uncompressed
+    MmapInputStream* mmapStream;
+
     ///
     uint32_t magic_check;
 
@@ -207,9 +544,111 @@ class ProtoInputStream : public ProtoStream
     /// Optional Gzip stream to wrap the Zero Copy stream
     google::protobuf::io::GzipInputStream* gzipStream;
 
+    /// Byte counter keeping track of the stream position
+    CountingInputStream* countingStream;
+
     /// Top-level zero-copy stream, either with compression or not
     google::protobuf::io::ZeroCopyInputStream* zeroCopyStream;
 
 };
 
+template <class Msg>
+size_t
+ProtoInputStream::read_batch(std::vector<Msg>& msgs, size_t n)
+{
+    if (msgs.size() < n) {
+        msgs.resize(n);
+    }
+
+    // Keep a coded stream alive over many messages, and start a new
+    // one before its byte count gets anywhere near the limit
+    size_t count = 0;
+    while (count < n) {
+        google::protobuf::io::CodedInputStream codedStream(zeroCopyStream);
+        do {
+            if (!readMessage(codedStream, msgs[count])) {
+                return count;
+            }
+            ++count;
+        } while (count < n &&
+                 codedStream.CurrentPosition() < maxCodedBytes);
+    }
+
+    return count;
+}
+
+template <class Msg, class Visitor>
+size_t
+ProtoInputStream::read_each(Msg& msg, size_t n, Visitor visit)
+{
+    size_t count = 0;
+    while (count < n) {
+        google::protobuf::io::CodedInputStream codedStream(zeroCopyStream);
+        do {
+            if (!readMessage(codedStream, msg)) {
+                return count;
+            }
+            ++count;
+            if (!visit(msg)) {
+                return count;
+            }
+        } while (count < n &&
+                 codedStream.CurrentPosition() < maxCodedBytes);
+    }
+
+    return count;
+}
+
+/**
+ * A ProtoBatchReader hands out the messages of an input stream one at
+ * a time, refilling a buffer of messages with read_batch.
+ */
+template <class Msg>
+class ProtoBatchReader
+{
+
+  public:
+
+    /**
+     * @param stream Stream to read from, owned by the caller
+     * @param batchSize Number of messages read at once
+     */
+    ProtoBatchReader(ProtoInputStream* stream, size_t batchSize) :
+        stream(stream), batchSize(batchSize), pos(0), count(0) {}
+
+    /**
+     * Next message of the stream.
+     *
+     * @return Message, valid until the next call, or NULL at the end
+     */
+    const Msg* next() {
+        if (pos == count) {
+            pos = 0;
+            count = stream->read_batch(batch, batchSize);
+            if (count == 0) {
+                return NULL;
+            }
+        }
+        return &batch[pos++];
+    }
+
+  private:
+
+    /// Stream read from
+    ProtoInputStream* stream;
+
+    /// Number of messages read at once
+    size_t batchSize;
+
+    /// Buffered messages
+    std::vector<Msg> batch;
+
+    /// Next buffered message
+    size_t pos;
+
+    /// Number of valid buffered messages
+    size_t count;
+
+};
+
 #endif //__PROTO_PROTOIO_HH
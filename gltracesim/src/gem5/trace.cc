@@ -92,6 +92,130 @@ AddrTraceGenerator::process(const packet_t &pkt)
     }
 }
 
+CompactTraceGenerator::CompactTraceGenerator(const Json::Value &p, int id) :
+    TraceGenerator(p, id)
+{
+    trace_file = new ProtoOutputStream(params["output-file"].asString());
+
+    //
+    init();
+
+    //
+    ProtoMessage::PacketHeader hdr;
+
+    //
+    hdr.set_obj_id("gltracesim");
+    hdr.set_ver(CompactTraceVersion);
+    hdr.set_tick_freq(1);
+
+    //
+    trace_file->write(hdr);
+    trace_file->write(trace_hdr);
+}
+
+CompactTraceGenerator::CompactTraceGenerator(const Json::Value &p, int id,
+    TraceArchiveWriterPtr archive) :
+    TraceGenerator(p, id), trace_file(NULL), archive(archive)
+{
+    //
+    init();
+}
+
+void
+CompactTraceGenerator::init()
+{
+    //
+    uint32_t blk_size = params.get("blk-size", 64).asUInt();
+    assert(blk_size && (blk_size & (blk_size - 1)) == 0);
+
+    //
+    trace_hdr.set_blk_shift(__builtin_ctz(blk_size));
+    trace_hdr.set_job_id(id);
+    trace_hdr.set_dev_id(params.get("dev-id", 0).asUInt());
+    trace_hdr.set_size(blk_size);
+
+    //
+    encoder = new CompactTraceEncoder(trace_hdr);
+}
+
+CompactTraceGenerator::~CompactTraceGenerator()
+{
+    //
+    flush(true);
+    //
+    delete encoder;
+    //
+    delete trace_file;
+}
+
+void
+CompactTraceGenerator::flush(bool last)
+{
+    //
+    if (archive) {
+        //
+        ProtoMessage::JobTraceChunk chunk;
+
+        //
+        chunk.set_job_id(id);
+
+        //
+        if (encoder->count()) {
+            encoder->flush(chunk.mutable_blk());
+        }
+
+        // Only the last chunk of a job is indexed
+        if (last == false) {
+            chunks.push_back(archive->write(chunk, false));
+            return;
+        }
+
+        //
+        *chunk.mutable_hdr() = trace_hdr;
+
+        //
+        for (auto &pos: chunks) {
+            chunk.add_blk_offsets(pos.blk_offset);
+            chunk.add_offsets(pos.offset);
+        }
+
+        //
+        archive->write(chunk, true);
+        //
+        return;
+    }
+
+    //
+    if (encoder->count() == 0) {
+        return;
+    }
+
+    //
+    ProtoMessage::CompactPacketBlock blk;
+
+    //
+    encoder->flush(&blk);
+
+    //
+    trace_file->write(blk);
+}
+
+void
+CompactTraceGenerator::process(const packet_t &pkt)
+{
+    //
+    assert(pkt.paddr);
+    assert(pkt.job_id >= 0);
+
+    //
+    encoder->encode(pkt);
+
+    //
+    if (encoder->count() >= records_per_blk) {
+        flush();
+    }
+}
+
 CmdTraceGenerator::CmdTraceGenerator(const Json::Value &p, int id) :
     TraceGenerator(p, id)
 {
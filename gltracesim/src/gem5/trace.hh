@@ -6,6 +6,8 @@
 #include "analyzer.hh"
 #include "gem5/protoio.hh"
 #include "gem5/packet.pb.h"
+#include "gem5/compact_trace.hh"
+#include "gem5/trace_archive.hh"
 
 #include "util/cflags.hh"
 
@@ -103,6 +105,79 @@ private:
 
 };
 
+class CompactTraceGenerator : public TraceGenerator
+{
+
+public:
+
+    /**
+     * @brief Analyzer
+     */
+    CompactTraceGenerator(const Json::Value &params, int id);
+
+    /**
+     * @brief Analyzer, appends the trace to a per-scene archive
+     * instead of writing a trace file
+     */
+    CompactTraceGenerator(const Json::Value &params, int id,
+                          TraceArchiveWriterPtr archive);
+
+    /**
+     * @brief ~Analyzer
+     */
+    virtual ~CompactTraceGenerator();
+
+    /**
+     * @brief process
+     * @param pkt
+     */
+    virtual void process(const packet_t &pkt);
+
+private:
+
+    /**
+     * @brief records per CompactPacketBlock
+     */
+    static const uint32_t records_per_blk = 4096;
+
+    /**
+     * @brief init
+     */
+    void init();
+
+    /**
+     * @brief flush encoded records to the trace file or archive
+     * @param last true for the last records of the job
+     */
+    void flush(bool last = false);
+
+    /**
+     * @brief trace_file, NULL when writing to an archive
+     */
+    ProtoOutputStream* trace_file;
+
+    /**
+     * @brief archive
+     */
+    TraceArchiveWriterPtr archive;
+
+    /**
+     * @brief positions of the chunks written to the archive
+     */
+    std::vector<ProtoStreamPos> chunks;
+
+    /**
+     * @brief trace_hdr
+     */
+    ProtoMessage::CompactTraceHeader trace_hdr;
+
+    /**
+     * @brief encoder
+     */
+    CompactTraceEncoder *encoder;
+
+};
+
 class CmdTraceGenerator : public TraceGenerator
 {
 
@@ -0,0 +1,309 @@
+#include <cassert>
+#include <fstream>
+#include <list>
+#include <unordered_map>
+
+#include "gem5/trace_archive.hh"
+#include "gem5/compact_trace.hh"
+
+namespace gltracesim {
+namespace gem5 {
+
+TraceArchiveWriter::TraceArchiveWriter(const std::string &filename)
+{
+    //
+    archive_file = new ProtoOutputStream(filename);
+
+    //
+    ProtoMessage::PacketHeader hdr;
+
+    //
+    hdr.set_obj_id("gltracesim-jobs");
+    hdr.set_ver(CompactTraceVersion);
+    hdr.set_tick_freq(1);
+
+    //
+    archive_file->write(hdr);
+}
+
+TraceArchiveWriter::~TraceArchiveWriter()
+{
+    delete archive_file;
+}
+
+ProtoStreamPos
+TraceArchiveWriter::write(const ProtoMessage::JobTraceChunk &chunk, bool last)
+{
+    //
+    mtx.lock();
+
+    //
+    ProtoStreamPos pos = archive_file->tell();
+
+    //
+    if (last) {
+        archive_file->write(chunk, chunk.job_id());
+    } else {
+        archive_file->write(chunk);
+    }
+
+    //
+    mtx.unlock();
+
+    //
+    return pos;
+}
+
+TraceArchiveReader::TraceArchiveReader(const std::string &filename) :
+    filename(filename), tick(0)
+{
+    //
+    ProtoInputStream *archive_file = new ProtoInputStream(filename);
+    //
+    streams[0].file = archive_file;
+
+    //
+    ProtoMessage::PacketHeader hdr;
+    //
+    archive_file->read(hdr);
+
+    //
+    if (index.load(filename + ".idx") == false) {
+        build_index();
+    }
+}
+
+TraceArchiveReader::~TraceArchiveReader()
+{
+    for (auto &stream: streams) {
+        delete stream.file;
+    }
+}
+
+void
+TraceArchiveReader::build_index()
+{
+    //
+    ProtoInputStream *archive_file = streams[0].file;
+
+    //
+    std::unordered_map<uint64_t, ProtoStreamPos> last_chunk;
+
+    //
+    ProtoMessage::JobTraceChunk chunk;
+
+    // The last chunk of a job follows all its other chunks
+    while (true) {
+        //
+        ProtoStreamPos pos = archive_file->tell();
+        //
+        if (archive_file->read(chunk) == false) {
+            break;
+        }
+        //
+        last_chunk[chunk.job_id()] = pos;
+    }
+
+    //
+    for (auto &it: last_chunk) {
+        index.insert(it.first, it.second);
+    }
+}
+
+TraceArchiveReader::stream_t*
+TraceArchiveReader::acquire(uint64_t blk_offset)
+{
+    //
+    stream_t *stream = NULL;
+
+    //
+    mtx.lock();
+
+    //
+    for (auto &it: streams) {
+        if (it.blk_offset == blk_offset) {
+            stream = &it;
+            break;
+        }
+    }
+
+    // Unused streams come first
+    if (stream == NULL) {
+        //
+        stream = &streams[0];
+        //
+        for (auto &it: streams) {
+            if (it.last_use < stream->last_use) {
+                stream = &it;
+            }
+        }
+    }
+
+    // Other jobs with chunks in the block follow
+    stream->blk_offset = blk_offset;
+    stream->last_use = ++tick;
+
+    //
+    mtx.unlock();
+
+    //
+    stream->mtx.lock();
+
+    //
+    if (stream->file == NULL) {
+        stream->file = new ProtoInputStream(filename);
+    }
+
+    //
+    return stream;
+}
+
+bool
+TraceArchiveReader::find(uint64_t job_id,
+    ProtoMessage::CompactTraceHeader &hdr,
+    std::vector<ProtoStreamPos> &chunks)
+{
+    //
+    ProtoStreamPos pos;
+
+    //
+    if (index.find(job_id, pos) == false) {
+        return false;
+    }
+
+    //
+    ProtoMessage::JobTraceChunk last;
+
+    //
+    stream_t *stream = acquire(pos.blk_offset);
+    //
+    bool ok = stream->file->seek(pos) && stream->file->read(last);
+    //
+    stream->mtx.unlock();
+
+    //
+    if (ok == false) {
+        return false;
+    }
+
+    assert(last.job_id() == job_id);
+    assert(last.has_hdr());
+
+    //
+    hdr.Swap(last.mutable_hdr());
+
+    // Earlier chunks, in the order they were written, then the last one
+    chunks.clear();
+    //
+    for (int i = 0; i < last.blk_offsets_size(); ++i) {
+        chunks.push_back(
+            ProtoStreamPos(last.blk_offsets(i), last.offsets(i))
+        );
+    }
+    //
+    chunks.push_back(pos);
+
+    //
+    return true;
+}
+
+size_t
+TraceArchiveReader::read(const std::vector<ProtoStreamPos> &chunks,
+    size_t idx, size_t max_chunks,
+    std::deque<ProtoMessage::CompactPacketBlock> &blks)
+{
+    //
+    ProtoMessage::JobTraceChunk chunk;
+
+    //
+    size_t count = 0;
+
+    //
+    stream_t *stream = acquire(chunks[idx].blk_offset);
+
+    //
+    while (idx + count < chunks.size() && count < max_chunks) {
+        //
+        const ProtoStreamPos &pos = chunks[idx + count];
+
+        // Stop at the next compressed block
+        if (count && pos.blk_offset != chunks[idx].blk_offset) {
+            break;
+        }
+
+        //
+        if (!stream->file->seek(pos) || !stream->file->read(chunk)) {
+            count = 0;
+            break;
+        }
+
+        //
+        blks.emplace_back();
+        blks.back().Swap(chunk.mutable_blk());
+
+        //
+        ++count;
+    }
+
+    //
+    stream->mtx.unlock();
+
+    //
+    return count;
+}
+
+TraceArchiveReaderPtr
+TraceArchiveReader::open(const std::string &basename)
+{
+    //
+    static Mutex cache_mtx;
+    // Most recently used first, scenes without an archive included
+    static std::list<std::pair<std::string, TraceArchiveReaderPtr>> cache;
+
+    //
+    cache_mtx.lock();
+
+    //
+    auto it = cache.begin();
+    //
+    while (it != cache.end() && it->first != basename) {
+        ++it;
+    }
+
+    //
+    if (it != cache.end()) {
+        //
+        cache.splice(cache.begin(), cache, it);
+    } else {
+        //
+        TraceArchiveReaderPtr reader;
+
+        //
+        std::string filename = ProtoStream::find(basename);
+
+        // Scenes traced into per-job files have no archive
+        if (std::ifstream(filename.c_str()).good()) {
+            reader = TraceArchiveReaderPtr(new TraceArchiveReader(filename));
+        }
+
+        //
+        cache.emplace_front(basename, reader);
+
+        // Jobs still reading an evicted archive keep it open
+        if (cache.size() > NUM_OPEN_ARCHIVES) {
+            cache.pop_back();
+        }
+    }
+
+    //
+    TraceArchiveReaderPtr reader = cache.front().second;
+
+    //
+    cache_mtx.unlock();
+
+    //
+    return reader;
+}
+
+} // end namespace gem5
+} // end namespace gltracesim
@@ -0,0 +1,201 @@
+#ifndef __GLTRACESIM_TRACE_ARCHIVE_HH__
+#define __GLTRACESIM_TRACE_ARCHIVE_HH__
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gem5/protoio.hh"
+#include "gem5/packet.pb.h"
+
+#include "util/threads.hh"
+
+namespace gltracesim {
+namespace gem5 {
+
+/**
+ * Per-scene job trace archive.
+ *
+ * All compact job traces of a scene are stored in a single proto stream
+ * (f<frame>/s<scene>/jobs.pb.gz) instead of one file per job. The
+ * stream holds a PacketHeader of version 1 followed by JobTraceChunk
+ * messages. Jobs traced in parallel append their chunks as their
+ * blocks fill up, so chunks of different jobs are interleaved. The last
+ * chunk of a job carries its CompactTraceHeader and the positions of
+ * its earlier chunks, and is recorded in the sidecar index keyed by the
+ * job id.
+ */
+class TraceArchiveWriter
+{
+
+public:
+
+    /**
+     * @brief TraceArchiveWriter
+     * @param filename
+     */
+    TraceArchiveWriter(const std::string &filename);
+
+    /**
+     * @brief ~TraceArchiveWriter, closes the archive and its index
+     */
+    ~TraceArchiveWriter();
+
+    /**
+     * @brief write a chunk, thread safe
+     * @param chunk
+     * @param last true for the last chunk of a job, which is indexed
+     * @return position of the chunk
+     */
+    ProtoStreamPos write(const ProtoMessage::JobTraceChunk &chunk,
+                         bool last);
+
+private:
+
+    /**
+     * @brief mtx
+     */
+    Mutex mtx;
+
+    /**
+     * @brief archive_file
+     */
+    ProtoOutputStream *archive_file;
+
+};
+
+typedef std::shared_ptr<TraceArchiveWriter> TraceArchiveWriterPtr;
+
+class TraceArchiveReader;
+
+typedef std::shared_ptr<TraceArchiveReader> TraceArchiveReaderPtr;
+
+/**
+ * @brief The TraceArchiveReader class, looks up job traces in an archive.
+ */
+class TraceArchiveReader
+{
+
+public:
+
+    /**
+     * @brief TraceArchiveReader
+     * @param filename
+     */
+    TraceArchiveReader(const std::string &filename);
+
+    /**
+     * @brief ~TraceArchiveReader
+     */
+    ~TraceArchiveReader();
+
+    /**
+     * @brief find the trace of a job, thread safe
+     * @param job_id
+     * @param hdr header of the job trace
+     * @param chunks positions of the chunks of the job, in order
+     * @return false if the job is not in the archive
+     */
+    bool find(uint64_t job_id,
+              ProtoMessage::CompactTraceHeader &hdr,
+              std::vector<ProtoStreamPos> &chunks);
+
+    /**
+     * @brief read the blocks of consecutive chunks of a job that are
+     * stored in the same compressed block, so a block is decompressed
+     * once per job even when jobs are read in parallel, thread safe
+     * @param chunks positions of the chunks of the job
+     * @param idx first chunk to read
+     * @param max_chunks maximum number of chunks to read
+     * @param blks blocks read are appended here
+     * @return number of chunks read, 0 on errors
+     */
+    size_t read(const std::vector<ProtoStreamPos> &chunks, size_t idx,
+                size_t max_chunks,
+                std::deque<ProtoMessage::CompactPacketBlock> &blks);
+
+    /**
+     * @brief open the archive of a scene. The most recently used
+     * archives are kept open, so the jobs of a scene share them even
+     * when jobs of other scenes are decoded in between.
+     * @param basename path of the archive without extension
+     * @return archive, or NULL if the scene has no archive
+     */
+    static TraceArchiveReaderPtr open(const std::string &basename);
+
+private:
+
+    /**
+     * @brief The stream_t struct, a stream of the archive. A stream keeps
+     * the compressed block it is in decompressed, so jobs with chunks in
+     * that block read them without decompressing it again.
+     */
+    struct stream_t {
+        //
+        stream_t() : file(NULL), blk_offset(~uint64_t(0)), last_use(0) {}
+        // Serializes the reads of the stream
+        Mutex mtx;
+        // Opened on first use
+        ProtoInputStream *file;
+        // Block of the chunks read last
+        uint64_t blk_offset;
+        // Tick of the last use, for replacement
+        uint64_t last_use;
+    };
+
+    /**
+     * @brief build the index with a pass over the archive, used when
+     * there is no sidecar index
+     */
+    void build_index();
+
+    /**
+     * @brief acquire, the stream in a block, or else the least recently
+     * used one, locked
+     * @param blk_offset
+     * @return
+     */
+    stream_t* acquire(uint64_t blk_offset);
+
+    /**
+     * @brief Streams per archive
+     */
+    static const size_t NUM_STREAMS = 4;
+
+    /**
+     * @brief Archives kept open by open
+     */
+    static const size_t NUM_OPEN_ARCHIVES = 4;
+
+    /**
+     * @brief filename
+     */
+    std::string filename;
+
+    /**
+     * @brief mtx, protects the blocks and ticks of the streams
+     */
+    Mutex mtx;
+
+    /**
+     * @brief streams
+     */
+    stream_t streams[NUM_STREAMS];
+
+    /**
+     * @brief tick
+     */
+    uint64_t tick;
+
+    /**
+     * @brief position of the last chunk of every job
+     */
+    ProtoIndex index;
+
+};
+
+} // end namespace gem5
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_TRACE_ARCHIVE_HH__
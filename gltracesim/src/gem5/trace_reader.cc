@@ -0,0 +1,147 @@
+#include <cassert>
+
+#include "gem5/trace.hh"
+#include "gem5/trace_reader.hh"
+
+namespace gltracesim {
+namespace gem5 {
+
+PacketTraceReader::PacketTraceReader(ProtoInputStream *stream)
+    : stream(stream)
+{
+    // Do nothing
+}
+
+PacketTraceReader::~PacketTraceReader()
+{
+    delete stream;
+}
+
+size_t
+PacketTraceReader::read(replay_buffer_t &pkts, size_t n)
+{
+    //
+    size_t count = stream->read_batch(batch, n);
+
+    //
+    for (size_t i = 0; i < count; ++i) {
+        //
+        const ProtoMessage::Packet &pb_pkt = batch[i];
+
+        assert(pb_pkt.cmd() == MemCmd_ReadReq ||
+               pb_pkt.cmd() == MemCmd_WriteReq);
+        assert(pb_pkt.has_rsc_id());
+        assert(pb_pkt.has_job_id());
+
+        //
+        packet_t pkt;
+        pkt.cmd = (pb_pkt.cmd() == MemCmd_ReadReq) ? READ : WRITE;
+        pkt.paddr = pb_pkt.addr();
+        pkt.rsc_id = pb_pkt.rsc_id();
+        pkt.job_id = pb_pkt.job_id();
+        pkt.dev_id = pb_pkt.dev_id();
+        //
+        pkts.set(i, pkt);
+    }
+
+    //
+    return count;
+}
+
+CompactTraceReader::CompactTraceReader(
+    const ProtoMessage::CompactTraceHeader &hdr)
+    : decoder(hdr)
+{
+    // Do nothing
+}
+
+size_t
+CompactTraceReader::read(replay_buffer_t &pkts, size_t n)
+{
+    //
+    size_t count = 0;
+    //
+    packet_t pkt;
+
+    //
+    while (count < n) {
+        //
+        if (decoder.next(pkt)) {
+            pkts.set(count++, pkt);
+            continue;
+        }
+
+        // Block done, the decoder keeps its state across blocks
+        if (next_block(blk) == false) {
+            break;
+        }
+
+        //
+        decoder.set_block(blk.data().data(), blk.data().size());
+    }
+
+    //
+    return count;
+}
+
+CompactStreamReader::CompactStreamReader(ProtoInputStream *stream,
+    const ProtoMessage::CompactTraceHeader &hdr)
+    : CompactTraceReader(hdr), stream(stream)
+{
+    // Do nothing
+}
+
+CompactStreamReader::~CompactStreamReader()
+{
+    delete stream;
+}
+
+bool
+CompactStreamReader::next_block(ProtoMessage::CompactPacketBlock &blk)
+{
+    return stream->read(blk);
+}
+
+CompactArchiveReader::CompactArchiveReader(TraceArchiveReaderPtr archive,
+    const ProtoMessage::CompactTraceHeader &hdr,
+    const std::vector<ProtoStreamPos> &chunks)
+    : CompactTraceReader(hdr), archive(archive), chunks(chunks),
+      next_chunk(0)
+{
+    // Do nothing
+}
+
+bool
+CompactArchiveReader::next_block(ProtoMessage::CompactPacketBlock &blk)
+{
+    //
+    if (blks.empty()) {
+        //
+        if (next_chunk == chunks.size()) {
+            return false;
+        }
+
+        //
+        size_t count = archive->read(chunks, next_chunk, max_chunks, blks);
+
+        //
+        if (count == 0) {
+            next_chunk = chunks.size();
+            return false;
+        }
+
+        //
+        next_chunk += count;
+    }
+
+    //
+    blk.Swap(&blks.front());
+    //
+    blks.pop_front();
+
+    //
+    return true;
+}
+
+} // end namespace gem5
+} // end namespace gltracesim
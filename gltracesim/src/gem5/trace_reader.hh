@@ -0,0 +1,228 @@
+#ifndef __GLTRACESIM_TRACE_READER_HH__
+#define __GLTRACESIM_TRACE_READER_HH__
+
+#include <deque>
+#include <vector>
+
+#include "packet.hh"
+#include "gem5/protoio.hh"
+#include "gem5/packet.pb.h"
+#include "gem5/compact_trace.hh"
+#include "gem5/trace_archive.hh"
+
+namespace gltracesim {
+namespace gem5 {
+
+/**
+ * @brief The TraceReader class, streams the packets of a job trace.
+ */
+class TraceReader
+{
+
+public:
+
+    /**
+     * @brief ~TraceReader
+     */
+    virtual ~TraceReader() {}
+
+    /**
+     * @brief read the next packets of the trace
+     * @param pkts sized for at least n packets
+     * @param n maximum number of packets to read
+     * @return number of packets read, 0 at the end of the trace
+     */
+    virtual size_t read(replay_buffer_t &pkts, size_t n) = 0;
+
+};
+
+/**
+ * @brief The PacketTraceReader class, reads a version 0 trace of
+ * Packet messages.
+ */
+class PacketTraceReader : public TraceReader
+{
+
+public:
+
+    /**
+     * @brief PacketTraceReader
+     * @param stream positioned after the header, owned by the reader
+     */
+    PacketTraceReader(ProtoInputStream *stream);
+
+    /**
+     * @brief ~PacketTraceReader
+     */
+    virtual ~PacketTraceReader();
+
+    /**
+     * @brief read
+     * @param pkts
+     * @param n
+     * @return
+     */
+    virtual size_t read(replay_buffer_t &pkts, size_t n);
+
+private:
+
+    /**
+     * @brief stream
+     */
+    ProtoInputStream *stream;
+
+    /**
+     * @brief batch
+     */
+    std::vector<ProtoMessage::Packet> batch;
+
+};
+
+/**
+ * @brief The CompactTraceReader class, decodes the blocks of a compact
+ * trace one at a time.
+ */
+class CompactTraceReader : public TraceReader
+{
+
+public:
+
+    /**
+     * @brief CompactTraceReader
+     * @param hdr
+     */
+    CompactTraceReader(const ProtoMessage::CompactTraceHeader &hdr);
+
+    /**
+     * @brief read
+     * @param pkts
+     * @param n
+     * @return
+     */
+    virtual size_t read(replay_buffer_t &pkts, size_t n);
+
+protected:
+
+    /**
+     * @brief next_block
+     * @param blk
+     * @return false at the end of the trace
+     */
+    virtual bool next_block(ProtoMessage::CompactPacketBlock &blk) = 0;
+
+private:
+
+    /**
+     * @brief decoder
+     */
+    CompactTraceDecoder decoder;
+
+    /**
+     * @brief block being decoded
+     */
+    ProtoMessage::CompactPacketBlock blk;
+
+};
+
+/**
+ * @brief The CompactStreamReader class, reads a compact trace file.
+ */
+class CompactStreamReader : public CompactTraceReader
+{
+
+public:
+
+    /**
+     * @brief CompactStreamReader
+     * @param stream positioned after the trace header, owned by the
+     * reader
+     * @param hdr
+     */
+    CompactStreamReader(ProtoInputStream *stream,
+                        const ProtoMessage::CompactTraceHeader &hdr);
+
+    /**
+     * @brief ~CompactStreamReader
+     */
+    virtual ~CompactStreamReader();
+
+protected:
+
+    /**
+     * @brief next_block
+     * @param blk
+     * @return
+     */
+    virtual bool next_block(ProtoMessage::CompactPacketBlock &blk);
+
+private:
+
+    /**
+     * @brief stream
+     */
+    ProtoInputStream *stream;
+
+};
+
+/**
+ * @brief The CompactArchiveReader class, reads a job trace from a
+ * per-scene trace archive.
+ */
+class CompactArchiveReader : public CompactTraceReader
+{
+
+public:
+
+    /**
+     * @brief CompactArchiveReader
+     * @param archive
+     * @param hdr
+     * @param chunks positions of the chunks of the job
+     */
+    CompactArchiveReader(TraceArchiveReaderPtr archive,
+                         const ProtoMessage::CompactTraceHeader &hdr,
+                         const std::vector<ProtoStreamPos> &chunks);
+
+protected:
+
+    /**
+     * @brief next_block
+     * @param blk
+     * @return
+     */
+    virtual bool next_block(ProtoMessage::CompactPacketBlock &blk);
+
+private:
+
+    /**
+     * @brief chunks read from the archive at once, bounds the blocks
+     * buffered per job
+     */
+    static const size_t max_chunks = 16;
+
+    /**
+     * @brief archive
+     */
+    TraceArchiveReaderPtr archive;
+
+    /**
+     * @brief chunks
+     */
+    std::vector<ProtoStreamPos> chunks;
+
+    /**
+     * @brief next chunk to read from the archive
+     */
+    size_t next_chunk;
+
+    /**
+     * @brief blocks read but not decoded yet
+     */
+    std::deque<ProtoMessage::CompactPacketBlock> blks;
+
+};
+
+} // end namespace gem5
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_TRACE_READER_HH__
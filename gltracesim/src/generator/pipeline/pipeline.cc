@@ -54,6 +54,19 @@ Pipeline::add_analysis_thread()
     return internal_tid;
 }
 
+int
+Pipeline::add_writer_thread(size_t max_batches)
+{
+    // Allocate internal id
+    int internal_tid = trace_queue.size();
+
+    //
+    trace_queue.push_back(TraceQueuePtr(new TraceQueue(max_batches)));
+
+    // Writer thread id
+    return internal_tid;
+}
+
 void
 Pipeline::map_gpu_thread(int internal_tid, int external_tid)
 {
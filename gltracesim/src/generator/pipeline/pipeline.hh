@@ -6,6 +6,7 @@
 
 #include "generator/pipeline/filter_queue.hh"
 #include "generator/pipeline/analysis_queue.hh"
+#include "generator/pipeline/trace_queue.hh"
 
 namespace gltracesim {
 namespace pipeline {
@@ -30,10 +31,14 @@ public:
     // Size: Number of analysis threads (fixed)
     AnalysisQueuePtr analysis_queue;
 
+    // Size: Number of trace writer threads
+    std::vector<TraceQueuePtr> trace_queue;
+
     //
     int num_gpu_threads() { return _num_gpu_threads; }
     int num_filter_threads() { return _num_filter_threads; }
     int num_anaysis_threads() { return _num_analysis_threads; }
+    int num_writer_threads() { return trace_queue.size(); }
 
     //
     int get_gid(int external_tid) { return eid2gid_map[external_tid]; }
@@ -52,6 +57,7 @@ public:
     int add_gpu_thread();
     int add_filter_thread();
     int add_analysis_thread();
+    int add_writer_thread(size_t max_batches);
 
     void map_gpu_thread(int gid, int external_tid);
     void map_filter_thread(int fid, int external_tid);
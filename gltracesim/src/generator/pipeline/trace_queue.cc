@@ -0,0 +1,107 @@
+#include "generator/pipeline/trace_queue.hh"
+
+namespace gltracesim {
+namespace pipeline {
+
+//
+TraceQueue::TraceQueue(size_t max_batches) :
+    max_batches(max_batches), busy(false)
+{
+    //
+    assert(max_batches);
+
+    //
+    producer_has_space.set();
+    consumer_idle.set();
+}
+
+TraceQueue::~TraceQueue()
+{
+
+}
+
+void
+TraceQueue::push(trace_batch_t &batch)
+{
+    //
+    mtx.lock();
+
+    // Back pressure, the writer is behind
+    while (queue.size() >= max_batches) {
+        //
+        producer_has_space.clear();
+        //
+        mtx.unlock();
+        //
+        producer_has_space.wait();
+        //
+        mtx.lock();
+    }
+
+    //
+    queue.emplace_back();
+    queue.back().job.swap(batch.job);
+    queue.back().pkts.swap(batch.pkts);
+
+    //
+    consumer_idle.clear();
+    consumer_has_work.set();
+
+    //
+    mtx.unlock();
+}
+
+bool
+TraceQueue::pop(int timeout, std::deque<trace_batch_t> &batches)
+{
+    //
+    if (consumer_has_work.wait(timeout) == false) {
+        return false;
+    }
+
+    //
+    mtx.lock();
+
+    //
+    batches.swap(queue);
+    //
+    busy = (batches.empty() == false);
+
+    //
+    consumer_has_work.clear();
+    producer_has_space.set();
+
+    //
+    mtx.unlock();
+
+    //
+    return busy;
+}
+
+void
+TraceQueue::signal_producer()
+{
+    //
+    mtx.lock();
+
+    //
+    busy = false;
+
+    // Nothing pushed meanwhile
+    if (queue.empty()) {
+        consumer_idle.set();
+    }
+
+    //
+    mtx.unlock();
+}
+
+void
+TraceQueue::wait()
+{
+    //
+    consumer_idle.wait();
+}
+
+} // end namespace pipeline
+} // end namespace gltracesim
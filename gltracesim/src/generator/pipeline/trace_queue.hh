@@ -0,0 +1,116 @@
+#ifndef __GLTRACESIM_TRACE_QUEUE_HH__
+#define __GLTRACESIM_TRACE_QUEUE_HH__
+
+#include <deque>
+#include <vector>
+#include <memory>
+
+#include "pin.H"
+#include "job.hh"
+#include "packet.hh"
+#include "util/threads.hh"
+
+namespace gltracesim {
+namespace pipeline {
+
+/**
+ * @brief The trace_batch_t struct, offcore packets of one job.
+ */
+struct trace_batch_t
+{
+    //
+    GpuJobPtr job;
+    //
+    std::vector<packet_t> pkts;
+};
+
+/**
+ * @brief The TraceQueue class
+ *
+ * Multiple producers, single consumer queue of trace batches. The
+ * filter threads push the offcore packets of their jobs in batches,
+ * and a writer thread serializes and compresses them into the job
+ * traces. All batches of a job go to the same queue, so they are
+ * written in order.
+ */
+class TraceQueue {
+
+public:
+
+    /**
+     * @brief TraceQueue
+     * @param max_batches batches queued before producers block
+     */
+    TraceQueue(size_t max_batches);
+
+    /**
+     * @brief TraceQueue
+     */
+    ~TraceQueue();
+
+    /**
+     * @brief push a batch, blocks while the queue is full
+     * @param batch swapped into the queue, left empty
+     */
+    void push(trace_batch_t &batch);
+
+    /**
+     * @brief pop all queued batches
+     * @param timeout
+     * @param batches
+     * @return false on timeout
+     */
+    bool pop(int timeout, std::deque<trace_batch_t> &batches);
+
+    /**
+     * @brief signal_producer, popped batches are written
+     */
+    void signal_producer();
+
+    /**
+     * @brief wait until all pushed batches are written
+     */
+    void wait();
+
+private:
+
+    //
+    Mutex mtx;
+
+    //
+    Semaphore consumer_has_work;
+
+    //
+    Semaphore producer_has_space;
+
+    //
+    Semaphore consumer_idle;
+
+    //
+    std::deque<trace_batch_t> queue;
+
+    //
+    size_t max_batches;
+
+    // Batches popped but not written yet
+    bool busy;
+
+private:
+
+    /**
+     * @brief operator =
+     * @param other
+     */
+    void operator=(const TraceQueue &other) {}
+
+};
+
+/**
+ * @brief TraceQueuePtr
+ */
+typedef std::shared_ptr<TraceQueue> TraceQueuePtr;
+
+} // end namespace pipeline
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_TRACE_QUEUE_HH__
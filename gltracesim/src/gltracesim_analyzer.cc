@@ -1,4 +1,10 @@
 #include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <google/protobuf/empty.pb.h>
 
 #include "debug.hh"
 #include "debug_impl.hh"
@@ -10,10 +16,8 @@
 
 #include "analyzer/cpu.hh"
 #include "analyzer/gpu.hh"
-
-#include "analyzer/schedular/fcfs.hh"
-#include "analyzer/schedular/z.hh"
-#include "analyzer/schedular/random.hh"
+#include "analyzer/instance.hh"
+#include "analyzer/trace_decoder.hh"
 
 #include "gltracesim.pb.h"
 
@@ -30,8 +34,8 @@ GlTraceSimAnalyzer::stop_timer_loop(uint64_t seconds)
     system->stop();
 }
 
-GlTraceSimAnalyzer::GlTraceSimAnalyzer(const std::string &output_dir) :
-    cpu(NULL), gpu(NULL)
+Json::Value
+GlTraceSimAnalyzer::load_config(const std::string &output_dir)
 {
     //
     Json::Value config;
@@ -45,21 +49,144 @@ GlTraceSimAnalyzer::GlTraceSimAnalyzer(const std::string &output_dir) :
     //
     config["output-dir"] = output_dir.c_str();
 
+    //
+    return config;
+}
+
+Json::Value
+GlTraceSimAnalyzer::instance_config(const Json::Value &config,
+    const Json::Value &overrides)
+{
+    //
+    Json::Value params = config;
+
+    //
+    params.removeMember("instances");
+
+    //
+    for (auto &key: overrides.getMemberNames()) {
+        params[key] = overrides[key];
+    }
+
+    // Named instances write next to each other
+    if (overrides.isMember("name")) {
+        params["output-dir"] = config["output-dir"].asString() + "/" +
+            overrides["name"].asString();
+    }
+
+    //
+    return params;
+}
+
+GlTraceSimAnalyzer::GlTraceSimAnalyzer(const std::string &output_dir,
+    const chunk_t &chunk) :
+    cpu(NULL), gpu(NULL)
+{
+    //
+    Json::Value config = load_config(output_dir);
+
     //
     Debug::init(config["debug"]);
 
+    // Workers write their stats next to each other, merged when all
+    // are done
+    if (chunk.id >= 0) {
+        //
+        std::string chunk_dir =
+            output_dir + "/chunk" + std::to_string(chunk.id);
+        //
+        ::mkdir(chunk_dir.c_str(), 0755);
+        //
+        config["output-dir"] = chunk_dir.c_str();
+    }
+
     // Sync
     conf.use_rsc_sync = config.get("use-rsc-sync", false).asBool();
     conf.use_global_sync = config.get("use-global-sync", false).asBool();
-    //
-    conf.num_gpu_cores = config.get("num-gpu-cores", 1).asInt();
-    conf.batch_size = config.get("batch-size", 4096).asUInt();
+
+    // Block streams
+    ProtoStream::setDefaultCodec(
+        config.get("proto-codec", "gz").asString()
+    );
+    ProtoInputStream::setDecodeThreads(
+        config.get("decode-threads", 2).asUInt()
+    );
+    ProtoOutputStream::setBlockSize(
+        config.get("proto-block-size", 1 << 20).asUInt()
+    );
+
+    // Packets buffered per job
+    GpuJob::set_ring_size(
+        config.get("trace-ring-size", 4096).asUInt()
+    );
 
     // Set fast forward frames
     sim_ctrl.start = config.get("start-frame", 0).asInt();
     // Set stop
     sim_ctrl.stop = config.get("stop-frame", INT_MAX).asInt();
 
+    // Frames before the chunk only advance the command streams, except
+    // for the last warmup-frames which warm up the models
+    sim_ctrl.skip = std::max(0,
+        chunk.first - config.get("warmup-frames", 1).asInt()
+    );
+    sim_ctrl.warmup = chunk.first;
+    //
+    sim_ctrl.stop = std::min(sim_ctrl.stop, chunk.last - 1);
+
+    // Frame-parallel workers only have warmed up state
+    checkpoint.interval = chunk.id < 0 ?
+        config.get("checkpoint-interval", 0).asInt() : 0;
+    checkpoint.dir = config.get("checkpoint-dir",
+        output_dir + "/checkpoints").asString();
+    checkpoint.restore = NULL;
+    checkpoint.frame = 0;
+    checkpoint.tsc = 0;
+    checkpoint.num_instances = 0;
+
+    // Frames before the checkpoint only advance the command streams,
+    // which rebuilds the resources and the schedular positions
+    if (config.isMember("restore-checkpoint")) {
+        //
+        std::string filename = ProtoStream::find(
+            config["restore-checkpoint"].asString() + "/checkpoint"
+        );
+
+        //
+        checkpoint.restore = new ProtoInputStream(filename);
+
+        //
+        ProtoMessage::PacketHeader hdr;
+        //
+        gltracesim::proto::Checkpoint ckpt;
+
+        //
+        if (checkpoint.restore->read(hdr) == false ||
+            checkpoint.restore->read(ckpt) == false) {
+            //
+            DPRINTF(Error, "Failed to read checkpoint %s.\n",
+                filename.c_str()
+            );
+            //
+            exit(EXIT_FAILURE);
+        }
+
+        //
+        checkpoint.frame = ckpt.frame_id();
+        checkpoint.tsc = ckpt.tsc();
+        checkpoint.num_instances = ckpt.num_instances();
+
+        //
+        sim_ctrl.skip = std::max<int>(sim_ctrl.skip, checkpoint.frame);
+        sim_ctrl.warmup = std::max<int>(sim_ctrl.warmup, checkpoint.frame);
+
+        //
+        DPRINTF(Init, "Restoring checkpoint [frame: %i, tsc: %lu, "
+            "instances: %lu].\n",
+            checkpoint.frame, checkpoint.tsc, checkpoint.num_instances
+        );
+    }
+
     // Enable timer
     uint64_t seconds = config.get("stop-time", 0).asUInt64();
     if (seconds)
@@ -91,87 +218,38 @@ GlTraceSimAnalyzer::GlTraceSimAnalyzer(const std::string &output_dir) :
 
     //
     trace_manager = TraceManagerPtr(new TraceManager(config));
-
     //
-    ProtoMessage::PacketHeader hdr;
+    trace_decoder = TraceDecoderPtr(new TraceDecoder(config));
 
-    pb.stats = new ProtoOutputStream(
-        output_dir + "/stats.pb.gz"
-    );
+    // Without instances the session is a single configuration
+    if (config["instances"].empty()) {
+        config["instances"].append(Json::Value(Json::objectValue));
+    }
 
-    //
-    hdr.set_obj_id("gltracesim-stats");
-    hdr.set_ver(0);
-    hdr.set_tick_freq(1);
+    // Decoded job traces are replayed by every instance
+    GpuJob::set_num_replays(config["instances"].size());
 
     //
-    pb.stats->write(hdr);
-
-    //
-    for (unsigned i = 0; i < config["models"].size(); ++i) {
-        //
-        Json::Value &params = config["models"][i];
+    for (unsigned i = 0; i < config["instances"].size(); ++i) {
         //
-        params["output-dir"] = config["output-dir"];
-        params["benchmark-name"] = config["benchmark-name"];
-
-        //
-        AnalyzerBuilder* builder = gltracesim::Analyzer::find_builder(
-            params["type"].asCString()
-        );
+        Json::Value overrides = config["instances"][i];
 
-        //
-        if (builder == NULL) {
-            //
-            DPRINTF(Init, "No such analyzer (%s).\n",
-                params["type"].asCString()
-            );
-            //
-            exit(EXIT_FAILURE);
+        // Instances of a session need their own output directory
+        if (config["instances"].size() > 1 && !overrides.isMember("name")) {
+            overrides["name"] = std::to_string(i);
         }
 
-        DPRINTF(Init, "Loading Analyzer (%s).\n", builder->get_name().c_str());
-
         //
-        AnalyzerPtr analyzer = builder->create(params);
+        Json::Value params = instance_config(config, overrides);
 
         //
-        assert(analyzer);
-
-        //
-        analyzers.push_back(analyzer);
+        instances.push_back(new analyzer::Instance(params, this, i));
     }
 
-    //
-    auto schedular_type = config["schedular"].get("type", "fcfs").asString();
-    //
-    config["schedular"]["output-dir"] = config["output-dir"];
-
-    if (schedular_type == "fcfs") {
-        schedular = analyzer::schedular::SchedularPtr(
-            new analyzer::schedular::FCFSSchedular(
-                config["schedular"]
-            )
-        );
-    } else if (schedular_type == "z") {
-        schedular = analyzer::schedular::SchedularPtr(
-            new analyzer::schedular::ZSchedular(
-                config["schedular"]
-            )
-        );
-    } else if (schedular_type == "r") {
-        schedular = analyzer::schedular::SchedularPtr(
-            new analyzer::schedular::RandomSchedular(
-                config["schedular"]
-            )
-        );
-    } else {
-        assert(0);
-    }
-
-    //
-    cpu = new analyzer::CPU(config, this, schedular);
-    gpu = new analyzer::GPU(config, this, schedular);
+    // The barriers between the command streams are kept by the
+    // schedular of the first instance
+    cpu = new analyzer::CPU(config, this, instances[0]->schedular);
+    gpu = new analyzer::GPU(config, this, instances[0]->schedular);
 
     //
     handle_new_frame();
@@ -179,20 +257,26 @@ GlTraceSimAnalyzer::GlTraceSimAnalyzer(const std::string &output_dir) :
 
 GlTraceSimAnalyzer::~GlTraceSimAnalyzer()
 {
+    delete checkpoint.restore;
     delete cpu;
     delete gpu;
-    delete pb.stats;
+    //
+    for (auto instance: instances) {
+        delete instance;
+    }
+    //
+    trace_decoder = NULL;
 }
 
 void
 GlTraceSimAnalyzer::handle_end_scene()
 {
     //
-    for (auto &analyzer: analyzers) {
-        //
-        analyzer->dump_stats();
-        //
-        analyzer->reset_stats();
+    sync_models();
+
+    //
+    for (auto instance: instances) {
+        instance->end_scene(is_warming_up() == false);
     }
 
     //
@@ -204,24 +288,39 @@ void
 GlTraceSimAnalyzer::handle_new_scene()
 {
     //
-    for (auto &analyzer: analyzers) {
+    sync_models();
+
+    //
+    for (auto instance: instances) {
         //
-        analyzer->start_new_scene(
+        instance->start_new_scene(
             system->get_frame_nbr(),
             system->get_scene_nbr()
         );
+        // Decisions of the warmup frames belong to the previous chunk
+        instance->schedular->set_dump_schedule(!is_warming_up());
+    }
+
+    // Skipped jobs are never loaded
+    if (is_skipping()) {
+        return;
     }
 
+    // Decode the job traces of the scene ahead of the cores, in the
+    // order of the first instance
+    std::vector<GpuJobPtr> jobs;
     //
-    schedular->start_new_scene(
-        system->get_frame_nbr(),
-        system->get_scene_nbr()
-    );
+    instances[0]->schedular->peek_jobs(jobs);
+    //
+    trace_decoder->prefetch(jobs);
 }
 
 void
 GlTraceSimAnalyzer::handle_end_frame()
 {
+    //
+    sync_models();
+
     //
     gltracesim::proto::Frame frame;
 
@@ -235,59 +334,26 @@ GlTraceSimAnalyzer::handle_end_frame()
     //
     frame.mutable_sim_stats()->set_duration(current_frame->duration());
 
-    // Time scaling factor
-    double tsf = 1.0 / (current_frame->duration() * 1048576);
-
-    size_t tot_pkts = cpu->get_core()->stats.no_pkts;
-    size_t tot_jobs = cpu->get_core()->stats.no_jobs;;
-
-    for (size_t core_id = 0; core_id < conf.num_gpu_cores; ++core_id) {
-        tot_jobs += gpu->get_core(core_id)->stats.no_jobs;
-        tot_pkts += gpu->get_core(core_id)->stats.no_pkts;
-    }
-
     //
-    DPRINTF(GpuFrameEvent,
-        "Frame: %lu [jobs: %lu, pkts: %lu, %.2fM/s, duration: %fs]\n",
-        current_frame->id,
-        tot_jobs, tot_pkts, tot_pkts * tsf,
-        current_frame->duration()
-    );
-
-    //
-    DPRINTF(GpuFrameEvent, "  CPU: [jobs: %lu, pkts: %lu, %.2fM/s]\n",
-        cpu->get_core()->stats.no_jobs,
-        cpu->get_core()->stats.no_pkts,
-        cpu->get_core()->stats.no_pkts * tsf
-    );
-
-    //
-    cpu->get_core()->stats.no_jobs = 0;
-    cpu->get_core()->stats.no_pkts = 0;
-
-    //
-    for (size_t core_id = 0; core_id < conf.num_gpu_cores; ++core_id) {
-        //
-        DPRINTF(GpuFrameEvent,
-            "  GPU core: %3i [jobs: %lu, pkts: %lu, %.2fM/s]\n",
-            core_id,
-            gpu->get_core(core_id)->stats.no_jobs,
-            gpu->get_core(core_id)->stats.no_pkts,
-            gpu->get_core(core_id)->stats.no_pkts * tsf
-        );
-
-        gpu->get_core(core_id)->stats.no_jobs = 0;
-        gpu->get_core(core_id)->stats.no_pkts = 0;
+    for (auto instance: instances) {
+        instance->end_frame(frame, is_warming_up() == false);
     }
 
-    //
-    pb.stats->write(frame);
+    // Shared by the instances
+    GpuJob::decode_cycles.reset();
 
     //
     system->inc_frame_nbr();
     //
     system->set_scene_nbr(0);
 
+    // Only the state of replayed frames is checkpointed
+    if (checkpoint.interval > 0 &&
+        int(system->get_frame_nbr()) > sim_ctrl.skip &&
+        system->get_frame_nbr() % checkpoint.interval == 0) {
+        save_checkpoint();
+    }
+
     // Fast-forwardning
     sim_ctrl.start = std::max(0, sim_ctrl.start - 1);
 
@@ -311,6 +377,9 @@ GlTraceSimAnalyzer::handle_end_frame()
 void
 GlTraceSimAnalyzer::handle_new_frame()
 {
+    //
+    sync_models();
+
     //
     current_frame = trace_manager->get_frame(system->get_frame_nbr());
 
@@ -324,48 +393,367 @@ GlTraceSimAnalyzer::handle_new_frame()
         return;
     }
 
+    // Fast-forwarded to the checkpoint
+    if (checkpoint.restore &&
+        int(system->get_frame_nbr()) == checkpoint.frame) {
+        restore_checkpoint();
+    }
+
+    //
+    for (auto instance: instances) {
+        instance->start_new_frame(system->get_frame_nbr());
+    }
+
+    //
+    current_frame->start();
+}
+
+void
+GlTraceSimAnalyzer::save_checkpoint()
+{
+    //
+    std::string dir =
+        checkpoint.dir + "/f" + std::to_string(system->get_frame_nbr());
+
+    //
+    ::mkdir(checkpoint.dir.c_str(), 0755);
+    ::mkdir(dir.c_str(), 0755);
+
+    //
+    ProtoOutputStream os(ProtoStream::filename(dir + "/checkpoint"));
+
+    //
+    ProtoMessage::PacketHeader hdr;
+    //
+    hdr.set_obj_id("gltracesim-checkpoint");
+    hdr.set_ver(0);
+    hdr.set_tick_freq(1);
+    //
+    os.write(hdr);
+
+    //
+    gltracesim::proto::Checkpoint ckpt;
+    //
+    ckpt.set_frame_id(system->get_frame_nbr());
+    ckpt.set_tsc(system->get_tsc());
+    ckpt.set_num_instances(instances.size());
+    //
+    os.write(ckpt);
+
+    //
+    for (auto instance: instances) {
+        instance->save_checkpoint(&os);
+    }
+
     //
-    for (auto &analyzer: analyzers) {
+    DPRINTF(Init, "Checkpoint [frame: %lu, dir: %s].\n",
+        system->get_frame_nbr(), dir.c_str()
+    );
+}
+
+void
+GlTraceSimAnalyzer::restore_checkpoint()
+{
+    //
+    if (checkpoint.num_instances != instances.size()) {
         //
-        analyzer->start_new_frame(
-            system->get_frame_nbr()
+        DPRINTF(Error, "Checkpoint does not match the session [instances: "
+            "%lu, expected: %lu].\n",
+            checkpoint.num_instances, instances.size()
         );
+        //
+        exit(EXIT_FAILURE);
     }
 
     //
-    schedular->start_new_frame(
-        system->get_frame_nbr()
-    );
+    for (auto instance: instances) {
+        //
+        if (instance->restore_checkpoint(checkpoint.restore) == false) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Skipped frames do not replay packets
+    system->set_tsc(checkpoint.tsc);
 
     //
-    current_frame->start();
+    delete checkpoint.restore;
+    //
+    checkpoint.restore = NULL;
+
+    //
+    DPRINTF(Init, "Restored checkpoint [frame: %i].\n", checkpoint.frame);
 }
 
 void
-GlTraceSimAnalyzer::send_packet(packet_t &pkt)
+GlTraceSimAnalyzer::send_packets(analyzer::Instance *instance,
+    const replay_batch_t &pkts)
 {
     //
-    system->inc_tsc();
+    system->set_tsc(system->get_tsc() + pkts.n);
+
     //
-    for (auto &analyzer: analyzers) {
-        //
-        analyzer->process(pkt);
+    instance->send_packets(pkts);
+}
+
+bool
+GlTraceSimAnalyzer::is_skipping() const
+{
+    return int(system->get_frame_nbr()) < sim_ctrl.skip;
+}
+
+bool
+GlTraceSimAnalyzer::is_warming_up() const
+{
+    return int(system->get_frame_nbr()) < sim_ctrl.warmup;
+}
+
+void
+GlTraceSimAnalyzer::sync_models()
+{
+    //
+    for (auto instance: instances) {
+        instance->sync_models();
     }
 }
 
 void
 GlTraceSimAnalyzer::run()
 {
+    // Stops early if both command streams end without a last frame
+    while (system->is_running() && !events.empty()) {
+        events.service_one();
+    }
+
+    // Flush so we can see progress on cluster log files.
+    fflush(stdout);
+}
+
+/**
+ * @brief list_streams, finds the proto streams below a directory
+ * @param dir
+ * @param prefix path of dir relative to the top directory
+ * @param streams paths of the streams, relative to the top directory
+ * @param dirs paths of the sub directories, parents first
+ */
+static void
+list_streams(const std::string &dir, const std::string &prefix,
+    std::vector<std::string> &streams, std::vector<std::string> &dirs)
+{
+    //
+    DIR *d = opendir(dir.c_str());
     //
-    while (system->is_running()) {
+    assert(d);
+
+    //
+    while (struct dirent *entry = readdir(d)) {
+        //
+        std::string name(entry->d_name);
+
+        //
+        if (name == "." || name == "..") {
+            continue;
+        }
+
+        //
+        if (entry->d_type == DT_DIR) {
+            //
+            dirs.push_back(prefix + name);
+            //
+            list_streams(dir + "/" + name, prefix + name + "/", streams, dirs);
+            //
+            continue;
+        }
+
+        // Proto streams, not their indices
+        if (name.find(".pb") == std::string::npos ||
+            name.find(".idx") != std::string::npos) {
+            continue;
+        }
+
         //
-        cpu->tick();
+        streams.push_back(prefix + name);
+    }
+
+    //
+    closedir(d);
+}
+
+bool
+GlTraceSimAnalyzer::run_chunks(const std::string &output_dir)
+{
+    //
+    Json::Value config = load_config(output_dir);
+
+    //
+    int num_chunks = config.get("frame-chunks", 1).asInt();
+
+    // A restored run continues from one checkpoint
+    if (num_chunks <= 1 || config.isMember("restore-checkpoint")) {
+        return false;
+    }
+
+    //
+    Debug::init(config["debug"]);
+
+    // Frames to simulate, the trace manager is gone before forking
+    int num_frames = 0;
+    {
+        TraceManager tm(config);
         //
-        gpu->tick();
+        num_frames = std::min<int64_t>(tm.get_num_frames(),
+            int64_t(config.get("stop-frame", INT_MAX).asInt()) + 1
+        );
     }
 
-    // Flush so we can see progress on cluster log files.
+    //
+    num_chunks = std::max(1, std::min(num_chunks, num_frames));
+
+    //
+    DPRINTF(Init, "Frame-parallel [frames: %i, chunks: %i, warmup: %i].\n",
+        num_frames, num_chunks, config.get("warmup-frames", 1).asInt()
+    );
+
+    // Flush before forking, or the workers print it again
     fflush(stdout);
+
+    //
+    std::vector<pid_t> workers;
+
+    //
+    for (int i = 0; i < num_chunks; ++i) {
+        //
+        chunk_t chunk;
+        //
+        chunk.id = i;
+        chunk.first = int64_t(num_frames) * i / num_chunks;
+        chunk.last = int64_t(num_frames) * (i + 1) / num_chunks;
+
+        //
+        pid_t pid = fork();
+
+        //
+        if (pid < 0) {
+            DPRINTF(Error, "Failed to fork worker %i.\n", i);
+            exit(EXIT_FAILURE);
+        }
+
+        // Worker
+        if (pid == 0) {
+            {
+                //
+                GlTraceSimAnalyzer analyzer(output_dir, chunk);
+                //
+                analyzer.run();
+            }
+            //
+            exit(EXIT_SUCCESS);
+        }
+
+        //
+        workers.push_back(pid);
+    }
+
+    //
+    bool failed = false;
+
+    //
+    for (size_t i = 0; i < workers.size(); ++i) {
+        //
+        int status = 0;
+        //
+        waitpid(workers[i], &status, 0);
+
+        //
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            //
+            DPRINTF(Error, "Worker %lu failed.\n", i);
+            //
+            failed = true;
+        }
+    }
+
+    //
+    if (failed) {
+        exit(EXIT_FAILURE);
+    }
+
+    //
+    merge_chunks(output_dir, num_chunks);
+
+    //
+    return true;
+}
+
+void
+GlTraceSimAnalyzer::merge_chunks(const std::string &output_dir,
+    size_t num_chunks)
+{
+    //
+    std::vector<std::string> streams;
+    //
+    std::vector<std::string> dirs;
+
+    // All chunks write the same streams
+    list_streams(output_dir + "/chunk0", "", streams, dirs);
+
+    // Instances of a session write to sub directories
+    for (auto &name: dirs) {
+        ::mkdir((output_dir + "/" + name).c_str(), 0755);
+    }
+
+    //
+    for (auto &name: streams) {
+        //
+        ProtoOutputStream os(output_dir + "/" + name);
+
+        //
+        for (size_t i = 0; i < num_chunks; ++i) {
+            //
+            std::string filename =
+                output_dir + "/chunk" + std::to_string(i) + "/" + name;
+
+            //
+            {
+                ProtoInputStream is(filename);
+
+                // One header per stream
+                ProtoMessage::PacketHeader hdr;
+                //
+                is.read(hdr);
+                //
+                if (i == 0) {
+                    os.write(hdr);
+                }
+
+                // Copied as unknown fields, whatever the message type
+                google::protobuf::Empty msg;
+                //
+                while (is.read(msg)) {
+                    os.write(msg);
+                }
+            }
+
+            //
+            unlink(filename.c_str());
+        }
+
+        //
+        DPRINTF(Init, "Merged %s.\n", name.c_str());
+    }
+
+    //
+    for (size_t i = 0; i < num_chunks; ++i) {
+        //
+        std::string chunk_dir = output_dir + "/chunk" + std::to_string(i);
+
+        // Sub directories first
+        for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
+            rmdir((chunk_dir + "/" + *it).c_str());
+        }
+        //
+        rmdir(chunk_dir.c_str());
+    }
 }
 
 } // end namespace gltracesim
@@ -375,6 +763,12 @@ main(int argc, char *argv[])
 {
     //
     std::string outdir(argv[1]);
+
+    // Frame-parallel workers
+    if (gltracesim::GlTraceSimAnalyzer::run_chunks(outdir)) {
+        return EXIT_SUCCESS;
+    }
+
     //
     gltracesim::GlTraceSimAnalyzer analyzer(outdir);
     //
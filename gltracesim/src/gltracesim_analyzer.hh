@@ -2,6 +2,7 @@
 #define __GLTRACESIM_TRACE_ANALYZER_HH__
 
 #include <atomic>
+#include <climits>
 #include <string>
 #include <memory>
 #include <vector>
@@ -13,6 +14,7 @@
 #include "device.hh"
 #include "analyzer.hh"
 
+#include "analyzer/event_queue.hh"
 #include "analyzer/schedular/base.hh"
 #include "analyzer/trace_manager.hh"
 
@@ -25,6 +27,7 @@ namespace gltracesim {
 namespace analyzer {
 class CPU;
 class GPU;
+class Instance;
 }
 
 /**
@@ -50,25 +53,45 @@ public:
          */
         bool use_rsc_sync;
 
-        /**
-         * @brief num_gpu_cores
-         */
-        size_t num_gpu_cores;
+    } conf;
 
-        /**
-         * @brief batch_size
-         */
-        size_t batch_size;
+    /**
+     * @brief events, drives the CPU, the GPU and its cores
+     */
+    analyzer::EventQueue events;
 
-    } conf;
+    /**
+     * @brief instances, the configurations of the session replaying
+     * the trace
+     */
+    std::vector<analyzer::Instance*> instances;
+
+    /**
+     * @brief The chunk_t struct, frames simulated by a frame-parallel
+     * worker
+     */
+    struct chunk_t {
+
+        //
+        chunk_t() : id(-1), first(0), last(INT_MAX) {}
+
+        // Worker, -1 when not frame-parallel
+        int id;
+        // First frame with stats
+        int first;
+        // Frame after the last
+        int last;
+    };
 
 public:
 
     /**
      * @brief VirtualMemoryManager
      * @param name
+     * @param chunk frames of a frame-parallel worker
      */
-    GlTraceSimAnalyzer(const std::string &output_dir);
+    GlTraceSimAnalyzer(const std::string &output_dir,
+        const chunk_t &chunk = chunk_t());
 
     /**
      * @brief ~VirtualMemoryManager
@@ -82,6 +105,20 @@ public:
      */
     void run();
 
+    /**
+     * @brief run_chunks, splits the frames into frame-chunks chunks and
+     * runs every chunk in a forked worker, then merges the stats
+     * @param output_dir
+     * @return false if the frames are not split
+     */
+    static bool run_chunks(const std::string &output_dir);
+
+    /**
+     * @brief is_skipping
+     * @return true if the jobs of the current frame are not replayed
+     */
+    bool is_skipping() const;
+
 public:
 
     /**
@@ -105,10 +142,18 @@ public:
     void handle_end_frame();
 
     /**
-     * @brief send_packet
-     * @param pkt
+     * @brief send_packets
+     * @param instance
+     * @param pkts
+     */
+    void send_packets(analyzer::Instance *instance,
+        const replay_batch_t &pkts);
+
+    /**
+     * @brief sync_models, waits until the models processed all packets
+     * sent, before the models or the state they read change
      */
-    void send_packet(packet_t &pkt);
+    void sync_models();
 
     /**
      * @brief stop_timer_loop
@@ -116,6 +161,52 @@ public:
      */
     void stop_timer_loop(uint64_t seconds);
 
+private:
+
+    /**
+     * @brief load_config
+     * @param output_dir
+     * @return
+     */
+    static Json::Value load_config(const std::string &output_dir);
+
+    /**
+     * @brief instance_config, the session config with the overrides of
+     * an instance, writing to a directory named after the instance
+     * @param config
+     * @param overrides
+     * @return
+     */
+    static Json::Value instance_config(const Json::Value &config,
+        const Json::Value &overrides);
+
+    /**
+     * @brief merge_chunks, concatenates the stats streams of the chunks
+     * in frame order
+     * @param output_dir
+     * @param num_chunks
+     */
+    static void merge_chunks(const std::string &output_dir,
+        size_t num_chunks);
+
+    /**
+     * @brief is_warming_up
+     * @return true if the stats of the current frame are discarded
+     */
+    bool is_warming_up() const;
+
+    /**
+     * @brief save_checkpoint, writes the state of the models at the
+     * start of the current frame
+     */
+    void save_checkpoint();
+
+    /**
+     * @brief restore_checkpoint, loads the state of the models once the
+     * command streams are fast-forwarded to the checkpoint frame
+     */
+    void restore_checkpoint();
+
 private:
 
     /**
@@ -131,24 +222,33 @@ private:
         int start;
         // Stop epoch
         int stop;
+        // Frames before are not replayed
+        int skip;
+        // Frames before warm up the models, their stats are discarded
+        int warmup;
     } sim_ctrl;
 
     /**
-     * @brief The proto_t struct
+     * @brief The checkpoint_t struct
      */
-    struct proto_t {
-        //
-        ProtoOutputStream *stats;
-    } pb;
+    struct checkpoint_t {
+        // Frames between checkpoints, 0 if disabled
+        int interval;
+        // Checkpoints are written to dir/f<frame>
+        std::string dir;
+        // Checkpoint to restore, NULL once restored
+        ProtoInputStream *restore;
+        // Frame of the checkpoint to restore
+        int frame;
+        // Packets replayed before the checkpoint
+        uint64_t tsc;
+        // Instances of the checkpointed session
+        size_t num_instances;
+    } checkpoint;
 
     // Current frame
     FramePtr current_frame;
 
-    /**
-     * Analyzers that will be analyzed
-     */
-    std::vector<AnalyzerPtr> analyzers;
-
     /**
      * @brief cpu
      */
@@ -159,11 +259,6 @@ private:
      */
     analyzer::GPU *gpu;
 
-    /**
-     * @brief schedular
-     */
-    analyzer::schedular::SchedularPtr schedular;
-
 };
 
 
@@ -33,6 +33,9 @@ static VOID _analysis_thread_work_loop_wrapper(VOID *_aid) {
 static VOID _filter_thread_work_loop_wrapper(VOID *_fid) {
     gltracesim::simulator->filter_thread_work_loop(uint64_t(_fid));
 }
+static VOID _writer_thread_work_loop_wrapper(VOID *_wid) {
+    gltracesim::simulator->writer_thread_work_loop(uint64_t(_wid));
+}
 
 GlTraceSim::thread_state_t::thread_state_t() :
     line_buffer(0), line_buffer_dirty(false), job(NULL)
@@ -90,6 +93,14 @@ GlTraceSim::GlTraceSim(const std::string &output_dir)
         new VirtualMemoryManager(config["virtual-memory"])
     );
 
+    // Codec and block size of compressed streams
+    ProtoStream::setDefaultCodec(
+        config.get("proto-codec", "gz").asString()
+    );
+    ProtoOutputStream::setBlockSize(
+        config.get("proto-block-size", 1 << 20).asUInt()
+    );
+
     // Set fast forward frames
     sim_ctrl.start = config.get("start-frame", 0).asInt();
     // Set stop
@@ -99,6 +110,8 @@ GlTraceSim::GlTraceSim(const std::string &output_dir)
     auto_prune_mem_insts = config.get("auto-prune-mem-insts", false).asBool();
     //
     has_new_code = false;
+    //
+    scene_ordinal = 0;
 
     DPRINTF(Init, "Simulating frames (%i-%i).\n",
         sim_ctrl.start, sim_ctrl.stop
@@ -112,49 +125,54 @@ GlTraceSim::GlTraceSim(const std::string &output_dir)
 
     //
     pb.resources = new ProtoOutputStream(
-        output_dir + "/resources.pb.gz"
+        ProtoStream::filename(output_dir + "/resources")
     );
     pb.resources->write(hdr);
 
     //
     pb.frames = new ProtoOutputStream(
-        output_dir + "/frames.pb.gz"
+        ProtoStream::filename(output_dir + "/frames")
     );
     pb.frames->write(hdr);
 
     //
     pb.scenes = new ProtoOutputStream(
-        output_dir + "/scenes.pb.gz"
+        ProtoStream::filename(output_dir + "/scenes")
     );
     pb.scenes->write(hdr);
 
     //
     pb.jobs = new ProtoOutputStream(
-        output_dir + "/jobs.pb.gz"
+        ProtoStream::filename(output_dir + "/jobs")
     );
     pb.jobs->write(hdr);
 
     //
     pb.job_stats = new ProtoOutputStream(
-        output_dir + "/jobs.stats.pb.gz"
+        ProtoStream::filename(output_dir + "/jobs.stats")
     );
     pb.job_stats->write(hdr);
 
     //
     pb.opengl = new ProtoOutputStream(
-        output_dir + "/opengl.pb.gz"
+        ProtoStream::filename(output_dir + "/opengl")
     );
     pb.opengl->write(hdr);
 
     //
     pb.sim_stats = new ProtoOutputStream(
-        output_dir + "/stats.pb.gz"
+        ProtoStream::filename(output_dir + "/stats")
     );
     pb.sim_stats->write(hdr);
 
     //
     pipe = new pipeline::Pipeline();
 
+    //
+    trace_batch_size = config.get("trace-batch-size", 4096).asUInt();
+    //
+    stop_writers = false;
+
     if (config["stop-time"].asInt()) {
         stop_timer = new StopTimer(config["stop-time"].asInt());
     } else {
@@ -164,11 +182,13 @@ GlTraceSim::GlTraceSim(const std::string &output_dir)
     //
     if (config.get("dump-trace", false).asBool()) {
         //
-        config["output-cpu-file"] =
-            config["output-dir"].asString() + "/cpu.pb.gz";
+        config["output-cpu-file"] = ProtoStream::filename(
+            config["output-dir"].asString() + "/cpu"
+        );
 
-        config["output-gpu-file"] =
-            config["output-dir"].asString() + "/gpu.pb.gz";
+        config["output-gpu-file"] = ProtoStream::filename(
+            config["output-dir"].asString() + "/gpu"
+        );
 
         //
         AnalyzerPtr tracer = AnalyzerPtr(
@@ -220,6 +240,29 @@ GlTraceSim::GlTraceSim(const std::string &output_dir)
 
 GlTraceSim::~GlTraceSim()
 {
+    // The writer threads are gone (see stop_trace_writers), write what
+    // was queued after they exited, then the partial batches
+    for (int wid = 0; wid < pipe->num_writer_threads(); ++wid) {
+        //
+        std::deque<pipeline::trace_batch_t> batches;
+        //
+        while (pipe->trace_queue[wid]->pop(0, batches)) {
+            //
+            for (auto &batch: batches) {
+                write_trace_batch(batch);
+            }
+            //
+            batches.clear();
+            //
+            pipe->trace_queue[wid]->signal_producer();
+        }
+    }
+
+    //
+    for (int fid = 0; fid < pipe->num_filter_threads(); ++fid) {
+        write_trace_batch(ts[fid].trace_batch);
+    }
+
     // Resources dead.
     if (config.get("dump-resources", false).asBool()) {
         for (auto &it: system->rt->get_alive()) {
@@ -275,6 +318,48 @@ GlTraceSim::start()
     }
 
     pipe->analysis_queue->start();
+
+    // No writer threads, the filter threads write the traces
+    for (int i = 0; i < config.get("num-trace-writer-threads", 1).asInt(); ++i) {
+
+        //
+        int wid = pipe->add_writer_thread(
+            config.get("trace-writer-queue", 64).asUInt()
+        );
+
+        //
+        writer_uids.push_back(PIN_THREAD_UID());
+
+        //
+        unsigned tid = PIN_SpawnInternalThread(
+            _writer_thread_work_loop_wrapper, (void*) uint64_t(wid), 0,
+            &writer_uids.back()
+        );
+
+        //
+        if (tid == INVALID_THREADID) {
+            fprintf(stderr, "Faild to create writer thread.");
+            exit(EXIT_FAILURE);
+        }
+
+        //
+        DPRINTF(Init, "Writer Thread: +%i [wid: %i]\n", tid, wid);
+    }
+}
+
+void
+GlTraceSim::stop_trace_writers()
+{
+    //
+    stop_writers = true;
+
+    // Batches of one job must not be written by two threads at once
+    for (auto &uid: writer_uids) {
+        PIN_WaitForThreadTermination(uid, PIN_INFINITE_TIMEOUT, NULL);
+    }
+
+    //
+    writer_uids.clear();
 }
 
 void
@@ -290,6 +375,9 @@ GlTraceSim::pause_and_drain_buffers()
 
         flush_filter_cache(fid, dev::CPU);
         flush_filter_cache(fid, dev::GPU);
+
+        //
+        submit_trace_batch(fid);
     }
 
     // Drain FilterOut and Analysis buffers
@@ -375,7 +463,7 @@ GlTraceSim::handle_new_job(int gid, GpuJobPtr job)
     //
     job->dump_info(&job_info);
     //
-    pb.jobs->write(job_info);
+    pb.jobs->write(job_info, job->frame_id);
     //
     rw_mtx.unlock();
 
@@ -424,6 +512,9 @@ GlTraceSim::handle_end_job(int gid)
     flush_filter_cache(gid, dev::CPU);
     flush_filter_cache(gid, dev::GPU);
 
+    // Last packets of the job, the writer finalizes its trace
+    submit_trace_batch(gid);
+
     pipe->filter_queue[gid]->push();
 
     //
@@ -601,7 +692,7 @@ GlTraceSim::handle_gpu_resource_create(int tid, struct llvmpipe_resource *lpr)
     gpu_resource->dump_info(&resource_info);
 
     //
-    pb.resources->write(resource_info);
+    pb.resources->write(resource_info, gpu_resource->id);
 
     // Record
     packet_t pkt;
@@ -712,7 +803,7 @@ GlTraceSim::handle_gpu_draw_vbo_begin(int tid)
         system->get_frame_nbr()
     ));
     //
-    new_job->configure_trace_generator();
+    new_job->configure_trace_generator(current_scene);
     //
     system->inc_job_nbr();
     //
@@ -750,7 +841,7 @@ GlTraceSim::handle_gpu_draw_vbo_end(int tid)
         dev::CPU
     ));
     //
-    new_job->configure_trace_generator();
+    new_job->configure_trace_generator(current_scene);
     //
     system->inc_job_nbr();
     //
@@ -799,6 +890,9 @@ GlTraceSim::handle_gpu_scene_end(int tid)
     //
     handle_sync(tid, END_SCENE);
 
+    // Traces of the scene are complete
+    drain_trace_writers();
+
     // Resources dead.
     for (auto &it: system->rt->get_alive()) {
         //
@@ -819,7 +913,7 @@ GlTraceSim::handle_gpu_scene_end(int tid)
     //
     current_scene->dump_info(&scene_info);
     //
-    pb.scenes->write(scene_info);
+    pb.scenes->write(scene_info, scene_ordinal++);
 
     //
     system->inc_scene_nbr();
@@ -872,7 +966,7 @@ GlTraceSim::handle_gpu_tile_begin(int tid, int x, int y)
         x, y
     ));
     //
-    new_job->configure_trace_generator();
+    new_job->configure_trace_generator(current_scene);
     //
     system->inc_job_nbr();
     //
@@ -913,7 +1007,7 @@ GlTraceSim::handle_gpu_tile_end(int tid)
         dev::CPU
     ));
     //
-    new_job->configure_trace_generator();
+    new_job->configure_trace_generator(current_scene);
     //
     system->inc_job_nbr();
     //
@@ -934,6 +1028,8 @@ GlTraceSim::handle_gpu_swap_buffers(int tid)
     //
     pause_and_drain_buffers();
     //
+    drain_trace_writers();
+    //
     rw_mtx.lock();
 
     //
@@ -1089,7 +1185,7 @@ GlTraceSim::handle_gpu_swap_buffers(int tid)
     //
     current_frame->dump_info(&frame_info);
     //
-    pb.frames->write(frame_info);
+    pb.frames->write(frame_info, current_frame->id);
 
     // Inc frame count
     system->inc_frame_nbr();
@@ -1118,7 +1214,7 @@ GlTraceSim::handle_gpu_swap_buffers(int tid)
     //
     current_scene->dump_info(&scene_info);
     //
-    pb.scenes->write(scene_info);
+    pb.scenes->write(scene_info, scene_ordinal++);
 
     // Reset intra frame markers
     system->set_scene_nbr(0);
@@ -1276,7 +1372,7 @@ GlTraceSim::handle_gpu_thread_start(int tid)
         dev::CPU
     ));
     //
-    new_job->configure_trace_generator();
+    new_job->configure_trace_generator(current_scene);
     //
     system->inc_job_nbr();
     //
@@ -1336,7 +1432,7 @@ GlTraceSim::flush_filter_cache(int fid, int dev)
             apkt.dev_id = dev;
 
             //
-            ts[fid].job->trace->process(apkt);
+            record_trace_packet(fid, apkt);
 
             //
             stats[fid].no_rsc_offcore_mops[dev]++;
@@ -1354,7 +1450,7 @@ GlTraceSim::flush_filter_cache(int fid, int dev)
             }
         }
 
-        fce->valid = false;
+        filter_cache->invalidate(fce);
     }
 }
 
@@ -1477,8 +1573,6 @@ GlTraceSim::process_filter_buffer_item(int fid, packet_t &pkt)
     if (_l(fce)) {
         assert(fce->valid);
 
-        // Set LRU
-        fce->last_tsc = filter_cache->tick;
         // Update state
         fce->dirty |= (pkt.cmd == WRITE);
 
@@ -1509,7 +1603,7 @@ GlTraceSim::process_filter_buffer_item(int fid, packet_t &pkt)
         apkt.length = filter_cache->params.blk_size;
 
         //
-        ts[fid].job->trace->process(apkt);
+        record_trace_packet(fid, apkt);
 
         //
         stats[fid].no_rsc_offcore_mops[pkt.dev_id]++;
@@ -1528,11 +1622,9 @@ GlTraceSim::process_filter_buffer_item(int fid, packet_t &pkt)
     }
 
     // Insert blk
-    fcre->valid = true;
+    filter_cache->insert(fcre, pkt.vaddr);
     fcre->dirty = (pkt.cmd == WRITE);
-    fcre->addr = pkt.vaddr;
     fcre->paddr = system->vmem_manager->translate(pkt.vaddr);
-    fcre->last_tsc = filter_cache->tick;
     fcre->rsc_id = gpu_resource->id;
     fcre->job_id = pkt.job_id;
 
@@ -1553,7 +1645,7 @@ GlTraceSim::process_filter_buffer_item(int fid, packet_t &pkt)
         apkt.dev_id = pkt.dev_id;
 
         //
-        ts[fid].job->trace->process(apkt);
+        record_trace_packet(fid, apkt);
 
         //
         stats[fid].no_rsc_offcore_mops[pkt.dev_id]++;
@@ -1642,6 +1734,123 @@ GlTraceSim::filter_thread_work_loop(int fid)
     }
 }
 
+void
+GlTraceSim::record_trace_packet(int fid, const packet_t &pkt)
+{
+    //
+    pipeline::trace_batch_t &batch = ts[fid].trace_batch;
+
+    // Write inline
+    if (_u(pipe->num_writer_threads() == 0)) {
+        ts[fid].job->trace->process(pkt);
+        //
+        return;
+    }
+
+    //
+    if (_u(batch.job != ts[fid].job)) {
+        //
+        submit_trace_batch(fid);
+        //
+        batch.job = ts[fid].job;
+    }
+
+    //
+    batch.pkts.push_back(pkt);
+
+    //
+    if (_u(batch.pkts.size() >= trace_batch_size)) {
+        submit_trace_batch(fid);
+    }
+}
+
+void
+GlTraceSim::submit_trace_batch(int fid)
+{
+    //
+    pipeline::trace_batch_t &batch = ts[fid].trace_batch;
+
+    //
+    if (batch.pkts.empty()) {
+        //
+        batch.job = NULL;
+        //
+        return;
+    }
+
+    // Batches of a job go to the same writer, in order
+    int wid = batch.job->id % pipe->num_writer_threads();
+
+    // Swaps out the batch, the writer holds the job until written
+    pipe->trace_queue[wid]->push(batch);
+
+    //
+    batch.pkts.reserve(trace_batch_size);
+}
+
+void
+GlTraceSim::write_trace_batch(pipeline::trace_batch_t &batch)
+{
+    //
+    for (auto &pkt: batch.pkts) {
+        batch.job->trace->process(pkt);
+    }
+
+    //
+    batch.pkts.clear();
+
+    // May be the last reference, which finalizes the trace
+    batch.job = NULL;
+}
+
+void
+GlTraceSim::drain_trace_writers()
+{
+    //
+    for (int wid = 0; wid < pipe->num_writer_threads(); ++wid) {
+        pipe->trace_queue[wid]->wait();
+    }
+}
+
+void
+GlTraceSim::writer_thread_work_loop(int wid)
+{
+    //
+    std::deque<pipeline::trace_batch_t> batches;
+
+    // Drain buffers
+    while (true) {
+
+        // Timeout to see if we need to exit
+        bool has_work = pipe->trace_queue[wid]->pop(1000, batches);
+
+        // Exit once everything is written
+        if (has_work == false) {
+            //
+            if (stop_writers || PIN_IsProcessExiting()) {
+                //
+                DPRINTF(Init, "Writer Thread: -%i [wid: %i]\n",
+                    PIN_ThreadId(), wid);
+                //
+                return;
+            }
+            //
+            continue;
+        }
+
+        //
+        for (auto &batch: batches) {
+            write_trace_batch(batch);
+        }
+
+        //
+        batches.clear();
+
+        // Signal done
+        pipe->trace_queue[wid]->signal_producer();
+    }
+}
+
 void
 GlTraceSim::analysis_thread_work_loop(int aid)
 {
@@ -2291,6 +2500,12 @@ handle_gpu_thread_stop(THREADID tid, const CONTEXT *ctxt, INT32 flags, VOID *v)
     gltracesim::simulator->handle_gpu_thread_stop(tid);
 }
 
+static VOID
+handle_app_prepare_finish(VOID *v)
+{
+    gltracesim::simulator->stop_trace_writers();
+}
+
 static VOID
 handle_app_finish(INT32 code, VOID *v)
 {
@@ -2339,6 +2554,7 @@ main(int argc, char *argv[])
     PIN_AddThreadFiniFunction(handle_gpu_thread_stop, 0);
 
     //
+    PIN_AddPrepareForFiniFunction(handle_app_prepare_finish, 0);
     PIN_AddFiniFunction(handle_app_finish, 0);
 
     //
@@ -83,6 +83,12 @@ public:
      */
     void start();
 
+    /**
+     * @brief stop_trace_writers, before Fini, the writer threads write
+     * their queued batches and exit
+     */
+    void stop_trace_writers();
+
 public:
 
     /* Pin/GPU */
@@ -273,6 +279,41 @@ public:
      */
     void filter_thread_work_loop(int fid);
 
+    /* Trace output */
+
+    /**
+     * @brief record_trace_packet, adds an offcore packet to the trace
+     * batch of the filter thread
+     * @param fid
+     * @param pkt
+     */
+    void record_trace_packet(int fid, const packet_t &pkt);
+
+    /**
+     * @brief submit_trace_batch, hands the trace batch of a filter
+     * thread to the writer of its job
+     * @param fid
+     */
+    void submit_trace_batch(int fid);
+
+    /**
+     * @brief write_trace_batch
+     * @param batch
+     */
+    void write_trace_batch(pipeline::trace_batch_t &batch);
+
+    /**
+     * @brief drain_trace_writers, waits until all submitted batches are
+     * written
+     */
+    void drain_trace_writers();
+
+    /**
+     * @brief writer_thread_work_loop
+     * @param wid
+     */
+    void writer_thread_work_loop(int wid);
+
     /* Analysis */
 
     /**
@@ -367,6 +408,11 @@ private:
          * @brief current_job
          */
         GpuJobPtr job;
+
+        /**
+         * @brief offcore packets not yet handed to a writer thread
+         */
+        pipeline::trace_batch_t trace_batch;
     };
 
     /**
@@ -379,6 +425,22 @@ private:
      */
     pipeline::Pipeline *pipe;
 
+    /**
+     * @brief packets per trace batch
+     */
+    size_t trace_batch_size;
+
+    /**
+     * @brief writer_uids, of the writer threads to wait for
+     */
+    std::vector<PIN_THREAD_UID> writer_uids;
+
+    /**
+     * @brief stop_writers, the writer threads exit once their queues
+     * are empty
+     */
+    volatile bool stop_writers;
+
     /**
      * @brief stop_timer
      */
@@ -422,6 +484,12 @@ private:
      */
     FramePtr current_frame;
 
+    /**
+     * @brief global ordinal of the next scene written, used as the key
+     * of the scene index
+     */
+    size_t scene_ordinal;
+
     //
     struct stats_t {
         //
@@ -13,6 +13,10 @@
 
 namespace gltracesim {
 
+size_t GpuJob::ring_size = 4096;
+size_t GpuJob::num_replays = 1;
+CycleCounter GpuJob::decode_cycles;
+void (*GpuJob::schedule_read_ahead)(const GpuJobPtr &job) = NULL;
 
 GpuJob::stats_t::stats_t()
 {
@@ -42,7 +46,11 @@ GpuJob::GpuJob(
       dev(dev),
       core_id(-1),
       x(-1), y(-1),
-      trace(NULL)
+      trace(NULL),
+      reader(NULL),
+      loaded(false),
+      first_blk(0),
+      ahead_ready(false)
 {
 
 }
@@ -52,11 +60,13 @@ GpuJob::~GpuJob()
     if (trace) {
         delete trace;
     }
-    assert(pkts.empty());
+    if (reader) {
+        delete reader;
+    }
 }
 
 void
-GpuJob::configure_trace_generator()
+GpuJob::configure_trace_generator(const ScenePtr &scene)
 {
     //
     mkdir("%s/f%u64/s%u64/",
@@ -66,100 +76,301 @@ GpuJob::configure_trace_generator()
     );
 
     //
-    std::stringstream output_file;
-    output_file << system->get_output_dir() << "/"
-               << "f" << frame_id << "/"
-               << "s" << scene_id << "/"
-               << "j" << id << ".trace.pb.gz";
+    std::stringstream scene_dir;
+    scene_dir << system->get_output_dir() << "/"
+              << "f" << frame_id << "/"
+              << "s" << scene_id << "/";
 
     Json::Value params;
-    params["output-file"] = output_file.str();
+    params["blk-size"] = Json::UInt(system->get_blk_size());
+    params["dev-id"] = dev;
+
+    //
+    const Json::Value &config = system->get_config();
+
+    //
+    std::string format = config.get("trace-format", "compact").asString();
+
+    // Compact traces of a scene share one archive
+    if (format == "compact" && config.get("trace-archive", true).asBool()) {
+        //
+        assert(scene);
+        assert(scene->id == scene_id && scene->frame_id == frame_id);
+
+        //
+        if (!scene->trace_archive) {
+            scene->trace_archive = gem5::TraceArchiveWriterPtr(
+                new gem5::TraceArchiveWriter(
+                    ProtoStream::filename(scene_dir.str() + "jobs")
+                )
+            );
+        }
+
+        //
+        trace = new gem5::CompactTraceGenerator(
+            params, id, scene->trace_archive
+        );
+        //
+        return;
+    }
 
     //
-    trace = new gem5::AddrTraceGenerator(params, id);
+    std::stringstream output_file;
+    output_file << scene_dir.str() << "j" << id << ".trace";
+
+    //
+    params["output-file"] = ProtoStream::filename(output_file.str());
+
+    //
+    if (format == "compact") {
+        trace = new gem5::CompactTraceGenerator(params, id);
+    } else {
+        assert(format == "packet");
+        trace = new gem5::AddrTraceGenerator(params, id);
+    }
 }
 
 
 void
 GpuJob::load_trace()
 {
-    assert(pkts.empty());
+    // Loaded by an earlier replay
+    if (loaded) {
+        return;
+    }
 
     //
-    std::stringstream input_file;
+    loaded = true;
 
     //
-    input_file << system->get_input_dir() << "/"
-             << "f" << frame_id << "/"
-             << "s" << scene_id << "/"
-             << "j" << id << ".trace.pb.gz";
+    cursors.resize(num_replays);
 
+    //
+    reader = open_trace();
 
     //
-    struct stat sb;
+    refill();
+}
+
+bool
+GpuJob::next_blk(cursor_t &cursor)
+{
+    // Done with the current block
+    if (cursor.blk < first_blk + blks.size()) {
+        //
+        ++cursor.blk;
+        cursor.pos = 0;
+        //
+        release();
+    }
+
+    // Decode the next block, unless an earlier replay did
+    if (cursor.blk == first_blk + blks.size()) {
+        return refill();
+    }
 
     //
-    if (stat(input_file.str().c_str(), &sb) == -1) {
-        return;
+    return true;
+}
+
+void
+GpuJob::release()
+{
+    //
+    size_t min_blk = cursors[0].blk;
+    //
+    for (auto &cursor: cursors) {
+        min_blk = std::min(min_blk, cursor.blk);
     }
 
-    // No data, ignore.
-    if (sb.st_size < 64) {
+    //
+    while (first_blk < min_blk && !blks.empty()) {
+        //
+        spare.swap(blks.front().pkts);
+        //
+        blks.pop_front();
+        //
+        ++first_blk;
+    }
+}
+
+bool
+GpuJob::refill()
+{
+    // Waits for a read ahead being decoded
+    ahead_mtx.lock();
+
+    // Not read ahead yet, decode it here
+    if (ahead_ready == false) {
+        decode_ahead();
+    }
+
+    //
+    bool appended = ahead.len > 0;
+
+    //
+    if (appended) {
+        //
+        blks.push_back(blk_t());
+        //
+        blks.back().pkts.swap(ahead.pkts);
+        blks.back().len = ahead.len;
+
+        // Reuse the storage of a released block
+        ahead.pkts.swap(spare);
+        ahead.len = 0;
+        //
+        ahead_ready = false;
+    } else {
+        // Done, release the spare block
+        spare.clear();
+    }
+
+    // More to read ahead
+    bool more = appended && reader;
+
+    //
+    ahead_mtx.unlock();
+
+    //
+    if (more && schedule_read_ahead) {
+        schedule_read_ahead(shared_from_this());
+    }
+
+    //
+    return appended;
+}
+
+void
+GpuJob::read_ahead()
+{
+    //
+    ahead_mtx.lock();
+
+    // Decoded by the replays already
+    if (ahead_ready == false) {
+        decode_ahead();
+    }
+
+    //
+    ahead_mtx.unlock();
+}
+
+void
+GpuJob::decode_ahead()
+{
+    //
+    ahead_ready = true;
+    //
+    ahead.len = 0;
+
+    // Done
+    if (reader == NULL) {
+        //
+        ahead.pkts.clear();
+        //
         return;
     }
 
     //
-    ProtoInputStream *pkt_stream = new ProtoInputStream(input_file.str());
+    uint64_t start = read_cycles();
 
-//    //
-//    if (pkt_stream->good() == false) {
-//        //
-//        DPRINTF(Warn, "Failed to open stream to %s, retrying...\n",
-//                input_file.str().c_str());
-//        //
-//        sleep(1);
-//        //
-//        delete pkt_stream;
-//        // Retry
-//        load_trace();
-//        //
-//        return;
-//    }
+    //
+    ahead.pkts.resize(ring_size);
 
     //
-    ProtoMessage::PacketHeader hdr;
+    ahead.len = reader->read(ahead.pkts, ring_size);
+
     //
-    pkt_stream->read(hdr);
+    decode_cycles.add(read_cycles() - start, ahead.len);
+
+    // Done, release the trace
+    if (ahead.len == 0) {
+        //
+        delete reader;
+        reader = NULL;
+        //
+        ahead.pkts.clear();
+    }
+}
+
+gem5::TraceReader*
+GpuJob::open_trace()
+{
+    //
+    std::stringstream scene_dir;
+
+    //
+    scene_dir << system->get_input_dir() << "/"
+              << "f" << frame_id << "/"
+              << "s" << scene_id << "/";
+
+    // Scenes with an archive need no per-job file
+    gem5::TraceArchiveReaderPtr archive =
+        gem5::TraceArchiveReader::open(scene_dir.str() + "jobs");
 
     //
-    while (true) {
+    if (archive) {
+        //
+        ProtoMessage::CompactTraceHeader trace_hdr;
         //
-        ProtoMessage::Packet pb_pkt;
+        std::vector<ProtoStreamPos> chunks;
 
         //
-        if (pkt_stream->read(pb_pkt) == false) {
-            break;
+        if (archive->find(id, trace_hdr, chunks)) {
+            return new gem5::CompactArchiveReader(archive, trace_hdr, chunks);
         }
+    }
 
-        assert(pb_pkt.cmd() == gem5::MemCmd_ReadReq ||
-               pb_pkt.cmd() == gem5::MemCmd_WriteReq);
-        assert(pb_pkt.has_rsc_id());
-        assert(pb_pkt.has_job_id());
+    //
+    std::stringstream input_file;
 
-        //
-        packet_t pkt;
-        pkt.cmd = (pb_pkt.cmd() == gem5::MemCmd_ReadReq) ? READ : WRITE;
-        pkt.paddr = pb_pkt.addr();
-        pkt.rsc_id = pb_pkt.rsc_id();
-        pkt.job_id = pb_pkt.job_id();
-        pkt.dev_id = pb_pkt.dev_id();
+    //
+    input_file << scene_dir.str() << "j" << id << ".trace";
+
+    //
+    std::string filename = ProtoStream::find(input_file.str());
+
+
+    //
+    struct stat sb;
+
+    //
+    if (stat(filename.c_str(), &sb) == -1) {
+        return NULL;
+    }
+
+    // No data, ignore.
+    if (sb.st_size < 64) {
+        return NULL;
+    }
+
+    //
+    ProtoInputStream *pkt_stream = new ProtoInputStream(filename);
 
+    //
+    ProtoMessage::PacketHeader hdr;
+    //
+    pkt_stream->read(hdr);
+
+    //
+    if (hdr.ver() != gem5::CompactTraceVersion) {
+        return new gem5::PacketTraceReader(pkt_stream);
+    }
+
+    //
+    ProtoMessage::CompactTraceHeader trace_hdr;
+
+    //
+    if (pkt_stream->read(trace_hdr) == false) {
+        //
+        delete pkt_stream;
         //
-        pkts.push_back(pkt);
+        return NULL;
     }
 
     //
-    delete pkt_stream;
+    return new gem5::CompactStreamReader(pkt_stream, trace_hdr);
 }
 
 void
@@ -1,7 +1,9 @@
 #ifndef __GLTRACESIM_JOB_HH__
 #define __GLTRACESIM_JOB_HH__
 
+#include <deque>
 #include <map>
+#include <algorithm>
 #include <chrono>
 #include <unordered_map>
 #include <memory>
@@ -11,16 +13,22 @@
 #include "gltracesim.pb.h"
 #include "device.hh"
 #include "util/addr_range.hh"
+#include "util/cycle_counter.hh"
+#include "util/threads.hh"
 #include "util/timer.hh"
 
+#include "scene.hh"
 #include "gem5/trace.hh"
+#include "gem5/trace_reader.hh"
+
+#include "util/cflags.hh"
 
 #include "stats/distribution.hh"
 #include "stats/distribution_impl.hh"
 
 namespace gltracesim {
 
-class GpuJob : public Timer
+class GpuJob : public Timer, public std::enable_shared_from_this<GpuJob>
 {
 
 public:
@@ -150,8 +158,9 @@ public:
 
     /**
      * @brief configure_trace_generator
+     * @param scene scene of the job, holds the scene's trace archive
      */
-    void configure_trace_generator();
+    void configure_trace_generator(const ScenePtr &scene);
 
     /**
      * @brief trace
@@ -161,14 +170,202 @@ public:
 public:
 
     /**
-     * @brief load_trace
+     * @brief load_trace, opens the trace and buffers its first packets,
+     * done once for all replays
      */
     void load_trace();
 
     /**
-     * @brief pkts
+     * @brief read_ahead, decodes the next block of the trace while the
+     * replays are busy with the current ones
+     */
+    void read_ahead();
+
+    /**
+     * @brief next_packets, packets are streamed from the trace in blocks
+     * of ring-size packets. A block is decoded once and kept until all
+     * replays are done with it.
+     * @param pkts set to the next packets, valid until the next call
+     * @param max_pkts
+     * @param replay instance replaying the trace
+     * @return number of packets, 0 at the end
+     */
+    size_t next_packets(replay_batch_t &pkts, size_t max_pkts,
+        size_t replay = 0) {
+        //
+        cursor_t &cursor = cursors[replay];
+        //
+        if (_u(cursor.blk == first_blk + blks.size() ||
+               cursor.pos == blks[cursor.blk - first_blk].len) &&
+            next_blk(cursor) == false) {
+            return 0;
+        }
+        //
+        blk_t &blk = blks[cursor.blk - first_blk];
+        //
+        size_t n = std::min(max_pkts, blk.len - cursor.pos);
+        //
+        pkts = blk.pkts.batch(cursor.pos, n);
+        //
+        cursor.pos += n;
+        //
+        return n;
+    }
+
+    /**
+     * @brief buffered_size
+     * @return bytes of the packets buffered
+     */
+    size_t buffered_size() const {
+        //
+        size_t size = 0;
+        //
+        for (auto &blk: blks) {
+            size += blk.len * replay_buffer_t::packet_size;
+        }
+        //
+        return size;
+    }
+
+    /**
+     * @brief set_ring_size
+     * @param size packets buffered per job
+     */
+    static void set_ring_size(size_t size) {
+        ring_size = size;
+    }
+
+    /**
+     * @brief set_num_replays
+     * @param n times every trace is replayed, one per instance
+     */
+    static void set_num_replays(size_t n) {
+        num_replays = n;
+    }
+
+    /**
+     * @brief decode_cycles, time spent decoding job traces by all threads,
+     * items are packets
+     */
+    static CycleCounter decode_cycles;
+
+    /**
+     * @brief schedule_read_ahead, queues read_ahead of a job on the
+     * decode threads, NULL to decode every block when it is needed
+     */
+    static void (*schedule_read_ahead)(const std::shared_ptr<GpuJob> &job);
+
+private:
+
+    /**
+     * @brief The blk_t struct, decoded packets
+     */
+    struct blk_t {
+        //
+        replay_buffer_t pkts;
+        //
+        size_t len;
+    };
+
+    /**
+     * @brief The cursor_t struct, position of a replay
+     */
+    struct cursor_t {
+        //
+        cursor_t() : blk(0), pos(0) {}
+
+        // Index of the block in the trace
+        size_t blk;
+        //
+        size_t pos;
+    };
+
+    /**
+     * @brief open_trace
+     * @return reader of the job trace, or NULL if there is none
+     */
+    gem5::TraceReader* open_trace();
+
+    /**
+     * @brief next_blk, moves a replay to its next block
+     * @param cursor
+     * @return false at the end of the trace
+     */
+    bool next_blk(cursor_t &cursor);
+
+    /**
+     * @brief release the blocks all replays are done with
+     */
+    void release();
+
+    /**
+     * @brief refill, appends the next block of the trace, read ahead
+     * unless it was not decoded yet, and schedules the read ahead of the
+     * one after it
+     * @return false at the end of the trace
+     */
+    bool refill();
+
+    /**
+     * @brief decode_ahead, decodes the next block into ahead, the trace is
+     * closed at its end, ahead_mtx must be held
+     */
+    void decode_ahead();
+
+    /**
+     * @brief packets buffered per job
+     */
+    static size_t ring_size;
+
+    /**
+     * @brief replays of every trace
+     */
+    static size_t num_replays;
+
+    /**
+     * @brief reader
+     */
+    gem5::TraceReader *reader;
+
+    /**
+     * @brief loaded
+     */
+    bool loaded;
+
+    /**
+     * @brief blks still needed by a replay, oldest first
+     */
+    std::deque<blk_t> blks;
+
+    /**
+     * @brief first_blk, index of the first block of blks in the trace
+     */
+    size_t first_blk;
+
+    /**
+     * @brief cursors, one per replay
+     */
+    std::vector<cursor_t> cursors;
+
+    /**
+     * @brief spare, storage of a released block reused by the next
+     */
+    replay_buffer_t spare;
+
+    /**
+     * @brief ahead_mtx, protects reader and ahead
+     */
+    Mutex ahead_mtx;
+
+    /**
+     * @brief ahead, the next block, empty at the end of the trace
+     */
+    blk_t ahead;
+
+    /**
+     * @brief ahead_ready, set once ahead is decoded
      */
-    std::deque<packet_t> pkts;
+    bool ahead_ready;
 
 public:
 
@@ -1,6 +1,7 @@
 #ifndef __GLTRACESIM_PACKET_HH__
 #define __GLTRACESIM_PACKET_HH__
 
+#include <cstdint>
 #include <vector>
 
 #include "device.hh"
@@ -28,6 +29,14 @@ enum AccessType {
     NUM_ACCESS_TYPES
 };
 
+/**
+ * @brief Flags of a packet
+ */
+enum PacketFlags {
+    // Block evicted by a core-side model, holds the whole block
+    PKT_EVICTION = 1 << 0,
+};
+
 //
 struct packet_t
 {
@@ -40,7 +49,8 @@ struct packet_t
           cmd(READ),
           tid(0),
           job_id(-1),
-          dev_id(dev::CPU)
+          dev_id(dev::CPU),
+          flags(0)
     {
         // Do nothing
     }
@@ -63,6 +73,165 @@ struct packet_t
     int rsc_id;
     //
     uint8_t dev_id;
+    //
+    uint8_t flags;
+};
+
+/**
+ * @brief Flags of a replayed packet
+ */
+enum ReplayFlags {
+    REPLAY_WRITE = 1 << 0,
+    REPLAY_GPU = 1 << 1,
+};
+
+/**
+ * @brief The replay_batch_t struct, consecutive packets of one core in
+ * structure-of-arrays form. Job traces only hold reads and writes, which
+ * need an address, a resource, a job and a few flags. The other packet
+ * fields are unused during replay and the core is the same for the whole
+ * batch, so models only stream the arrays they read.
+ */
+struct replay_batch_t
+{
+    //
+    const uint64_t *paddr;
+    //
+    const int32_t *rsc_id;
+    //
+    const int32_t *job_id;
+    //
+    const uint8_t *flags;
+    //
+    size_t n;
+    //
+    uint8_t tid;
+
+    /**
+     * @brief cmd
+     * @param i
+     * @return READ or WRITE
+     */
+    uint8_t cmd(size_t i) const {
+        return (flags[i] & REPLAY_WRITE) ? WRITE : READ;
+    }
+
+    /**
+     * @brief packet, expands a packet for models that take a packet_t
+     * @param i
+     * @return
+     */
+    packet_t packet(size_t i) const {
+        //
+        packet_t pkt;
+        //
+        pkt.cmd = cmd(i);
+        pkt.paddr = paddr[i];
+        pkt.tid = tid;
+        pkt.job_id = job_id[i];
+        pkt.rsc_id = rsc_id[i];
+        pkt.dev_id = (flags[i] & REPLAY_GPU) ? dev::GPU : dev::CPU;
+        //
+        return pkt;
+    }
+};
+
+/**
+ * @brief The replay_buffer_t struct, storage of replayed packets in
+ * structure-of-arrays form
+ */
+struct replay_buffer_t
+{
+    /**
+     * @brief bytes of a packet
+     */
+    static constexpr size_t packet_size =
+        sizeof(uint64_t) + 2 * sizeof(int32_t) + sizeof(uint8_t);
+
+    //
+    std::vector<uint64_t> paddr;
+    //
+    std::vector<int32_t> rsc_id;
+    //
+    std::vector<int32_t> job_id;
+    //
+    std::vector<uint8_t> flags;
+
+    /**
+     * @brief resize
+     * @param n
+     */
+    void resize(size_t n) {
+        paddr.resize(n);
+        rsc_id.resize(n);
+        job_id.resize(n);
+        flags.resize(n);
+    }
+
+    /**
+     * @brief clear, releases the storage
+     */
+    void clear() {
+        std::vector<uint64_t>().swap(paddr);
+        std::vector<int32_t>().swap(rsc_id);
+        std::vector<int32_t>().swap(job_id);
+        std::vector<uint8_t>().swap(flags);
+    }
+
+    /**
+     * @brief swap
+     * @param other
+     */
+    void swap(replay_buffer_t &other) {
+        paddr.swap(other.paddr);
+        rsc_id.swap(other.rsc_id);
+        job_id.swap(other.job_id);
+        flags.swap(other.flags);
+    }
+
+    /**
+     * @brief set, packs a read or write packet
+     * @param i
+     * @param pkt
+     */
+    void set(size_t i, const packet_t &pkt) {
+        paddr[i] = pkt.paddr;
+        rsc_id[i] = pkt.rsc_id;
+        job_id[i] = pkt.job_id;
+        flags[i] = (pkt.cmd == WRITE ? REPLAY_WRITE : 0) |
+                   (pkt.dev_id == dev::GPU ? REPLAY_GPU : 0);
+    }
+
+    /**
+     * @brief assign, copies a batch
+     * @param batch
+     */
+    void assign(const replay_batch_t &batch) {
+        paddr.assign(batch.paddr, batch.paddr + batch.n);
+        rsc_id.assign(batch.rsc_id, batch.rsc_id + batch.n);
+        job_id.assign(batch.job_id, batch.job_id + batch.n);
+        flags.assign(batch.flags, batch.flags + batch.n);
+    }
+
+    /**
+     * @brief batch
+     * @param pos first packet
+     * @param n
+     * @return view of n packets from pos, the core is set by the caller
+     */
+    replay_batch_t batch(size_t pos, size_t n) const {
+        //
+        replay_batch_t batch;
+        //
+        batch.paddr = paddr.data() + pos;
+        batch.rsc_id = rsc_id.data() + pos;
+        batch.job_id = job_id.data() + pos;
+        batch.flags = flags.data() + pos;
+        batch.n = n;
+        batch.tid = 0;
+        //
+        return batch;
+    }
 };
 
 } // end namespace gltracesim
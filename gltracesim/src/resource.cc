@@ -29,6 +29,13 @@ GpuResource::target_names[] = {
     "PIPE_TEXTURE_CUBE_ARRAY",
 };
 
+const char*
+GpuResource::class_names[] = {
+    "VERTEX_BUFFER",
+    "TEXTURE",
+    "RENDER_TARGET",
+};
+
 
 GpuResource::stats_t::stats_t()
 {
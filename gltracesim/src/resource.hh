@@ -26,6 +26,20 @@ class GpuResource
 
 public:
 
+    /**
+     * @brief The Class enum, how a resource is used by the GPU
+     */
+    enum Class {
+        // Buffer objects
+        VERTEX_BUFFER = 0,
+        // Sampled images
+        TEXTURE,
+        // Display targets
+        RENDER_TARGET,
+        //
+        NUM_CLASSES
+    };
+
     /**
      * @brief The stats_t struct
      */
@@ -202,6 +216,19 @@ public:
      */
     const char* get_target_name() const;
 
+    /**
+     * @brief get_class
+     * @return
+     */
+    Class get_class() const;
+
+    /**
+     * @brief get_class_name
+     * @param cls
+     * @return
+     */
+    static const char* get_class_name(int cls);
+
     /**
      * @brief get_addr
      * @param lpr
@@ -251,6 +278,11 @@ private:
      */
     static const char* target_names[];
 
+    /**
+     * @brief class_names
+     */
+    static const char* class_names[];
+
     /**
      * @brief lpr
      */
@@ -54,6 +54,24 @@ GpuResource::get_target_name() const {
     return target_names[lpr.base.target];
 }
 
+inline GpuResource::Class
+GpuResource::get_class() const {
+    // The traces carry no bind flags, so off-screen render targets are
+    // classified as textures
+    if (lpr.base.target == PIPE_BUFFER) {
+        return VERTEX_BUFFER;
+    } else if (lpr.dt != NULL) {
+        return RENDER_TARGET;
+    } else {
+        return TEXTURE;
+    }
+}
+
+inline const char*
+GpuResource::get_class_name(int cls) {
+    return class_names[cls];
+}
+
 } // end namespace gltracesim
 
 #endif // __GLTRACESIM_RESOURCE_IMPL_HH__
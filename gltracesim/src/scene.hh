@@ -9,6 +9,8 @@
 #include "scene.pb.h"
 #include "device.hh"
 
+#include "gem5/trace_archive.hh"
+
 #include "util/timer.hh"
 
 namespace gltracesim {
@@ -111,6 +113,12 @@ public:
      */
     std::vector<uint32_t> opengl_calls;
 
+    /**
+     * @brief trace_archive, shared by the trace generators of the
+     * scene's jobs, closed when the scene and all its jobs are gone
+     */
+    gem5::TraceArchiveWriterPtr trace_archive;
+
 public:
 
     /**
@@ -0,0 +1,91 @@
+#ifndef __GLTRACESIM_STATS_ID_TABLE_HH__
+#define __GLTRACESIM_STATS_ID_TABLE_HH__
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace gltracesim {
+namespace stats {
+
+/**
+ * @brief The IdTable class, stats per job, core or resource id. Jobs and
+ * resources are numbered in creation order, so the ids seen between two
+ * resets are close together and are kept in a vector indexed by the
+ * offset from the lowest one. Ids further than MAX_SPAN from the others,
+ * e.g. packets without a job, fall back to a hash map.
+ */
+template<class T>
+class IdTable
+{
+
+public:
+
+    /**
+     * @brief IdTable
+     */
+    IdTable();
+
+    /**
+     * @brief operator [], creates the stats of an id on first use
+     * @param id
+     * @return valid until the next call
+     */
+    T& operator[](uint64_t id);
+
+    /**
+     * @brief for_each, the used ids in id order, then the outliers
+     * @param fn called with the id and its stats
+     */
+    template<class fn_t>
+    void for_each(fn_t fn);
+
+    /**
+     * @brief clear, keeps the memory for the next interval
+     */
+    void clear();
+
+public:
+
+    /**
+     * @brief Largest range of ids kept dense
+     */
+    static const uint64_t MAX_SPAN = 1 << 16;
+
+private:
+
+    /**
+     * @brief grow, makes room for an id outside the dense range
+     * @param id
+     * @return
+     */
+    T& grow(uint64_t id);
+
+private:
+
+    /**
+     * @brief base, id of the first dense entry
+     */
+    uint64_t base;
+
+    /**
+     * @brief dense
+     */
+    std::vector<T> dense;
+
+    /**
+     * @brief used, dense entries accessed since the last clear
+     */
+    std::vector<uint8_t> used;
+
+    /**
+     * @brief sparse, ids outside the dense range
+     */
+    std::unordered_map<uint64_t, T> sparse;
+
+};
+
+} // end namespace stats
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_STATS_ID_TABLE_HH__
@@ -0,0 +1,108 @@
+#ifndef __GLTRACESIM_STATS_ID_TABLE_IMPL_HH__
+#define __GLTRACESIM_STATS_ID_TABLE_IMPL_HH__
+
+#include <algorithm>
+
+#include "stats/id_table.hh"
+#include "util/cflags.hh"
+
+namespace gltracesim {
+namespace stats {
+
+template<class T>
+const uint64_t IdTable<T>::MAX_SPAN;
+
+template<class T>
+IdTable<T>::IdTable() : base(0)
+{
+
+}
+
+template<class T>
+inline T&
+IdTable<T>::operator[](uint64_t id)
+{
+    // Ids below the base wrap around
+    uint64_t idx = id - base;
+
+    //
+    if (_l(idx < dense.size())) {
+        //
+        used[idx] = 1;
+        //
+        return dense[idx];
+    }
+
+    //
+    return grow(id);
+}
+
+template<class T>
+T&
+IdTable<T>::grow(uint64_t id)
+{
+    //
+    if (dense.empty()) {
+        // First id since the last clear
+        base = id;
+        //
+        dense.resize(1);
+        used.resize(1, 0);
+    } else if (id > base && id - base < MAX_SPAN) {
+        // At least double to amortize the growth
+        size_t size = std::min<uint64_t>(
+            MAX_SPAN, std::max<uint64_t>(id - base + 1, 2 * dense.size())
+        );
+        //
+        dense.resize(size);
+        used.resize(size, 0);
+    } else if (id < base && base + dense.size() - id <= MAX_SPAN) {
+        // Rare, shift the entries up
+        size_t n = base - id;
+        //
+        dense.insert(dense.begin(), n, T());
+        used.insert(used.begin(), n, 0);
+        //
+        base = id;
+    } else {
+        //
+        return sparse[id];
+    }
+
+    //
+    used[id - base] = 1;
+    //
+    return dense[id - base];
+}
+
+template<class T>
+template<class fn_t>
+void
+IdTable<T>::for_each(fn_t fn)
+{
+    //
+    for (size_t i = 0; i < dense.size(); ++i) {
+        if (used[i]) {
+            fn(base + i, dense[i]);
+        }
+    }
+
+    //
+    for (auto &it : sparse) {
+        fn(it.first, it.second);
+    }
+}
+
+template<class T>
+void
+IdTable<T>::clear()
+{
+    dense.clear();
+    used.clear();
+    sparse.clear();
+}
+
+} // end namespace stats
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_STATS_ID_TABLE_IMPL_HH__
@@ -6,6 +6,7 @@ namespace gltracesim {
 SystemPtr system;
 
 System::System(const Json::Value &config) :
+    running(true),
     config(config),
     frame_nbr(0),
     scene_nbr(0),
@@ -4,6 +4,8 @@
 #include <vector>
 #include <cstdint>
 
+#include "util/replacement.hh"
+
 namespace gltracesim {
 
 //
@@ -28,11 +30,6 @@ struct cache_entry_t
         uint64_t tag;
     };
 
-    /**
-     * @brief tsc
-     */
-    uint64_t last_tsc;
-
     /**
      * @brief gpu_resource
      */
@@ -74,7 +71,12 @@ struct cache_params_t
 
 };
 
-template<class params_t, class entry_t>
+/**
+ * @brief The Cache class, set-associative, the replacement policy is a
+ * template parameter (see util/replacement.hh)
+ */
+template<class params_t, class entry_t,
+         class policy_t = replacement::LRUPolicy>
 class Cache
 {
 
@@ -129,6 +131,20 @@ public:
      */
     void find(uint64_t addr, entry_t* &hit, entry_t* &evict);
 
+    /**
+     * @brief insert, validates an entry and sets its tag, entries must
+     * not be validated or retagged directly
+     * @param e
+     * @param addr
+     */
+    void insert(entry_t *e, uint64_t addr);
+
+    /**
+     * @brief invalidate
+     * @param e
+     */
+    void invalidate(entry_t *e);
+
     /**
      * @brief get_data
      * @return
@@ -142,6 +158,23 @@ public:
      */
     data_t data;
 
+    /**
+     * @brief tags, the addresses of the valid entries in the same order,
+     * so that the ways of a set are contiguous and compared with SIMD
+     * instructions. Other entry state is only read on misses.
+     */
+    std::vector<uint64_t> tags;
+
+    /**
+     * @brief policy, replacement state of every set
+     */
+    policy_t policy;
+
+    /**
+     * @brief Tag of invalid entries, never a block address
+     */
+    static const uint64_t INVALID_TAG = ~uint64_t(0);
+
     /**
      * @brief addr
      */
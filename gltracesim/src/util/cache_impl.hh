@@ -5,10 +5,78 @@
 #include "util/cache.hh"
 #include "util/cflags.hh"
 
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
 namespace gltracesim {
 
-template<class params_t, class entry_t>
-Cache<params_t, entry_t>::Cache(params_t *p) : params(*p)
+/**
+ * @brief find_tag, compares the tags of a set, four at a time with AVX2,
+ * two with SSE4.1
+ * @param tags
+ * @param n ways
+ * @param tag
+ * @return way, -1 if no tag matches
+ */
+inline int64_t
+find_tag(const uint64_t *tags, size_t n, uint64_t tag)
+{
+    //
+    size_t w = 0;
+
+#if defined(__AVX2__)
+    //
+    const __m256i key = _mm256_set1_epi64x(tag);
+
+    //
+    for (; w + 4 <= n; w += 4) {
+        //
+        __m256i v = _mm256_loadu_si256((const __m256i*) (tags + w));
+        //
+        int mask = _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, key))
+        );
+        //
+        if (_u(mask)) {
+            return w + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__SSE4_1__)
+    //
+    const __m128i key = _mm_set1_epi64x(tag);
+
+    //
+    for (; w + 2 <= n; w += 2) {
+        //
+        __m128i v = _mm_loadu_si128((const __m128i*) (tags + w));
+        //
+        int mask = _mm_movemask_pd(
+            _mm_castsi128_pd(_mm_cmpeq_epi64(v, key))
+        );
+        //
+        if (_u(mask)) {
+            return w + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    // Remaining ways, all of them without SIMD
+    for (; w < n; ++w) {
+        if (_u(tags[w] == tag)) {
+            return w;
+        }
+    }
+
+    //
+    return -1;
+}
+
+template<class params_t, class entry_t, class policy_t>
+const uint64_t Cache<params_t, entry_t, policy_t>::INVALID_TAG;
+
+template<class params_t, class entry_t, class policy_t>
+Cache<params_t, entry_t, policy_t>::Cache(params_t *p) : params(*p)
 {
     no_sets = params.size / (params.associativity * params.blk_size);
     no_blks = no_sets * params.associativity;
@@ -18,6 +86,8 @@ Cache<params_t, entry_t>::Cache(params_t *p) : params(*p)
 
     data.reserve(no_blks);
     data.resize(no_blks);
+    //
+    tags.assign(no_blks, INVALID_TAG);
     for (size_t blk_idx = 0; blk_idx < no_blks; ++blk_idx)
     {
         //
@@ -28,85 +98,114 @@ Cache<params_t, entry_t>::Cache(params_t *p) : params(*p)
         ce.addr = 0;
     }
 
+    //
+    policy.init(no_sets, params.associativity);
+
     //
     set_idx_mask = (no_sets - 1);
     blk_size_log2 = uint64_t(log2(params.blk_size));
     blk_addr_umask = ~(params.blk_size - 1);
 }
 
-template<class params_t, class entry_t>
+template<class params_t, class entry_t, class policy_t>
 uint64_t
-Cache<params_t, entry_t>::get_set_idx(uint64_t addr) const
+Cache<params_t, entry_t, policy_t>::get_set_idx(uint64_t addr) const
 {
     return (addr >> blk_size_log2) & set_idx_mask;
 }
 
-template<class params_t, class entry_t>
+template<class params_t, class entry_t, class policy_t>
 uint64_t
-Cache<params_t, entry_t>::get_sub_blk_idx(uint64_t addr) const
+Cache<params_t, entry_t, policy_t>::get_sub_blk_idx(uint64_t addr) const
 {
     return (addr & ~blk_addr_umask) / params.sub_blk_size;
 }
 
-template<class params_t, class entry_t>
+template<class params_t, class entry_t, class policy_t>
 uint64_t
-Cache<params_t, entry_t>::get_no_sub_blks() const
+Cache<params_t, entry_t, policy_t>::get_no_sub_blks() const
 {
     return no_sub_blks;
 }
 
-template<class params_t, class entry_t>
+template<class params_t, class entry_t, class policy_t>
 uint64_t
-Cache<params_t, entry_t>::get_blk_addr(uint64_t addr) const
+Cache<params_t, entry_t, policy_t>::get_blk_addr(uint64_t addr) const
 {
     return (addr & blk_addr_umask);
 }
 
-template<class params_t, class entry_t>
+template<class params_t, class entry_t, class policy_t>
 void
-Cache<params_t, entry_t>::find(uint64_t addr, entry_t* &hit, entry_t* &evict)
+Cache<params_t, entry_t, policy_t>::find(uint64_t addr, entry_t* &hit, entry_t* &evict)
 {
     uint64_t blk_addr = get_blk_addr(addr);
-    uint64_t set_idx = get_set_idx(addr) * params.associativity;
-
-    uint64_t lru_tsc = ~uint64_t(0);
-    int lru_idx = set_idx;
+    uint64_t set = get_set_idx(addr);
+    uint64_t set_idx = set * params.associativity;
 
     hit = NULL;
     evict = NULL;
 
-    // For each way
-    for (size_t w = set_idx; w < (set_idx + params.associativity); ++w) {
-        // Hit
-        if (_u(data[w].valid && (data[w].addr == blk_addr))) {
-            //
-            hit = &data[w];
-
-            // Replacement not needed
-            return;
-        }
+    // Hit, only the tags of the set are read
+    int64_t way = find_tag(&tags[set_idx], params.associativity, blk_addr);
 
-        // Check invalid
-        if (_u(data[w].valid == false)) {
-            evict = &data[w];
-        }
+    //
+    if (_u(way >= 0)) {
+        //
+        hit = &data[set_idx + way];
+        //
+        policy.touch(set, way);
 
-        // Check LRU
-        if (_u(data[w].last_tsc < lru_tsc)) {
-            lru_tsc = data[w].last_tsc;
-            lru_idx = w;
-        }
+        // Replacement not needed
+        return;
     }
 
-    // No invalid entry, use LRU.
-    if (evict == NULL) {
-        evict = &data[lru_idx];
+    // Invalid ways have an invalid tag
+    way = find_tag(&tags[set_idx], params.associativity, INVALID_TAG);
+
+    //
+    if (way >= 0) {
+        //
+        evict = &data[set_idx + way];
+
+        //
+        return;
     }
+
+    // No invalid entry, ask the policy
+    evict = &data[set_idx + policy.victim(set)];
+}
+
+template<class params_t, class entry_t, class policy_t>
+void
+Cache<params_t, entry_t, policy_t>::insert(entry_t *e, uint64_t addr)
+{
+    //
+    e->valid = true;
+    e->addr = addr;
+
+    //
+    size_t idx = e - data.data();
+
+    //
+    tags[idx] = addr;
+    //
+    policy.insert(idx / params.associativity, idx % params.associativity);
+}
+
+template<class params_t, class entry_t, class policy_t>
+void
+Cache<params_t, entry_t, policy_t>::invalidate(entry_t *e)
+{
+    //
+    e->valid = false;
+    //
+    tags[e - data.data()] = INVALID_TAG;
 }
 
-template<class params_t, class entry_t>
-typename Cache<params_t, entry_t>::data_t*
-Cache<params_t, entry_t>::get_data()
+template<class params_t, class entry_t, class policy_t>
+typename Cache<params_t, entry_t, policy_t>::data_t*
+Cache<params_t, entry_t, policy_t>::get_data()
 {
     return &data;
 }
@@ -0,0 +1,108 @@
+#ifndef __GLTRACESIM_CYCLE_COUNTER_HH__
+#define __GLTRACESIM_CYCLE_COUNTER_HH__
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace gltracesim {
+
+/**
+ * @brief read_cycles, timestamp counter, a few cycles to read on x86
+ * @return cycles, nanoseconds on other architectures
+ */
+inline uint64_t
+read_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+#endif
+}
+
+/**
+ * @brief The CycleCounter class, cycles spent in a stage, the number of
+ * calls and the items they handled. Stages are timed per call rather
+ * than per item, and may be updated from several threads.
+ */
+class CycleCounter {
+
+public:
+
+    /**
+     * @brief CycleCounter
+     */
+    CycleCounter() : cycles(0), calls(0), items(0) {}
+
+    /**
+     * @brief add
+     * @param c cycles of a call
+     * @param n items handled by the call
+     */
+    void add(uint64_t c, uint64_t n = 0) {
+        __atomic_fetch_add(&cycles, c, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&calls, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&items, n, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @brief reset
+     */
+    void reset() {
+        __atomic_store_n(&cycles, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&calls, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&items, 0, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @brief get_cycles
+     * @return
+     */
+    uint64_t get_cycles() const {
+        return __atomic_load_n(&cycles, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @brief get_calls
+     * @return
+     */
+    uint64_t get_calls() const {
+        return __atomic_load_n(&calls, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @brief get_items
+     * @return
+     */
+    uint64_t get_items() const {
+        return __atomic_load_n(&items, __ATOMIC_RELAXED);
+    }
+
+private:
+
+    /**
+     * @brief cycles
+     */
+    uint64_t cycles;
+
+    /**
+     * @brief calls
+     */
+    uint64_t calls;
+
+    /**
+     * @brief items
+     */
+    uint64_t items;
+
+};
+
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_CYCLE_COUNTER_HH__
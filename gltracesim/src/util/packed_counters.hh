@@ -0,0 +1,130 @@
+#ifndef __GLTRACESIM_UTIL_PACKED_COUNTERS_HH__
+#define __GLTRACESIM_UTIL_PACKED_COUNTERS_HH__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace gltracesim {
+
+/**
+ * @brief The PackedCounters class, N saturating 4-bit counters packed 16
+ * to a word and stored inline, e.g. the sub-block use of a cache entry.
+ * It has no constructor so that arrays of entries are zeroed in one go.
+ */
+template<size_t N>
+class PackedCounters {
+
+public:
+
+    /**
+     * @brief Largest value of a counter
+     */
+    static const uint8_t MAX_VALUE = 15;
+
+    /**
+     * @brief clear, all counters to zero
+     */
+    void clear() {
+        for (size_t w = 0; w < NUM_WORDS; ++w) {
+            words[w] = 0;
+        }
+    }
+
+    /**
+     * @brief value
+     * @param i
+     * @return
+     */
+    uint8_t value(size_t i) const {
+        //
+        assert(i < N);
+        //
+        return (words[i / 16] >> shift(i)) & MAX_VALUE;
+    }
+
+    /**
+     * @brief set
+     * @param i
+     * @param v saturated to MAX_VALUE
+     */
+    void set(size_t i, uint8_t v) {
+        //
+        assert(i < N);
+        //
+        uint64_t &w = words[i / 16];
+        //
+        w &= ~(uint64_t(MAX_VALUE) << shift(i));
+        w |= uint64_t(v < MAX_VALUE ? v : MAX_VALUE) << shift(i);
+    }
+
+    /**
+     * @brief increment, saturating
+     * @param i
+     */
+    void increment(size_t i) {
+        //
+        if (value(i) < MAX_VALUE) {
+            words[i / 16] += uint64_t(1) << shift(i);
+        }
+    }
+
+    /**
+     * @brief count_above, without unpacking the counters
+     * @param v 0 or 1
+     * @return counters greater than v
+     */
+    size_t count_above(uint8_t v) const {
+        //
+        assert(v <= 1);
+
+        //
+        size_t n = 0;
+
+        //
+        for (size_t w = 0; w < NUM_WORDS; ++w) {
+            // Fold the bits of every nibble that make it greater than v
+            // into its lowest bit
+            uint64_t x = (words[w] >> 1) | (words[w] >> 2) | (words[w] >> 3);
+            //
+            if (v == 0) {
+                x |= words[w];
+            }
+            //
+            n += __builtin_popcountll(x & LOW_BITS);
+        }
+
+        //
+        return n;
+    }
+
+private:
+
+    /**
+     * @brief shift
+     * @param i
+     * @return bit offset of counter i in its word
+     */
+    static size_t shift(size_t i) {
+        return (i % 16) * 4;
+    }
+
+private:
+
+    //
+    static const size_t NUM_WORDS = (N + 15) / 16;
+
+    //
+    static const uint64_t LOW_BITS = 0x1111111111111111ULL;
+
+    //
+    uint64_t words[NUM_WORDS];
+
+};
+
+template<size_t N>
+const uint8_t PackedCounters<N>::MAX_VALUE;
+
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_UTIL_PACKED_COUNTERS_HH__
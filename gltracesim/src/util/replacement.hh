@@ -0,0 +1,582 @@
+#ifndef __GLTRACESIM_UTIL_REPLACEMENT_HH__
+#define __GLTRACESIM_UTIL_REPLACEMENT_HH__
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "util/cflags.hh"
+
+namespace gltracesim {
+
+/**
+ * Replacement policies of Cache, a template parameter so that the hit
+ * and miss paths are resolved at compile time. A policy keeps its own
+ * metadata per set and way, the cache only tells it about hits and
+ * fills, and asks it for a victim when a set has no invalid way.
+ */
+namespace replacement {
+
+/**
+ * @brief The Policy enum, policies that can be selected by name
+ */
+enum Policy {
+    LRU = 0,
+    TREE_PLRU,
+    SRRIP,
+    BRRIP,
+    RANDOM,
+    NUM_POLICIES
+};
+
+/**
+ * @brief get_policy
+ * @param name lru, plru, srrip, brrip or random
+ * @return NUM_POLICIES if there is no such policy
+ */
+inline Policy
+get_policy(const std::string &name)
+{
+    //
+    static const char *names[] = {
+        "lru", "plru", "srrip", "brrip", "random"
+    };
+
+    //
+    for (int i = 0; i < NUM_POLICIES; ++i) {
+        if (name == names[i]) {
+            return Policy(i);
+        }
+    }
+
+    //
+    return NUM_POLICIES;
+}
+
+/**
+ * @brief save_vector, appends the raw bytes of a vector
+ * @param state
+ * @param v
+ */
+template <class T>
+inline void
+save_vector(std::string *state, const std::vector<T> &v)
+{
+    state->append((const char*) v.data(), v.size() * sizeof(T));
+}
+
+/**
+ * @brief restore_vector, reads the bytes written by save_vector into a
+ * vector of the same size
+ * @param state
+ * @param pos read position, advanced
+ * @param v
+ * @return false if the state is too short
+ */
+template <class T>
+inline bool
+restore_vector(const std::string &state, size_t &pos, std::vector<T> &v)
+{
+    //
+    size_t size = v.size() * sizeof(T);
+
+    //
+    if (pos + size > state.size()) {
+        return false;
+    }
+
+    //
+    memcpy((char*) v.data(), state.data() + pos, size);
+    //
+    pos += size;
+
+    //
+    return true;
+}
+
+/**
+ * @brief The LRUPolicy class, true LRU. The ways of a set form a doubly
+ * linked list in recency order, 8 bytes per line, so hits and victims
+ * are O(1) for any associativity, including fully associative caches.
+ */
+class LRUPolicy {
+
+public:
+
+    /**
+     * @brief init
+     * @param no_sets
+     * @param ways
+     */
+    void init(size_t no_sets, size_t ways) {
+        //
+        assert(ways);
+
+        //
+        this->ways = ways;
+
+        //
+        prev.resize(no_sets * ways);
+        next.resize(no_sets * ways);
+        head.resize(no_sets);
+        tail.resize(no_sets);
+
+        // Way 0 is the most recently used
+        for (size_t set = 0; set < no_sets; ++set) {
+            //
+            for (size_t w = 0; w < ways; ++w) {
+                prev[set * ways + w] = (w + ways - 1) % ways;
+                next[set * ways + w] = (w + 1) % ways;
+            }
+            //
+            head[set] = 0;
+            tail[set] = ways - 1;
+        }
+    }
+
+    /**
+     * @brief touch, moves a way to the front on a hit
+     * @param set
+     * @param way
+     */
+    void touch(size_t set, size_t way) {
+        //
+        if (_u(head[set] == way)) {
+            return;
+        }
+
+        //
+        way_t *p = &prev[set * ways];
+        way_t *n = &next[set * ways];
+
+        // Unlink
+        if (tail[set] == way) {
+            tail[set] = p[way];
+        } else {
+            p[n[way]] = p[way];
+        }
+        //
+        n[p[way]] = n[way];
+
+        // Push front
+        n[way] = head[set];
+        p[head[set]] = way;
+        //
+        head[set] = way;
+    }
+
+    /**
+     * @brief insert, a fill is a use
+     * @param set
+     * @param way
+     */
+    void insert(size_t set, size_t way) {
+        touch(set, way);
+    }
+
+    /**
+     * @brief victim
+     * @param set
+     * @return the least recently used way
+     */
+    size_t victim(size_t set) {
+        return tail[set];
+    }
+
+    /**
+     * @brief save
+     * @param state
+     */
+    void save(std::string *state) const {
+        save_vector(state, prev);
+        save_vector(state, next);
+        save_vector(state, head);
+        save_vector(state, tail);
+    }
+
+    /**
+     * @brief restore
+     * @param state
+     * @return
+     */
+    bool restore(const std::string &state) {
+        //
+        size_t pos = 0;
+        //
+        return restore_vector(state, pos, prev) &&
+               restore_vector(state, pos, next) &&
+               restore_vector(state, pos, head) &&
+               restore_vector(state, pos, tail) &&
+               pos == state.size();
+    }
+
+private:
+
+    //
+    typedef uint32_t way_t;
+
+    //
+    size_t ways;
+    // Less recently used way of every way
+    std::vector<way_t> prev;
+    // More recently used way of every way
+    std::vector<way_t> next;
+    // Most recently used way of every set
+    std::vector<way_t> head;
+    // Least recently used way of every set
+    std::vector<way_t> tail;
+
+};
+
+/**
+ * @brief The TreePLRUPolicy class, a binary tree of ways-1 bits per set
+ * pointing away from the most recently used half. Hits and victims walk
+ * one path, O(log ways).
+ */
+class TreePLRUPolicy {
+
+public:
+
+    /**
+     * @brief supports, the tree of a set is one 64-bit word
+     * @param ways
+     * @return true for a power of two, at most 64
+     */
+    static bool supports(size_t ways) {
+        return ways && ways <= 64 && (ways & (ways - 1)) == 0;
+    }
+
+    /**
+     * @brief init
+     * @param no_sets
+     * @param ways see supports
+     */
+    void init(size_t no_sets, size_t ways) {
+        //
+        assert(supports(ways));
+
+        //
+        levels = __builtin_ctzll(ways);
+
+        //
+        bits.assign(no_sets, 0);
+    }
+
+    /**
+     * @brief touch, points the nodes on the path away from the way
+     * @param set
+     * @param way
+     */
+    void touch(size_t set, size_t way) {
+        //
+        uint64_t b = bits[set];
+
+        // Node 1 is the root, node n has children 2n and 2n+1
+        for (size_t l = 0, node = 1; l < levels; ++l) {
+            //
+            size_t right = (way >> (levels - 1 - l)) & 1;
+            //
+            if (right) {
+                b &= ~(uint64_t(1) << node);
+            } else {
+                b |= uint64_t(1) << node;
+            }
+            //
+            node = 2 * node + right;
+        }
+
+        //
+        bits[set] = b;
+    }
+
+    /**
+     * @brief insert
+     * @param set
+     * @param way
+     */
+    void insert(size_t set, size_t way) {
+        touch(set, way);
+    }
+
+    /**
+     * @brief victim
+     * @param set
+     * @return the way the nodes point to
+     */
+    size_t victim(size_t set) {
+        //
+        uint64_t b = bits[set];
+        //
+        size_t node = 1;
+
+        //
+        for (size_t l = 0; l < levels; ++l) {
+            node = 2 * node + ((b >> node) & 1);
+        }
+
+        //
+        return node - (size_t(1) << levels);
+    }
+
+    /**
+     * @brief save
+     * @param state
+     */
+    void save(std::string *state) const {
+        save_vector(state, bits);
+    }
+
+    /**
+     * @brief restore
+     * @param state
+     * @return
+     */
+    bool restore(const std::string &state) {
+        //
+        size_t pos = 0;
+        //
+        return restore_vector(state, pos, bits) && pos == state.size();
+    }
+
+private:
+
+    //
+    size_t levels;
+    // Tree of every set, bit n is node n
+    std::vector<uint64_t> bits;
+
+};
+
+/**
+ * @brief The RRIPPolicy class, re-reference interval prediction with a
+ * 2-bit RRPV per line (Jaleel et al., ISCA 2010). Hits predict a near
+ * re-reference, SRRIP fills predict a long one, BRRIP fills a distant
+ * one except every 32nd. Victims are the first way with a distant
+ * prediction, after ageing the set so that one exists.
+ */
+template <bool bimodal>
+class RRIPPolicy {
+
+public:
+
+    /**
+     * @brief init
+     * @param no_sets
+     * @param ways
+     */
+    void init(size_t no_sets, size_t ways) {
+        //
+        this->ways = ways;
+        //
+        fills = 0;
+        //
+        rrpv.assign(no_sets * ways, DISTANT);
+    }
+
+    /**
+     * @brief touch
+     * @param set
+     * @param way
+     */
+    void touch(size_t set, size_t way) {
+        rrpv[set * ways + way] = 0;
+    }
+
+    /**
+     * @brief insert
+     * @param set
+     * @param way
+     */
+    void insert(size_t set, size_t way) {
+        //
+        if (bimodal && _l(++fills % 32 != 0)) {
+            rrpv[set * ways + way] = DISTANT;
+        } else {
+            rrpv[set * ways + way] = DISTANT - 1;
+        }
+    }
+
+    /**
+     * @brief victim
+     * @param set
+     * @return
+     */
+    size_t victim(size_t set) {
+        //
+        uint8_t *r = &rrpv[set * ways];
+
+        //
+        uint8_t max = 0;
+
+        //
+        for (size_t w = 0; w < ways; ++w) {
+            //
+            if (r[w] == DISTANT) {
+                return w;
+            }
+            //
+            max = std::max(max, r[w]);
+        }
+
+        // Age the set until the oldest prediction is distant
+        uint8_t age = DISTANT - max;
+        //
+        size_t way = 0;
+
+        //
+        for (size_t w = ways; w-- > 0;) {
+            //
+            r[w] += age;
+            //
+            if (r[w] == DISTANT) {
+                way = w;
+            }
+        }
+
+        //
+        return way;
+    }
+
+    /**
+     * @brief save
+     * @param state
+     */
+    void save(std::string *state) const {
+        //
+        save_vector(state, rrpv);
+        //
+        state->append((const char*) &fills, sizeof(fills));
+    }
+
+    /**
+     * @brief restore
+     * @param state
+     * @return
+     */
+    bool restore(const std::string &state) {
+        //
+        size_t pos = 0;
+
+        //
+        if (!restore_vector(state, pos, rrpv) ||
+            pos + sizeof(fills) != state.size()) {
+            return false;
+        }
+
+        //
+        memcpy(&fills, state.data() + pos, sizeof(fills));
+
+        //
+        return true;
+    }
+
+private:
+
+    //
+    static const uint8_t DISTANT = 3;
+
+    //
+    size_t ways;
+    // Fills, every 32nd BRRIP fill is not distant
+    uint64_t fills;
+    // Re-reference prediction of every line
+    std::vector<uint8_t> rrpv;
+
+};
+
+template <bool bimodal>
+const uint8_t RRIPPolicy<bimodal>::DISTANT;
+
+//
+typedef RRIPPolicy<false> SRRIPPolicy;
+typedef RRIPPolicy<true> BRRIPPolicy;
+
+/**
+ * @brief The RandomPolicy class, no metadata, victims from a xorshift
+ * generator with a fixed seed so runs are reproducible
+ */
+class RandomPolicy {
+
+public:
+
+    /**
+     * @brief init
+     * @param no_sets
+     * @param ways
+     */
+    void init(size_t no_sets, size_t ways) {
+        //
+        this->ways = ways;
+        //
+        rng = 0x9e3779b97f4a7c15ULL;
+    }
+
+    /**
+     * @brief touch
+     */
+    void touch(size_t set, size_t way) {
+        // Do nothing
+    }
+
+    /**
+     * @brief insert
+     */
+    void insert(size_t set, size_t way) {
+        // Do nothing
+    }
+
+    /**
+     * @brief victim
+     * @param set
+     * @return
+     */
+    size_t victim(size_t set) {
+        //
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        //
+        return rng % ways;
+    }
+
+    /**
+     * @brief save
+     * @param state
+     */
+    void save(std::string *state) const {
+        state->append((const char*) &rng, sizeof(rng));
+    }
+
+    /**
+     * @brief restore
+     * @param state
+     * @return
+     */
+    bool restore(const std::string &state) {
+        //
+        if (state.size() != sizeof(rng)) {
+            return false;
+        }
+        //
+        memcpy(&rng, state.data(), sizeof(rng));
+        //
+        return true;
+    }
+
+private:
+
+    //
+    size_t ways;
+    //
+    uint64_t rng;
+
+};
+
+} // end namespace replacement
+
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_UTIL_REPLACEMENT_HH__
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cassert>
+
+#include "util/stack_distance.hh"
+
+namespace gltracesim {
+
+StackDistance::StackDistance() :
+    tree(64, 0), now(0)
+{
+    // Do nothing
+}
+
+uint64_t
+StackDistance::access(uint64_t blk)
+{
+    //
+    if (now == tree.size()) {
+        compact();
+    }
+
+    //
+    uint64_t t = now++;
+
+    //
+    auto it = last.find(blk);
+
+    //
+    uint64_t distance = COLD;
+
+    //
+    if (it != last.end()) {
+        // Blocks referenced since, the block itself is at it->second
+        distance = last.size() - prefix(it->second);
+        //
+        mark(it->second, -1);
+        //
+        it->second = t;
+    } else {
+        last[blk] = t;
+    }
+
+    //
+    mark(t, 1);
+
+    //
+    return distance;
+}
+
+void
+StackDistance::remove(uint64_t blk)
+{
+    //
+    auto it = last.find(blk);
+
+    //
+    if (it == last.end()) {
+        return;
+    }
+
+    //
+    mark(it->second, -1);
+    //
+    last.erase(it);
+}
+
+void
+StackDistance::clear()
+{
+    //
+    last.clear();
+    //
+    tree.assign(64, 0);
+    //
+    now = 0;
+}
+
+void
+StackDistance::get_blks(std::vector<uint64_t> &blks) const
+{
+    //
+    std::vector<std::pair<uint64_t, uint64_t>> live;
+    //
+    live.reserve(last.size());
+
+    //
+    for (auto &it: last) {
+        live.push_back(std::make_pair(it.second, it.first));
+    }
+
+    // Recency order
+    std::sort(live.begin(), live.end());
+
+    //
+    blks.clear();
+    blks.reserve(live.size());
+
+    //
+    for (auto &it: live) {
+        blks.push_back(it.second);
+    }
+}
+
+void
+StackDistance::set_blks(const std::vector<uint64_t> &blks)
+{
+    //
+    clear();
+
+    //
+    for (auto blk: blks) {
+        access(blk);
+    }
+}
+
+void
+StackDistance::mark(uint64_t t, int delta)
+{
+    for (uint64_t i = t + 1; i <= tree.size(); i += i & (~i + 1)) {
+        tree[i - 1] += delta;
+    }
+}
+
+uint64_t
+StackDistance::prefix(uint64_t t) const
+{
+    //
+    uint64_t sum = 0;
+
+    //
+    for (uint64_t i = t + 1; i > 0; i -= i & (~i + 1)) {
+        sum += tree[i - 1];
+    }
+
+    //
+    return sum;
+}
+
+void
+StackDistance::compact()
+{
+    //
+    std::vector<std::pair<uint64_t, uint64_t*>> live;
+    //
+    live.reserve(last.size());
+
+    //
+    for (auto &it: last) {
+        live.push_back(std::make_pair(it.second, &it.second));
+    }
+
+    // Keep the recency order
+    std::sort(live.begin(), live.end());
+
+    // At least as many free slots as live blocks
+    size_t size = 64;
+    //
+    while (size < 2 * live.size()) {
+        size <<= 1;
+    }
+
+    //
+    tree.assign(size, 0);
+
+    //
+    for (size_t t = 0; t < live.size(); ++t) {
+        *live[t].second = t;
+    }
+
+    // Linear time Fenwick build, the live times are 0..live-1
+    for (size_t i = 1; i <= size; ++i) {
+        //
+        if (i <= live.size()) {
+            tree[i - 1] += 1;
+        }
+        //
+        size_t parent = i + (i & (~i + 1));
+        //
+        if (parent <= size) {
+            tree[parent - 1] += tree[i - 1];
+        }
+    }
+
+    //
+    now = live.size();
+}
+
+SetStackDistance::SetStackDistance(size_t num_sets) :
+    sets(num_sets)
+{
+    //
+    assert(num_sets && (num_sets & (num_sets - 1)) == 0);
+}
+
+} // end namespace gltracesim
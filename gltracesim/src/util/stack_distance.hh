@@ -0,0 +1,174 @@
+#ifndef __GLTRACESIM_STACK_DISTANCE_HH__
+#define __GLTRACESIM_STACK_DISTANCE_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace gltracesim {
+
+/**
+ * @brief The StackDistance class, LRU stack distances of a block
+ * reference stream.
+ *
+ * Olken's algorithm: every block is stamped with the time of its last
+ * reference, and a Fenwick tree over time marks the times that are the
+ * last reference of some block. The stack distance of a reference is
+ * the number of marks after the block's previous reference, i.e. the
+ * number of distinct blocks referenced since. Time is renumbered when
+ * the tree fills up, so the tree stays proportional to the number of
+ * distinct blocks.
+ */
+class StackDistance {
+
+public:
+
+    /**
+     * @brief distance of a first reference
+     */
+    static const uint64_t COLD = ~uint64_t(0);
+
+    /**
+     * @brief StackDistance
+     */
+    StackDistance();
+
+    /**
+     * @brief access
+     * @param blk block address
+     * @return stack distance, COLD on the first reference
+     */
+    uint64_t access(uint64_t blk);
+
+    /**
+     * @brief remove a block from the stack
+     * @param blk
+     */
+    void remove(uint64_t blk);
+
+    /**
+     * @brief clear
+     */
+    void clear();
+
+    /**
+     * @brief get_blks
+     * @param blks blocks in the stack, least recently referenced first
+     */
+    void get_blks(std::vector<uint64_t> &blks) const;
+
+    /**
+     * @brief set_blks, rebuilds the stack by referencing the blocks in
+     * order, i.e. the inverse of get_blks
+     * @param blks
+     */
+    void set_blks(const std::vector<uint64_t> &blks);
+
+    /**
+     * @brief size
+     * @return distinct blocks in the stack
+     */
+    size_t size() const {
+        return last.size();
+    }
+
+private:
+
+    /**
+     * @brief mark
+     * @param t
+     * @param delta
+     */
+    void mark(uint64_t t, int delta);
+
+    /**
+     * @brief prefix
+     * @param t
+     * @return marks at times [0, t]
+     */
+    uint64_t prefix(uint64_t t) const;
+
+    /**
+     * @brief compact, renumbers the live times from 0
+     */
+    void compact();
+
+    /**
+     * @brief time of the last reference of every block
+     */
+    std::unordered_map<uint64_t, uint64_t> last;
+
+    /**
+     * @brief Fenwick tree over time
+     */
+    std::vector<uint32_t> tree;
+
+    /**
+     * @brief now
+     */
+    uint64_t now;
+
+};
+
+/**
+ * @brief The SetStackDistance class, stack distances within the sets of
+ * a set associative cache. A reference hits in an LRU cache with the
+ * same number of sets and A ways iff its distance is below A.
+ */
+class SetStackDistance {
+
+public:
+
+    /**
+     * @brief SetStackDistance
+     * @param num_sets power of two
+     */
+    SetStackDistance(size_t num_sets);
+
+    /**
+     * @brief access
+     * @param blk
+     * @return
+     */
+    uint64_t access(uint64_t blk) {
+        return sets[blk & (sets.size() - 1)].access(blk);
+    }
+
+    /**
+     * @brief remove
+     * @param blk
+     */
+    void remove(uint64_t blk) {
+        sets[blk & (sets.size() - 1)].remove(blk);
+    }
+
+    /**
+     * @brief num_sets
+     * @return
+     */
+    size_t num_sets() const {
+        return sets.size();
+    }
+
+    /**
+     * @brief get_set
+     * @param idx
+     * @return
+     */
+    StackDistance& get_set(size_t idx) {
+        return sets[idx];
+    }
+
+private:
+
+    /**
+     * @brief sets
+     */
+    std::vector<StackDistance> sets;
+
+};
+
+} // end namespace gltracesim
+
+#endif // __GLTRACESIM_STACK_DISTANCE_HH__